@@ -15,8 +15,10 @@ class AtomicStrainConan(ConanFile):
         "coretoolkit/1.0.0",
         "nlohmann_json/3.11.3",
         "spdlog/1.14.1",
+        "zlib/1.3.1",
+        "zstd/1.5.6",
     )
-    exports_sources = "CMakeLists.txt", "include/*", "src/*"
+    exports_sources = "CMakeLists.txt", "include/*", "src/*", "tests/*"
 
     def layout(self):
         cmake_layout(self)
@@ -43,4 +45,8 @@ class AtomicStrainConan(ConanFile):
             "coretoolkit::coretoolkit",
             "nlohmann_json::nlohmann_json",
             "spdlog::spdlog",
+            "zlib::zlib",
+            "zstd::zstdlib",
         ]
+        if self.settings.os == "Linux":
+            self.cpp_info.system_libs = ["pthread"]
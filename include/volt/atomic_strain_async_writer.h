@@ -0,0 +1,52 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+namespace Volt{
+
+// Runs output jobs on a dedicated I/O thread. The queue is bounded so a slow disk
+// throttles the producer instead of accumulating unbounded result buffers. Failed
+// jobs are logged when they fail, and the first one is rethrown from wait().
+class AtomicStrainAsyncWriter{
+public:
+	explicit AtomicStrainAsyncWriter(std::size_t maxPendingJobs = 2);
+	// Drains all queued jobs before joining the I/O thread.
+	~AtomicStrainAsyncWriter();
+
+	AtomicStrainAsyncWriter(const AtomicStrainAsyncWriter&) = delete;
+	AtomicStrainAsyncWriter& operator=(const AtomicStrainAsyncWriter&) = delete;
+
+	// Blocks while the queue is full.
+	void submit(std::function<void()> job);
+
+	// Blocks until every submitted job has finished, then rethrows the first
+	// exception a job has thrown since the last wait().
+	void wait();
+
+	std::size_t maxPendingJobs() const{
+		return _maxPendingJobs;
+	}
+
+private:
+	void run();
+
+	std::size_t _maxPendingJobs;
+	std::deque<std::function<void()>> _jobs;
+	std::size_t _activeJobs = 0;
+	bool _stopping = false;
+	std::exception_ptr _error;
+
+	std::mutex _mutex;
+	std::condition_variable _jobAvailable;
+	std::condition_variable _slotAvailable;
+	std::condition_variable _idle;
+	std::thread _thread;
+};
+
+}
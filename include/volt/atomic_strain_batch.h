@@ -0,0 +1,68 @@
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace Volt{
+
+class AtomicStrainService;
+
+// One (current, reference) pair of a batch manifest.
+struct AtomicStrainBatchJob{
+	std::string input;
+	// Empty to use the input frame itself as reference.
+	std::string reference;
+	// Empty to derive it from the input path.
+	std::string output;
+	// Filled in before scheduling.
+	std::size_t numAtoms = 0;
+	std::size_t estimatedBytes = 0;
+	std::size_t threads = 1;
+};
+
+// Reads a JSON manifest, either an array of jobs or an object with a "jobs" array,
+// each job an object with "input" and optional "reference" and "output". Relative
+// paths are resolved against the directory of the manifest. Throws
+// std::runtime_error for unreadable or malformed manifests.
+std::vector<AtomicStrainBatchJob> readBatchManifest(const std::string& path);
+
+// Runs independent jobs concurrently, each in its own tbb::task_arena sized by
+// job.threads. A job starts once its estimated memory fits into what the running
+// jobs leave of the budget and its threads fit into the thread limit. Jobs are
+// started largest first. A job larger than the whole budget runs alone.
+class AtomicStrainBatchScheduler{
+public:
+	AtomicStrainBatchScheduler(std::size_t memoryBudget, std::size_t maxThreads);
+
+	// Returns the number of jobs for which execute returned false or threw.
+	std::size_t run(
+		const std::vector<AtomicStrainBatchJob>& jobs,
+		const std::function<bool(const AtomicStrainBatchJob&)>& execute
+	);
+
+private:
+	std::size_t _memoryBudget;
+	std::size_t _maxThreads;
+};
+
+// 80% of the physical memory, the budget of runBatch() when none is given.
+std::size_t defaultMemoryBudget();
+
+// Analyzes every (input, reference) pair of the manifest inside this process through
+// AtomicStrainBatchScheduler. Each job gets a fresh analyzer set up by configure, which
+// returns false for invalid options, and threads in proportion to its atom count.
+// Jobs without an output derive it from the input path. Returns false if the manifest
+// cannot be read or any job failed; failures are logged.
+bool runBatch(
+	const std::string& manifestPath,
+	std::size_t memoryBudget,
+	std::size_t maxThreads,
+	bool useMmap,
+	bool useSnapshot,
+	bool preferUnwrapped,
+	const std::function<bool(AtomicStrainService&)>& configure
+);
+
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <volt/atomic_strain_frame_reader.h>
+#include <volt/atomic_strain_mapped_file.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace Volt{
+
+// Reader for LAMMPS binary dumps ("dump ... binary" / *.bin), memory mapped like the
+// text reader. Both the original layout and the revised one introduced with the
+// "DUMPATOM"/"DUMPCUSTOM" magic string are understood; files may hold any number of
+// frames. Only the id and position fields of each per-processor chunk are copied
+// into the frame buffers.
+//
+// Files without column names (the original layout and revision 1) are assumed to
+// hold "dump atom" rows: id type xs ys zs, optionally followed by image flags; any
+// other row size is rejected. Orthogonal, restricted triclinic (tilt factors) and
+// general triclinic (edge vectors and origin) boxes are understood.
+// preferUnwrapped selects xu/yu/zu over x/y/z columns, see findDumpColumns().
+class AtomicStrainBinaryDumpReader : public AtomicStrainFrameReader{
+public:
+	explicit AtomicStrainBinaryDumpReader(const std::string& path, bool preferUnwrapped = false);
+
+	AtomicStrainBinaryDumpReader(const AtomicStrainBinaryDumpReader&) = delete;
+	AtomicStrainBinaryDumpReader& operator=(const AtomicStrainBinaryDumpReader&) = delete;
+
+	bool readFrame(AtomicStrainFrame& frame) override;
+	bool skipFrame(AtomicStrainFrameInfo& info) override;
+
+	bool seekable() const override{
+		return true;
+	}
+
+	void seek(std::uint64_t offset) override;
+
+	// Byte offset of the next frame.
+	std::size_t offset() const{
+		return _offset;
+	}
+
+	std::size_t size() const{
+		return _file.size();
+	}
+
+private:
+	std::string _path;
+	MappedFile _file;
+	std::size_t _offset = 0;
+	bool _preferUnwrapped;
+};
+
+}
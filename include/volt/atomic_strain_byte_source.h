@@ -0,0 +1,39 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <string>
+
+namespace Volt{
+
+// Sequential byte stream feeding the streaming dump reader. Implementations throw
+// std::runtime_error on read or decompression errors.
+class ByteSource{
+public:
+	virtual ~ByteSource() = default;
+
+	// Copies up to size bytes into buffer. Returns 0 only at the end of the stream.
+	virtual std::size_t read(char* buffer, std::size_t size) = 0;
+};
+
+enum class Compression{
+	None,
+	Gzip,
+	Zstd
+};
+
+// Detects gzip and zstd input from the leading magic bytes.
+Compression detectCompression(const std::string& path);
+
+// Decompresses on a background thread into a queue bounded in blocks and bytes, so
+// inflating overlaps with parsing. zstd input made of several frames with known
+// sizes, as written by pzstd, is decompressed frame-parallel in batches of bounded
+// size; "zstd -T" writes a single frame, which is streamed on one thread.
+std::unique_ptr<ByteSource> openDecompressingSource(const std::string& path, Compression compression);
+
+// Reads standard input ("-"), a pipe or a FIFO as it is being written. read()
+// returns whatever has arrived instead of waiting for a full buffer, so a frame can
+// be parsed as soon as its last line is in.
+std::unique_ptr<ByteSource> openPipeSource(const std::string& path);
+
+}
@@ -0,0 +1,93 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// On-disk layout of the columnar atomic strain result format. A file consists of a
+// FileHeader, a table of ColumnEntry records and the column payloads. Every payload
+// starts at a multiple of Columnar::Alignment so mapped columns can be used in place.
+// Multi-component columns use the msgpack component order; strain_tensor holds
+// xx, yy, zz, xy, xz, yz. A QuantizedInt32 value column whose codes would overflow
+// is stored as Float64 instead, so readers must check ColumnEntry::type.
+namespace Volt::Columnar{
+
+inline constexpr char Magic[8] = { 'V', 'O', 'L', 'T', 'C', 'O', 'L', '1' };
+inline constexpr std::uint32_t Version = 2;
+inline constexpr std::uint64_t Alignment = 64;
+
+enum class ColumnType : std::uint32_t{
+	Int32 = 0,
+	Float64 = 1,
+	Float32 = 2,
+	// Int32 codes, value = code * ColumnEntry::scale.
+	QuantizedInt32 = 3,
+	// One bit per row, LSB first.
+	Bitmask = 4
+};
+
+enum HeaderFlags : std::uint32_t{
+	HasChecksums = 1u << 0
+};
+
+struct FileHeader{
+	char magic[8];
+	std::uint32_t version;
+	std::uint32_t flags;
+	std::uint64_t numRows;
+	std::uint32_t numColumns;
+	std::uint32_t reserved;
+	std::uint64_t columnTableOffset;
+	std::uint64_t fileSize;
+	// Row-major 3x4 cell matrix (three cell vectors followed by the origin column).
+	double cell[12];
+	std::uint32_t pbc[3];
+	std::uint32_t padding;
+};
+
+struct ColumnEntry{
+	char name[32];
+	ColumnType type;
+	std::uint32_t components;
+	std::uint64_t offset;
+	std::uint64_t size;
+	std::uint64_t checksum;
+	double scale;
+};
+
+static_assert(sizeof(FileHeader) == 160, "Unexpected columnar header layout");
+static_assert(sizeof(ColumnEntry) == 72, "Unexpected columnar column entry layout");
+
+inline constexpr std::uint64_t ChecksumSeed = 14695981039346656037ull;
+
+// FNV-1a, chainable by passing the previous result as the seed.
+inline std::uint64_t checksum(const void* data, std::size_t size, std::uint64_t seed = ChecksumSeed){
+	const auto* bytes = static_cast<const unsigned char*>(data);
+	std::uint64_t hash = seed;
+	for(std::size_t i = 0; i < size; ++i){
+		hash ^= bytes[i];
+		hash *= 1099511628211ull;
+	}
+	return hash;
+}
+
+inline constexpr std::uint64_t alignUp(std::uint64_t value, std::uint64_t alignment = Alignment){
+	return (value + alignment - 1) / alignment * alignment;
+}
+
+inline constexpr std::size_t elementSize(ColumnType type){
+	switch(type){
+		case ColumnType::Float64: return 8;
+		case ColumnType::Int32:
+		case ColumnType::Float32:
+		case ColumnType::QuantizedInt32: return 4;
+		case ColumnType::Bitmask: return 0;
+	}
+	return 0;
+}
+
+inline constexpr std::uint64_t payloadSize(ColumnType type, std::uint32_t components, std::uint64_t numRows){
+	if(type == ColumnType::Bitmask) return (numRows * components + 7) / 8;
+	return numRows * components * elementSize(type);
+}
+
+}
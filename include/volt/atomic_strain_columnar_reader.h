@@ -0,0 +1,108 @@
+#pragma once
+
+#include <volt/atomic_strain_columnar_format.h>
+#include <volt/atomic_strain_mapped_file.h>
+
+#include <cstdint>
+#include <cstring>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <type_traits>
+
+namespace Volt{
+
+// Header-only reader for columnar atomic strain results. The file is memory mapped
+// and columns are handed out as spans into the mapping, so only the pages of the
+// columns actually touched are read from disk.
+class AtomicStrainColumnarReader{
+public:
+	explicit AtomicStrainColumnarReader(const std::string& path)
+		: _file(path, "columnar result"){
+		if(_file.size() < sizeof(Columnar::FileHeader)) throw std::runtime_error("Columnar result is truncated: " + path);
+		validate(path);
+	}
+
+	AtomicStrainColumnarReader(const AtomicStrainColumnarReader&) = delete;
+	AtomicStrainColumnarReader& operator=(const AtomicStrainColumnarReader&) = delete;
+	AtomicStrainColumnarReader(AtomicStrainColumnarReader&&) noexcept = default;
+	AtomicStrainColumnarReader& operator=(AtomicStrainColumnarReader&&) noexcept = default;
+
+	const Columnar::FileHeader& header() const{
+		return *_file.data<Columnar::FileHeader>();
+	}
+
+	std::uint64_t numRows() const{
+		return header().numRows;
+	}
+
+	std::span<const Columnar::ColumnEntry> columns() const{
+		return { reinterpret_cast<const Columnar::ColumnEntry*>(_file.data() + header().columnTableOffset), header().numColumns };
+	}
+
+	const Columnar::ColumnEntry* findColumn(std::string_view name) const{
+		for(const auto& entry : columns()){
+			if(std::string_view(entry.name, ::strnlen(entry.name, sizeof(entry.name))) == name) return &entry;
+		}
+		return nullptr;
+	}
+
+	std::span<const std::byte> rawColumn(std::string_view name) const{
+		const Columnar::ColumnEntry* entry = findColumn(name);
+		if(!entry) throw std::out_of_range("No such column: " + std::string(name));
+		return { _file.data<std::byte>() + entry->offset, entry->size };
+	}
+
+	// Typed access: int32_t for Int32/QuantizedInt32, double for Float64, float for
+	// Float32 and uint8_t for Bitmask columns. Components are interleaved per row.
+	template<typename T>
+	std::span<const T> column(std::string_view name) const{
+		const Columnar::ColumnEntry* entry = findColumn(name);
+		if(!entry) throw std::out_of_range("No such column: " + std::string(name));
+		if(!matchesType<T>(entry->type)) throw std::invalid_argument("Column type mismatch: " + std::string(name));
+		return { reinterpret_cast<const T*>(_file.data() + entry->offset), entry->size / sizeof(T) };
+	}
+
+	// Always true for files written without checksums.
+	bool verifyChecksum(std::string_view name) const{
+		if(!(header().flags & Columnar::HasChecksums)) return true;
+		const Columnar::ColumnEntry* entry = findColumn(name);
+		if(!entry) throw std::out_of_range("No such column: " + std::string(name));
+		return Columnar::checksum(_file.data() + entry->offset, entry->size) == entry->checksum;
+	}
+
+private:
+	template<typename T>
+	static bool matchesType(Columnar::ColumnType type){
+		switch(type){
+			case Columnar::ColumnType::Int32:
+			case Columnar::ColumnType::QuantizedInt32: return std::is_same_v<T, std::int32_t>;
+			case Columnar::ColumnType::Float64: return std::is_same_v<T, double>;
+			case Columnar::ColumnType::Float32: return std::is_same_v<T, float>;
+			case Columnar::ColumnType::Bitmask: return std::is_same_v<T, std::uint8_t>;
+		}
+		return false;
+	}
+
+	void validate(const std::string& path) const{
+		const Columnar::FileHeader& h = header();
+		if(std::memcmp(h.magic, Columnar::Magic, sizeof(h.magic)) != 0 || h.version != Columnar::Version){
+			throw std::runtime_error("Not a columnar atomic strain result: " + path);
+		}
+		// Compared against the room left after each offset so that corrupt offsets
+		// near the top of the range cannot wrap around.
+		if(h.columnTableOffset > _file.size() || std::uint64_t(h.numColumns) * sizeof(Columnar::ColumnEntry) > _file.size() - h.columnTableOffset){
+			throw std::runtime_error("Columnar result column table is truncated: " + path);
+		}
+		for(const auto& entry : columns()){
+			if(entry.offset % Columnar::Alignment != 0 || entry.offset > _file.size() || entry.size > _file.size() - entry.offset){
+				throw std::runtime_error("Columnar result column is out of bounds: " + path);
+			}
+		}
+	}
+
+	MappedFile _file;
+};
+
+}
@@ -0,0 +1,22 @@
+#pragma once
+
+#include <volt/atomic_strain_output.h>
+#include <volt/atomic_strain_result.h>
+#include <volt/atomic_strain_file_writer.h>
+
+#include <string>
+
+namespace Volt{
+
+// Writes the selected per-atom fields of a result in the columnar format described
+// in atomic_strain_columnar_format.h. Returns false on I/O errors.
+bool writeColumnarResult(
+	const AtomicStrainResult& result,
+	AtomicStrainField fields,
+	const AtomicStrainEncodingOptions& encoding,
+	bool checksums,
+	const std::string& path,
+	FileWriteMode mode = FileWriteMode::Buffered
+);
+
+}
@@ -0,0 +1,85 @@
+#pragma once
+
+#include <volt/atomic_strain_output.h>
+#include <volt/atomic_strain_result.h>
+
+#include <cstddef>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <nlohmann/json.hpp>
+
+namespace Volt{
+
+// Encodes consecutive frames as a full keyframe every keyframeInterval frames and
+// otherwise only the atoms whose selected fields moved by more than tolerance since
+// the value last written for them. Comparing against the last written value keeps
+// the reconstruction error bounded by tolerance however many deltas follow. Values
+// are written with the output encoding (float32 or quantized integer codes plus
+// "scale"); the strain tensor uses the msgpack component order.
+class AtomicStrainDeltaEncoder{
+public:
+	AtomicStrainDeltaEncoder(std::size_t keyframeInterval, double tolerance);
+
+	nlohmann::json encode(
+		const AtomicStrainResult& result,
+		AtomicStrainField fields,
+		const AtomicStrainEncodingOptions& encoding = {}
+	);
+
+	void reset();
+
+	// Slots held for atoms, live or free for reuse. Bounded by the largest number of
+	// atoms present at once since the last keyframe.
+	std::size_t numSlots() const{
+		return _numSlots;
+	}
+
+private:
+	std::size_t _keyframeInterval;
+	double _tolerance;
+	std::size_t _frame = 0;
+	std::vector<std::string> _fields;
+	std::size_t _stride = 0;
+	AtomicStrainEncoding _encoding = AtomicStrainEncoding::Float64;
+	double _scale = 0.0;
+	std::unordered_map<int, std::size_t> _slots;
+	std::vector<double> _values;
+	std::vector<std::size_t> _freeSlots;
+	std::size_t _numSlots = 0;
+};
+
+// Rebuilds full per-atom state from the records of AtomicStrainDeltaEncoder.
+// Records must be applied in order, starting with a keyframe.
+class AtomicStrainDeltaDecoder{
+public:
+	// Throws std::runtime_error if a delta record arrives without a preceding keyframe,
+	// or if a record's field, component and value counts do not agree.
+	void apply(const nlohmann::json& record);
+
+	const std::vector<std::string>& fields() const{
+		return _fields;
+	}
+
+	const std::vector<std::size_t>& components() const{
+		return _components;
+	}
+
+	// Values of one atom, all fields concatenated in fields() order.
+	const std::unordered_map<int, std::vector<double>>& atoms() const{
+		return _atoms;
+	}
+
+private:
+	bool _hasKeyframe = false;
+	std::vector<std::string> _fields;
+	std::vector<std::size_t> _components;
+	std::size_t _stride = 0;
+	// Quantization step of the current keyframe's values, 0 when not quantized.
+	double _scale = 0.0;
+	// Per component, 1 for flag fields that are never quantized.
+	std::vector<unsigned char> _flags;
+	std::unordered_map<int, std::vector<double>> _atoms;
+};
+
+}
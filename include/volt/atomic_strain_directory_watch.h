@@ -0,0 +1,56 @@
+#pragma once
+
+#include <filesystem>
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace Volt{
+
+class AtomicStrainService;
+
+// Reports files that appear in a directory through inotify: files closed after
+// writing and files moved in, so a dump is reported once it is complete rather than
+// while it is being written. Subdirectories are not watched.
+class AtomicStrainDirectoryWatch{
+public:
+	// Throws std::runtime_error if the directory cannot be watched.
+	explicit AtomicStrainDirectoryWatch(const std::string& directory);
+	~AtomicStrainDirectoryWatch();
+
+	AtomicStrainDirectoryWatch(const AtomicStrainDirectoryWatch&) = delete;
+	AtomicStrainDirectoryWatch& operator=(const AtomicStrainDirectoryWatch&) = delete;
+
+	// Waits up to timeoutMs (-1 without limit) and returns the paths of the files that
+	// appeared, in event order. Returns an empty list on timeout or interruption by a
+	// signal.
+	std::vector<std::string> wait(int timeoutMs);
+
+	const std::string& directory() const{
+		return _directory;
+	}
+
+private:
+	std::string _directory;
+	int _fd = -1;
+};
+
+// Dumps only; results, sidecars and files still being renamed into place are skipped,
+// since they are written into the watched directory as well.
+bool isWatchedDump(const std::filesystem::path& path);
+
+// Analyzes the frames within [first, last] of every dump written into the directory,
+// against the reference the analyzer keeps prepared in memory, and writes the results
+// next to each dump. Polls stopRequested at least once a second and returns once it is
+// true. A dump that fails for any reason, allocation failures and failed output writes
+// included, is reported and skipped; only a failure of the watch itself returns false.
+bool watchDirectory(
+	AtomicStrainService& analyzer,
+	const std::string& directory,
+	long long first,
+	long long last,
+	bool preferUnwrapped,
+	const std::function<bool()>& stopRequested
+);
+
+}
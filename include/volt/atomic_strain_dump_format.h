@@ -0,0 +1,89 @@
+#pragma once
+
+#include <volt/core/volt.h>
+#include <volt/core/simulation_cell.h>
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Pieces of the LAMMPS dump conventions shared by the text and binary readers.
+namespace Volt{
+
+struct DumpColumnLayout{
+	int id = -1;
+	std::array<int, 3> position{ -1, -1, -1 };
+	// Reduced xs/ys/zs style coordinates that still need the cell applied.
+	bool scaled = false;
+
+	int lastUsed() const;
+};
+
+// Picks the identifier and position columns from the column names. Wrapped
+// coordinates are preferred over unwrapped ones unless preferUnwrapped is set (the
+// analysis assumes unwrapped coordinates), absolute over scaled. Throws
+// std::runtime_error when no complete set of position columns exists.
+DumpColumnLayout findDumpColumns(
+	const std::vector<std::string_view>& names,
+	const std::string& path,
+	bool preferUnwrapped = false
+);
+
+// Builds the cell from dump box bounds. For triclinic cells the bounds describe the
+// bounding box of the tilted cell, which is undone here.
+SimulationCell makeDumpCell(
+	const double lo[3],
+	const double hi[3],
+	const double tilt[3],
+	const std::array<bool, 3>& pbc
+);
+
+// Builds the cell of a general triclinic dump from its edge vectors A, B, C and its
+// origin, all in the frame the positions are given in.
+SimulationCell makeGeneralDumpCell(
+	const double edges[3][3],
+	const double origin[3],
+	const std::array<bool, 3>& pbc
+);
+
+// Converts reduced to absolute coordinates in place.
+void unscaleDumpPositions(double* positions, std::size_t natoms, const SimulationCell& cell);
+
+// Size and modification time of a dump, recorded by the sidecar files derived from
+// it to detect that the dump has changed since.
+struct DumpStamp{
+	std::uint64_t size = 0;
+	// Nanoseconds since the epoch.
+	std::int64_t modified = 0;
+
+	bool operator==(const DumpStamp&) const = default;
+};
+
+// Throws std::runtime_error if the file cannot be examined.
+DumpStamp stampDump(const std::string& path);
+
+// The cell as the binary sidecars and results store it: a row-major 3x4 matrix (three
+// cell vectors followed by the origin column) and a 0/1 flag per periodic direction.
+std::array<double, 12> cellToArray(const SimulationCell& cell);
+void cellToArray(const SimulationCell& cell, double (&matrix)[12], std::uint32_t (&pbc)[3]);
+SimulationCell cellFromArray(const double (&matrix)[12], const std::uint32_t (&pbc)[3]);
+
+// Timestep, atom count and cell of one frame, the common part of the frame index
+// entries and the snapshot frame table.
+struct FrameRecord{
+	std::int64_t timestep;
+	std::uint64_t natoms;
+	double cell[12];
+	std::uint32_t pbc[3];
+	// Meaning left to the format; zero where unused.
+	std::uint32_t flags;
+};
+
+static_assert(sizeof(FrameRecord) == 128, "Unexpected frame record layout");
+
+FrameRecord makeFrameRecord(std::int64_t timestep, std::uint64_t natoms, const SimulationCell& cell);
+
+}
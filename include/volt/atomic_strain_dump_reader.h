@@ -0,0 +1,84 @@
+#pragma once
+
+#include <volt/atomic_strain_frame_reader.h>
+#include <volt/atomic_strain_mapped_file.h>
+#include <volt/atomic_strain_byte_source.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace Volt{
+
+// Text LAMMPS dump reader working on a read-only memory mapping of the file. The
+// ATOMS section is cut into newline-aligned chunks whose lines are counted first,
+// then all chunks are parsed concurrently with std::from_chars straight into the
+// property buffers of the frame. Frames are read in file order; malformed input
+// throws std::runtime_error. preferUnwrapped selects xu/yu/zu over x/y/z when a dump
+// has both, see findDumpColumns().
+class AtomicStrainDumpReader : public AtomicStrainFrameReader{
+public:
+	explicit AtomicStrainDumpReader(const std::string& path, bool preferUnwrapped = false);
+
+	AtomicStrainDumpReader(const AtomicStrainDumpReader&) = delete;
+	AtomicStrainDumpReader& operator=(const AtomicStrainDumpReader&) = delete;
+
+	bool readFrame(AtomicStrainFrame& frame) override;
+	bool skipFrame(AtomicStrainFrameInfo& info) override;
+
+	bool seekable() const override{
+		return true;
+	}
+
+	void seek(std::uint64_t offset) override;
+
+	// Byte offset of the next frame.
+	std::size_t offset() const{
+		return _offset;
+	}
+
+	std::size_t size() const{
+		return _file.size();
+	}
+
+private:
+	std::string _path;
+	MappedFile _file;
+	std::size_t _offset = 0;
+	bool _preferUnwrapped;
+};
+
+// Text dump reader over a sequential byte stream such as decompressed .gz/.zst
+// input. Atom lines are collected in large buffered regions which are split and
+// parsed in parallel like the mapped reader does.
+class AtomicStrainDumpStreamReader : public AtomicStrainFrameReader{
+public:
+	// name is only used in error messages.
+	AtomicStrainDumpStreamReader(std::unique_ptr<ByteSource> source, std::string name, bool preferUnwrapped = false);
+
+	bool readFrame(AtomicStrainFrame& frame) override;
+	bool skipFrame(AtomicStrainFrameInfo& info) override;
+
+private:
+	struct Lines;
+
+	// Appends the next piece of the stream to the buffer. Returns false at the end.
+	bool fill();
+	// Fills until the buffer holds the given number of complete lines or a full
+	// parse region, whichever comes first.
+	void fillAtomLines(std::size_t lines);
+
+	std::unique_ptr<ByteSource> _source;
+	std::string _name;
+	bool _preferUnwrapped;
+	std::vector<char> _buffer;
+	std::size_t _begin = 0;
+	std::size_t _end = 0;
+	// Stream position of _buffer[0].
+	std::uint64_t _bufferOffset = 0;
+	bool _eof = false;
+};
+
+}
@@ -0,0 +1,31 @@
+#pragma once
+
+#include <volt/atomic_strain_output.h>
+#include <volt/atomic_strain_result.h>
+#include <volt/atomic_strain_file_writer.h>
+
+#include <cstddef>
+#include <string>
+
+namespace Volt{
+
+// Output buffer of the dump writer and the rows formatted as one chunk.
+inline constexpr std::size_t DumpWriterBufferSize = 32u << 20;
+inline constexpr std::size_t DumpWriterChunkRows = 1u << 14;
+
+// Formatted chunks the dump writer keeps in flight on the current task arena.
+std::size_t dumpWriterChunksInFlight();
+
+// Writes the result as a LAMMPS text dump with columns id, x, y, z followed by the
+// selected strain fields. Rows are formatted in chunks on the TBB arena, or one
+// chunk after another on the calling thread with serial. Returns false on I/O errors.
+bool writeLammpsDumpResult(
+	const AtomicStrainResult& result,
+	AtomicStrainField fields,
+	const AtomicStrainEncodingOptions& encoding,
+	const std::string& path,
+	FileWriteMode mode = FileWriteMode::Buffered,
+	bool serial = false
+);
+
+}
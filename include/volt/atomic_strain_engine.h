@@ -10,7 +10,7 @@
 
 namespace Volt{
 
-class CutoffNeighborFinder;
+class AtomicStrainPreparedReference;
 
 class AtomicStrainModifier{
 public:
@@ -31,8 +31,26 @@ public:
 			bool calculateNonaffineSquaredDisplacements
 		);
 
+		// Per-atom shear/volumetric/invalid buffers are only allocated when requested.
+		// The summary statistics below are always accumulated.
+		void setOutputProperties(bool shearStrains, bool volumetricStrains, bool invalidParticles);
+
+		// Reuses identifier order, neighbor lists and V^-1 prepared for this reference,
+		// cutoff and the periodicity of the current cell instead of deriving them again.
+		// Ignored if its atom count or cutoff do not match.
+		void setPreparedReference(std::shared_ptr<const AtomicStrainPreparedReference> prepared);
+
 		void perform();
 
+		// Below this many atoms, spreading one frame over threads costs more in
+		// scheduling than it saves; such frames are better run side by side.
+		static constexpr std::size_t ParallelAtomThreshold = 20000;
+
+		// Runs the per-atom kernel and identifier sorts on the calling thread.
+		void setSerial(bool serial){
+			_serial = serial;
+		}
+
 		std::shared_ptr<Particles::ParticleProperty> shearStrains() const{
 			return _shearStrains;
 		}
@@ -57,10 +75,33 @@ public:
 			return _deformationGradients;
 		}
 
+		// Current-frame particle indices sorted by identifier. Null if the engine was
+		// created without identifiers, in which case frame order is already canonical.
+		std::shared_ptr<const std::vector<std::size_t>> identifierOrder() const{
+			return _identifierOrder;
+		}
+
+		// Reference index of every current particle, -1 where no counterpart exists.
+		std::shared_ptr<const std::vector<int>> currentToReferenceIndices() const{
+			return _currentToReferenceIndices;
+		}
+
 		std::size_t numInvalidParticles() const{
 			return _numInvalidParticles.load(std::memory_order_relaxed);
 		}
 
+		double totalShearStrain() const{
+			return _totalShearStrain;
+		}
+
+		double totalVolumetricStrain() const{
+			return _totalVolumetricStrain;
+		}
+
+		double maxShearStrain() const{
+			return _maxShearStrain;
+		}
+
 	private:
 		Particles::ParticleProperty* positions() const{
 			return _positions;
@@ -82,11 +123,16 @@ public:
 			return _simCellRef;
 		}
 
+		// Neighbors visits the reference neighbors of an atom, either through a neighbor
+		// finder or from the prepared reference.
+		template<typename Neighbors>
 		bool computeStrain(
 			std::size_t particleIndex,
-			CutoffNeighborFinder& neighborFinder,
+			const Neighbors& neighbors,
 			const std::vector<int>& refToCurrentIndexMap,
-			const std::vector<int>& currentToRefIndexMap
+			const std::vector<int>& currentToRefIndexMap,
+			double& shearStrain,
+			double& volumetricStrain
 		);
 
 		Particles::ParticleProperty* _positions;
@@ -106,6 +152,15 @@ public:
 		bool _calculateDeformationGradients;
 		bool _calculateStrainTensors;
 		bool _calculateNonaffineSquaredDisplacements;
+		bool _outputShearStrains = true;
+		bool _outputVolumetricStrains = true;
+		bool _outputInvalidParticles = true;
+		bool _serial = false;
+		// Every reference atom has a current counterpart, so V over the matched
+		// neighbors equals the prepared V over all neighbors.
+		bool _allReferenceMatched = false;
+
+		std::shared_ptr<const AtomicStrainPreparedReference> _preparedReference;
 
 		std::shared_ptr<Particles::ParticleProperty> _shearStrains;
 		std::shared_ptr<Particles::ParticleProperty> _volumetricStrains;
@@ -114,7 +169,13 @@ public:
 		std::shared_ptr<Particles::ParticleProperty> _strainTensors;
 		std::shared_ptr<Particles::ParticleProperty> _deformationGradients;
 
+		std::shared_ptr<const std::vector<std::size_t>> _identifierOrder;
+		std::shared_ptr<const std::vector<int>> _currentToReferenceIndices;
+
 		std::atomic<std::size_t> _numInvalidParticles{0};
+		double _totalShearStrain = 0.0;
+		double _totalVolumetricStrain = 0.0;
+		double _maxShearStrain = 0.0;
 	};
 };
 
@@ -0,0 +1,95 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace Volt{
+
+enum class FileWriteMode{
+	Buffered,
+	// O_DIRECT with aligned blocks written concurrently by a small pool of pwrite
+	// threads. Bypasses the page cache; falls back to buffered writes where the
+	// filesystem refuses O_DIRECT.
+	Direct
+};
+
+// Large-buffer sequential writer used by the binary and text result writers.
+// All operations return false once an I/O error has occurred.
+class BufferedFileWriter{
+public:
+	static constexpr std::size_t DefaultBufferSize = 8u << 20;
+
+	explicit BufferedFileWriter(std::size_t bufferSize = DefaultBufferSize, FileWriteMode mode = FileWriteMode::Buffered);
+	~BufferedFileWriter();
+
+	BufferedFileWriter(const BufferedFileWriter&) = delete;
+	BufferedFileWriter& operator=(const BufferedFileWriter&) = delete;
+
+	// sizeHint is the expected file size, 0 when unknown; buffers are not made larger
+	// than needed for it.
+	bool open(const std::string& path, std::uint64_t sizeHint = 0);
+	bool write(const void* data, std::size_t size);
+	// Writes zero bytes until offset() is a multiple of alignment.
+	bool writePadding(std::size_t alignment);
+	// Overwrites already written bytes, e.g. to patch a header after the payload.
+	bool writeAt(std::uint64_t offset, const void* data, std::size_t size);
+	bool flush();
+	bool close();
+
+	std::uint64_t offset() const{
+		return _offset;
+	}
+
+	bool good() const{
+		return _fd >= 0 && !_failed;
+	}
+
+private:
+	struct DirectBlock;
+
+	bool writeFully(const void* data, std::size_t size);
+	static bool pwriteFully(int fd, const void* data, std::size_t size, std::uint64_t offset);
+	static bool preadFully(int fd, void* data, std::size_t size, std::uint64_t offset);
+
+	bool openDirect(const std::string& path);
+	bool submitDirectBlock();
+	bool waitDirectBlock(DirectBlock& block);
+	bool drainDirectBlocks();
+	bool patchDirect(std::uint64_t offset, const void* data, std::size_t size);
+	bool closeDirect();
+	void startIoThreads();
+	void stopIoThreads();
+	void runIoThread();
+
+	int _fd = -1;
+	bool _failed = false;
+	std::uint64_t _offset = 0;
+	std::vector<char> _buffer;
+	std::size_t _buffered = 0;
+
+	FileWriteMode _requestedMode;
+	FileWriteMode _mode;
+	std::size_t _bufferSize;
+	std::size_t _blockSize = 0;
+	// Allocated on demand, at most DirectBlocksInFlight.
+	std::vector<std::unique_ptr<DirectBlock>> _blocks;
+	std::size_t _currentBlock = 0;
+	// File offset of the first byte of the current, not yet submitted block.
+	std::uint64_t _blockOffset = 0;
+
+	std::vector<std::thread> _ioThreads;
+	std::deque<DirectBlock*> _submitted;
+	bool _stopIo = false;
+	std::mutex _ioMutex;
+	std::condition_variable _ioAvailable;
+	std::condition_variable _ioDone;
+};
+
+}
@@ -0,0 +1,28 @@
+#pragma once
+
+#include <volt/core/volt.h>
+#include <volt/core/simulation_cell.h>
+#include <volt/core/particle_property.h>
+#include <volt/core/lammps_parser.h>
+
+#include <cstddef>
+#include <memory>
+
+namespace Volt{
+
+// Frame data in the form the atomic strain engine consumes. Readers fill the
+// property buffers directly, so per-atom data is not copied again between parsing
+// and the engine.
+struct AtomicStrainFrame{
+	long long timestep = 0;
+	std::size_t natoms = 0;
+	SimulationCell simulationCell;
+	std::shared_ptr<Particles::ParticleProperty> positions;
+	// Null when the input has no identifiers; atoms are then matched by index.
+	std::shared_ptr<Particles::ParticleProperty> identifiers;
+
+	// Wraps a frame parsed by LammpsParser.
+	static AtomicStrainFrame fromLammpsFrame(const LammpsParser::Frame& frame);
+};
+
+}
@@ -0,0 +1,97 @@
+#pragma once
+
+#include <volt/atomic_strain_frame_reader.h>
+#include <volt/atomic_strain_dump_format.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace Volt{
+
+// Sidecar layout of a frame index, stored next to the dump as "<dump>.vfix". The
+// header records size and modification time of the dump it was built from; a
+// sidecar that no longer matches is ignored and rebuilt.
+namespace FrameIndex{
+
+inline constexpr char Magic[8] = { 'V', 'O', 'L', 'T', 'F', 'I', 'X', '1' };
+inline constexpr std::uint32_t Version = 2;
+inline constexpr const char* Extension = ".vfix";
+
+struct FileHeader{
+	char magic[8];
+	std::uint32_t version;
+	std::uint32_t reserved;
+	std::uint64_t dumpSize;
+	// Modification time of the dump in nanoseconds since the epoch.
+	std::int64_t dumpModified;
+	std::uint64_t numFrames;
+};
+
+struct Entry{
+	FrameRecord frame;
+	// Byte offset of the frame in the dump.
+	std::uint64_t offset;
+};
+
+static_assert(sizeof(FileHeader) == 40, "Unexpected frame index header layout");
+static_assert(sizeof(Entry) == 136, "Unexpected frame index entry layout");
+
+}
+
+// Timestep, byte offset, atom count and box of every frame of an uncompressed text
+// or binary dump, built in one scan over the frame headers. Frames can then be read
+// directly by offset, and by several threads at once since every read maps the file
+// through its own reader.
+class AtomicStrainFrameIndex{
+public:
+	// Scans the dump. Throws std::runtime_error for malformed or compressed input,
+	// which cannot be seeked.
+	static AtomicStrainFrameIndex build(const std::string& dumpPath);
+
+	// Loads the sidecar of the dump if it is up to date, otherwise builds the index
+	// and, with persist, writes the sidecar for the next run. preferUnwrapped is
+	// passed to the readers of readFrame(), see openDumpReader().
+	static AtomicStrainFrameIndex open(const std::string& dumpPath, bool persist, bool preferUnwrapped = false);
+
+	// Returns std::nullopt if the sidecar is missing, stale or malformed.
+	static std::optional<AtomicStrainFrameIndex> load(const std::string& dumpPath);
+
+	// Returns false on I/O errors.
+	bool save() const;
+
+	const std::string& dumpPath() const{
+		return _dumpPath;
+	}
+
+	const std::vector<AtomicStrainFrameInfo>& frames() const{
+		return _frames;
+	}
+
+	// First frame with the given timestep, nullptr if there is none.
+	const AtomicStrainFrameInfo* find(long long timestep) const;
+
+	// Frames with first <= timestep <= last, in file order.
+	std::vector<AtomicStrainFrameInfo> range(long long first, long long last) const;
+
+	AtomicStrainFrame readFrame(const AtomicStrainFrameInfo& info) const;
+
+	// Reads the frames concurrently, at most maxInFlight at a time, and hands them to
+	// consume one by one in the given order, so consume may depend on frame order.
+	void forEachFrame(
+		const std::vector<AtomicStrainFrameInfo>& frames,
+		std::size_t maxInFlight,
+		const std::function<void(AtomicStrainFrame&)>& consume
+	) const;
+
+private:
+	std::string _dumpPath;
+	DumpStamp _dumpStamp;
+	std::vector<AtomicStrainFrameInfo> _frames;
+	bool _preferUnwrapped = false;
+};
+
+}
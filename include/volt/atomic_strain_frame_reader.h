@@ -0,0 +1,54 @@
+#pragma once
+
+#include <volt/atomic_strain_frame.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+namespace Volt{
+
+// Where a frame starts in its file and what its header says, without the atoms.
+struct AtomicStrainFrameInfo{
+	long long timestep = 0;
+	std::uint64_t offset = 0;
+	std::size_t natoms = 0;
+	SimulationCell simulationCell;
+};
+
+// Sequential source of frames. Implementations throw std::runtime_error on
+// malformed input.
+class AtomicStrainFrameReader{
+public:
+	virtual ~AtomicStrainFrameReader() = default;
+
+	// Reads the next frame. Returns false once the input is exhausted.
+	virtual bool readFrame(AtomicStrainFrame& frame) = 0;
+
+	// Reads only the header of the next frame and steps over its atom data. Returns
+	// false once the input is exhausted.
+	virtual bool skipFrame(AtomicStrainFrameInfo& info) = 0;
+
+	// Readers over a memory mapping can jump to any frame offset reported by
+	// skipFrame(); streaming readers only move forward and throw from seek().
+	virtual bool seekable() const{
+		return false;
+	}
+
+	virtual void seek(std::uint64_t offset);
+};
+
+// Opens a dump with the reader matching its content: gzip and zstd input is
+// decompressed on the fly into the streaming text reader, snapshots are recognized
+// by their magic, text dumps start with "ITEM:", everything else is treated as a
+// LAMMPS binary dump. preferUnwrapped makes the dump readers take xu/yu/zu over x/y/z
+// columns; snapshots hold the positions chosen when they were converted.
+std::unique_ptr<AtomicStrainFrameReader> openDumpReader(const std::string& path, bool preferUnwrapped = false);
+
+// Reads text dump frames from standard input ("-"), a pipe or a FIFO while they are
+// written, e.g. by a running simulation. Nothing is read ahead of the frame being
+// returned, and readFrame() blocks until the next frame is complete.
+std::unique_ptr<AtomicStrainFrameReader> openStreamReader(const std::string& path, bool preferUnwrapped = false);
+
+}
@@ -0,0 +1,29 @@
+#pragma once
+
+#include <volt/atomic_strain_frame.h>
+#include <volt/atomic_strain_frame_reader.h>
+
+#include <string>
+
+namespace Volt{
+
+// Frame loading shared by the single-frame, batch and timestep-range runs. Except for
+// peekFrame(), failures are logged and reported by returning false.
+
+// Prefers an up-to-date snapshot converted from the dump over parsing it. Returns the
+// path unchanged without useSnapshot.
+std::string resolveInput(const std::string& path, bool useSnapshot, bool preferUnwrapped);
+
+// Reads the first frame of a text or binary dump through the memory-mapped readers
+// and falls back to LammpsParser for input they cannot handle.
+bool loadFrame(const std::string& path, bool useMmap, bool preferUnwrapped, AtomicStrainFrame& frame);
+
+// Reads the frame with the given timestep: through the frame index for seekable
+// dumps, frame by frame for compressed ones.
+bool loadTimestep(const std::string& path, long long timestep, bool persistIndex, bool preferUnwrapped, AtomicStrainFrame& frame);
+
+// Atom count and cell of the first frame, read from its header without parsing atom
+// lines. Throws std::runtime_error if the input cannot be read or holds no frame.
+AtomicStrainFrameInfo peekFrame(const std::string& path);
+
+}
@@ -0,0 +1,117 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <utility>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace Volt{
+
+// Read-only memory mapping of a whole file, unmapped on destruction. The descriptor
+// is closed right after mapping. An empty file maps to no data. Header-only, like the
+// result readers that hold one.
+class MappedFile{
+public:
+	enum class Access{
+		Random,
+		// Read front to back once; the kernel reads ahead more aggressively.
+		Sequential
+	};
+
+	MappedFile() = default;
+
+	// Throws std::runtime_error naming the file as what, e.g. "LAMMPS dump", if it
+	// cannot be opened or mapped.
+	MappedFile(const std::string& path, std::string_view what, Access access = Access::Random){
+		if(const char* failed = map(path, access)){
+			throw std::runtime_error("Cannot " + std::string(failed) + " " + std::string(what) + ": " + path);
+		}
+	}
+
+	~MappedFile(){
+		unmap();
+	}
+
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+
+	MappedFile(MappedFile&& other) noexcept
+		: _data(std::exchange(other._data, nullptr)), _size(std::exchange(other._size, 0)){}
+
+	MappedFile& operator=(MappedFile&& other) noexcept{
+		if(this != &other){
+			unmap();
+			_data = std::exchange(other._data, nullptr);
+			_size = std::exchange(other._size, 0);
+		}
+		return *this;
+	}
+
+	// Returns false instead of throwing, for callers that treat a missing or
+	// unreadable file as absent.
+	bool open(const std::string& path, Access access = Access::Random){
+		unmap();
+		return map(path, access) == nullptr;
+	}
+
+	template<typename T = char>
+	const T* data() const{
+		return reinterpret_cast<const T*>(_data);
+	}
+
+	std::size_t size() const{
+		return _size;
+	}
+
+	// Asks the kernel to read [offset, offset + size) ahead of use.
+	void willNeed(std::size_t offset, std::size_t size) const{
+		if(!_data || offset >= _size) return;
+		const std::size_t page = static_cast<std::size_t>(::sysconf(_SC_PAGESIZE));
+		const std::size_t begin = offset / page * page;
+		::madvise(const_cast<char*>(_data) + begin, std::min(size, _size - offset) + (offset - begin), MADV_WILLNEED);
+	}
+
+private:
+	// Returns the step that failed, or nullptr once mapped.
+	const char* map(const std::string& path, Access access){
+		const int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+		if(fd < 0) return "open";
+
+		struct stat st{};
+		if(::fstat(fd, &st) != 0){
+			::close(fd);
+			return "stat";
+		}
+		const std::size_t size = static_cast<std::size_t>(st.st_size);
+		if(size > 0){
+			void* mapping = ::mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+			if(mapping == MAP_FAILED){
+				::close(fd);
+				return "map";
+			}
+			if(access == Access::Sequential) ::madvise(mapping, size, MADV_SEQUENTIAL);
+			_data = static_cast<const char*>(mapping);
+		}
+		_size = size;
+		::close(fd);
+		return nullptr;
+	}
+
+	void unmap(){
+		if(_data) ::munmap(const_cast<char*>(_data), _size);
+		_data = nullptr;
+		_size = 0;
+	}
+
+	const char* _data = nullptr;
+	std::size_t _size = 0;
+};
+
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <volt/core/volt.h>
+
+#include <algorithm>
+#include <cstdint>
+
+namespace Volt::Morton{
+
+inline constexpr unsigned MaxBitsPerAxis = 21;
+
+// Inserts two zero bits between each of the lower 21 bits of v.
+inline constexpr std::uint64_t spreadBits(std::uint64_t v){
+	v &= 0x1fffff;
+	v = (v | (v << 32)) & 0x1f00000000ffffull;
+	v = (v | (v << 16)) & 0x1f0000ff0000ffull;
+	v = (v | (v << 8)) & 0x100f00f00f00f00full;
+	v = (v | (v << 4)) & 0x10c30c30c30c30c3ull;
+	v = (v | (v << 2)) & 0x1249249249249249ull;
+	return v;
+}
+
+inline constexpr std::uint64_t encode(std::uint32_t x, std::uint32_t y, std::uint32_t z){
+	return spreadBits(x) | (spreadBits(y) << 1) | (spreadBits(z) << 2);
+}
+
+// Axis-aligned box quantized to 2^bits cells per axis.
+struct Grid{
+	double origin[3];
+	double cellSize[3];
+	unsigned bits;
+
+	std::uint32_t cellCoordinate(double value, std::size_t axis) const{
+		const double maxCell = static_cast<double>((1u << bits) - 1);
+		const double cell = cellSize[axis] > 0.0 ? (value - origin[axis]) / cellSize[axis] : 0.0;
+		return static_cast<std::uint32_t>(std::clamp(cell, 0.0, maxCell));
+	}
+
+	std::uint64_t code(const Point3& p) const{
+		return encode(cellCoordinate(p.x(), 0), cellCoordinate(p.y(), 1), cellCoordinate(p.z(), 2));
+	}
+};
+
+inline Grid makeGrid(const double boundsMin[3], const double boundsMax[3], unsigned bits){
+	Grid grid{};
+	grid.bits = std::min(bits, MaxBitsPerAxis);
+	const double cells = static_cast<double>(1u << grid.bits);
+	for(std::size_t k = 0; k < 3; ++k){
+		grid.origin[k] = boundsMin[k];
+		grid.cellSize[k] = (boundsMax[k] - boundsMin[k]) / cells;
+	}
+	return grid;
+}
+
+}
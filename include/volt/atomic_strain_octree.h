@@ -0,0 +1,74 @@
+#pragma once
+
+#include <volt/atomic_strain_result.h>
+#include <volt/atomic_strain_file_writer.h>
+
+#include <cstdint>
+#include <string>
+
+namespace Volt{
+
+// Level-of-detail octree over the reference positions. The file holds a Header, a
+// LevelEntry per level (root first), all nodes in breadth-first order and finally
+// the points sorted by leaf cell. A viewer can read the first levels with a single
+// small read and refine by fetching child node ranges, and finally the contiguous
+// point range of a node.
+namespace Octree{
+
+inline constexpr char Magic[8] = { 'V', 'O', 'L', 'T', 'O', 'C', 'T', '1' };
+inline constexpr std::uint32_t Version = 1;
+
+struct Header{
+	char magic[8];
+	std::uint32_t version;
+	std::uint32_t numLevels;
+	std::uint64_t numNodes;
+	std::uint64_t numPoints;
+	double boundsMin[3];
+	double boundsMax[3];
+	std::uint64_t levelTableOffset;
+	std::uint64_t nodeOffset;
+	std::uint64_t pointOffset;
+};
+
+struct LevelEntry{
+	std::uint64_t firstNode;
+	std::uint64_t numNodes;
+};
+
+struct Node{
+	// Morton code of the node cell at its own level.
+	std::uint64_t code;
+	std::uint64_t firstPoint;
+	std::uint32_t count;
+	std::uint32_t level;
+	std::uint32_t firstChild;
+	std::uint32_t numChildren;
+	float meanShear;
+	float maxShear;
+};
+
+struct Point{
+	std::int32_t id;
+	float position[3];
+	float shearStrain;
+};
+
+static_assert(sizeof(Header) == 104, "Unexpected octree header layout");
+static_assert(sizeof(Node) == 40, "Unexpected octree node layout");
+static_assert(sizeof(Point) == 20, "Unexpected octree point layout");
+
+}
+
+// Builds the octree from the shear strains of the result. maxDepth 0 selects a depth
+// that leaves roughly 64 points per leaf. With serial the tree is built on the calling
+// thread. Returns false if the result carries no shear strains or on I/O errors.
+bool writeOctreeResult(
+	const AtomicStrainResult& result,
+	unsigned maxDepth,
+	const std::string& path,
+	FileWriteMode mode = FileWriteMode::Buffered,
+	bool serial = false
+);
+
+}
@@ -0,0 +1,106 @@
+#pragma once
+
+#include <volt/atomic_strain_file_writer.h>
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+namespace Volt{
+
+// Per-atom fields that can be requested in the analysis output.
+enum class AtomicStrainField : std::uint32_t{
+	None = 0,
+	ShearStrain = 1u << 0,
+	VolumetricStrain = 1u << 1,
+	StrainTensor = 1u << 2,
+	DeformationGradient = 1u << 3,
+	D2min = 1u << 4,
+	Invalid = 1u << 5,
+	All = (1u << 6) - 1
+};
+
+constexpr AtomicStrainField operator|(AtomicStrainField a, AtomicStrainField b){
+	return static_cast<AtomicStrainField>(static_cast<std::uint32_t>(a) | static_cast<std::uint32_t>(b));
+}
+
+constexpr AtomicStrainField operator&(AtomicStrainField a, AtomicStrainField b){
+	return static_cast<AtomicStrainField>(static_cast<std::uint32_t>(a) & static_cast<std::uint32_t>(b));
+}
+
+constexpr bool hasField(AtomicStrainField fields, AtomicStrainField field){
+	return (fields & field) != AtomicStrainField::None;
+}
+
+// Parses a comma separated list such as "shear,d2min". Throws std::invalid_argument
+// on unknown field names.
+AtomicStrainField parseAtomicStrainFields(std::string_view list);
+
+std::string atomicStrainFieldsToString(AtomicStrainField fields);
+
+// Component order of the strain tensor in every output format (xx, yy, zz, xy, xz, yz),
+// given as indices into the engine's strain tensor property (xx, yy, zz, yz, xz, xy).
+inline constexpr std::array<std::uint32_t, 6> StrainTensorOutputOrder{ 0, 1, 2, 5, 4, 3 };
+
+// Numeric encoding of per-atom values in the written output.
+enum class AtomicStrainEncoding{
+	Float64,
+	Float32,
+	// Fixed-point integers with a step of twice the absolute error bound.
+	Quantized
+};
+
+struct AtomicStrainEncodingOptions{
+	AtomicStrainEncoding encoding = AtomicStrainEncoding::Float64;
+	double errorBound = 0.0;
+	// Pack the per-atom invalid flags into a single bitmask instead of one boolean per atom.
+	bool invalidBitmask = false;
+
+	double quantizationStep() const{
+		return 2.0 * errorBound;
+	}
+};
+
+// Throws std::invalid_argument on unknown encoding names.
+AtomicStrainEncoding parseAtomicStrainEncoding(std::string_view name);
+
+std::string_view atomicStrainEncodingName(AtomicStrainEncoding encoding);
+
+// Format of the per-atom output file.
+enum class AtomicStrainOutputFormat{
+	Msgpack,
+	// Memory-mappable column store, see atomic_strain_columnar_format.h.
+	Columnar,
+	// LAMMPS text dump with the strain fields as extra per-atom columns.
+	LammpsDump,
+	// Keyframes plus per-frame changes, stored as "per-atom-delta" in the msgpack file.
+	Delta,
+	// Level-of-detail octree over the reference positions, see atomic_strain_octree.h.
+	Octree
+};
+
+// Throws std::invalid_argument on unknown format names.
+AtomicStrainOutputFormat parseAtomicStrainOutputFormat(std::string_view name);
+
+// Complete output configuration for one result. Writers receive a copy, so queued
+// asynchronous writes are unaffected by later configuration changes.
+struct AtomicStrainOutputOptions{
+	AtomicStrainField fields = AtomicStrainField::All;
+	AtomicStrainEncodingOptions encoding;
+	AtomicStrainOutputFormat format = AtomicStrainOutputFormat::Msgpack;
+	bool columnChecksums = false;
+	bool summaryOnly = false;
+	FileWriteMode writeMode = FileWriteMode::Buffered;
+	// Number of files the per-atom columnar/dump output is split into.
+	std::size_t shards = 1;
+	// Octree format: maximum depth, 0 selects one from the number of atoms.
+	unsigned octreeDepth = 0;
+	// Rows per block of the Morton spatial index, 0 when rows are not Morton ordered.
+	std::size_t spatialBlockSize = 0;
+	// Writes on the calling thread; set for frames analyzed side by side.
+	bool serial = false;
+};
+
+}
@@ -0,0 +1,34 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <functional>
+#include <tbb/blocked_range.h>
+#include <tbb/parallel_for.h>
+#include <tbb/parallel_sort.h>
+
+namespace Volt{
+
+// Loops of the result assembly and output writers. Frames below the parallel atom
+// threshold are analyzed side by side, one task each; their loops run on the calling
+// thread with serial set instead of spawning nested TBB work.
+
+template<typename Body>
+void parallelFor(const tbb::blocked_range<std::size_t>& range, bool serial, const Body& body){
+	if(serial){
+		body(range);
+	}else{
+		tbb::parallel_for(range, body);
+	}
+}
+
+template<typename Iterator, typename Compare = std::less<>>
+void parallelSort(Iterator begin, Iterator end, bool serial, const Compare& compare = Compare()){
+	if(serial){
+		std::sort(begin, end, compare);
+	}else{
+		tbb::parallel_sort(begin, end, compare);
+	}
+}
+
+}
@@ -0,0 +1,199 @@
+#pragma once
+
+#include <volt/core/volt.h>
+#include <volt/core/simulation_cell.h>
+#include <volt/core/particle_property.h>
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <span>
+#include <string>
+
+namespace Volt{
+
+// On-disk layout of a prepared reference cache file "<key>.vref". Arrays follow the
+// header in the order of their offsets, each at a multiple of Alignment.
+namespace PreparedReference{
+
+inline constexpr char Magic[8] = { 'V', 'O', 'L', 'T', 'R', 'E', 'F', '1' };
+inline constexpr std::uint32_t Version = 2;
+inline constexpr std::uint64_t Alignment = 64;
+inline constexpr const char* Extension = ".vref";
+// Subdirectory of /dev/shm used by --shared-reference.
+inline constexpr const char* SharedDirectoryName = "volt-atomic-strain";
+// Reference atoms stored verbatim to confirm a cache hit beyond the 64-bit key.
+inline constexpr std::uint64_t MaxSamples = 64;
+
+enum HeaderFlags : std::uint32_t{
+	HasIdentifierOrder = 1u << 0
+};
+
+struct FileHeader{
+	char magic[8];
+	std::uint32_t version;
+	std::uint32_t flags;
+	std::uint64_t key;
+	std::uint64_t numAtoms;
+	std::uint64_t numNeighbors;
+	double cutoff;
+	// numAtoms 64-bit reference indices in ascending identifier order.
+	std::uint64_t identifierOrderOffset;
+	// numAtoms + 1 uint64 CSR row offsets into the neighbor arrays.
+	std::uint64_t neighborOffsetsOffset;
+	// numNeighbors int32 reference indices.
+	std::uint64_t neighborsOffset;
+	// numNeighbors x 3 doubles, the minimum image vector r0 to each neighbor.
+	std::uint64_t deltasOffset;
+	// numAtoms x 9 doubles, row-major inverse of V = sum r0 r0^T over all neighbors.
+	std::uint64_t inverseVOffset;
+	// numAtoms bytes, 0 where V is singular.
+	std::uint64_t invertibleOffset;
+	// Row-major 3x4 matrix of the reference cell.
+	double cell[12];
+	// numSamples Sample records of the atoms sampleAtom(k, numAtoms, numSamples).
+	std::uint64_t samplesOffset;
+	std::uint64_t numSamples;
+};
+
+struct Sample{
+	double position[3];
+	// -1 when the reference has no identifiers.
+	std::int64_t identifier;
+};
+
+static_assert(sizeof(FileHeader) == 208, "Unexpected prepared reference header layout");
+static_assert(sizeof(Sample) == 32, "Unexpected prepared reference sample layout");
+
+inline std::uint64_t numSamples(std::uint64_t numAtoms){
+	return numAtoms < MaxSamples ? numAtoms : MaxSamples;
+}
+
+// Reference atoms spread evenly over the index range.
+inline std::uint64_t sampleAtom(std::uint64_t k, std::uint64_t numAtoms, std::uint64_t numSamples){
+	return numSamples == 0 ? 0 : k * numAtoms / numSamples;
+}
+static_assert(sizeof(std::size_t) == sizeof(std::uint64_t), "Identifier order is mapped as std::size_t");
+
+}
+
+// Everything the engine derives from the reference configuration alone: the
+// identifier order used for matching, the neighbor lists within the cutoff with
+// their r0 vectors, and V^-1 per atom. Built once, optionally stored in a cache
+// directory under a key hashing the reference content, cutoff and periodicity, and
+// memory mapped by later runs instead of being rebuilt.
+class AtomicStrainPreparedReference{
+public:
+	// Hash of the reference positions, identifiers and cell, computed blockwise in
+	// parallel. Combine with key() before use as a cache key.
+	static std::uint64_t contentHash(
+		const Particles::ParticleProperty& positions,
+		const Particles::ParticleProperty* identifiers,
+		const SimulationCell& cell
+	);
+
+	static std::uint64_t key(std::uint64_t contentHash, double cutoff, const std::array<bool, 3>& pbc);
+
+	// The cell must already carry the periodicity the engine uses. Throws
+	// std::runtime_error for duplicate identifiers or if no neighbor lists can be built.
+	static std::shared_ptr<const AtomicStrainPreparedReference> build(
+		Particles::ParticleProperty* positions,
+		const Particles::ParticleProperty* identifiers,
+		const SimulationCell& cell,
+		double cutoff,
+		std::uint64_t key
+	);
+
+	// Maps a cache file. Returns null if it is missing, malformed or was built for a
+	// different key, so the caller rebuilds it.
+	static std::shared_ptr<const AtomicStrainPreparedReference> load(const std::string& path, std::uint64_t key);
+
+	// Whether the data was built from this reference: same atom count and cell, and
+	// the same positions and identifiers at the sampled atoms. Guards cache hits
+	// against collisions of the 64-bit key.
+	bool matches(
+		const Particles::ParticleProperty& positions,
+		const Particles::ParticleProperty* identifiers,
+		const SimulationCell& cell
+	) const;
+
+	// Returns false on I/O errors.
+	bool save(const std::string& path) const;
+
+	// Loads "<directory>/<key>.vref", or builds the data and stores it there. Processes
+	// sharing the directory serialize the build on a lock file, so only the first one
+	// builds and the others map its result. Mappings are shared and read-only, so every
+	// process attached to the same file uses the same physical pages. With maxBytes,
+	// storing a new file evicts older ones beyond that size, see evict().
+	static std::shared_ptr<const AtomicStrainPreparedReference> loadOrBuild(
+		const std::string& directory,
+		Particles::ParticleProperty* positions,
+		const Particles::ParticleProperty* identifiers,
+		const SimulationCell& cell,
+		double cutoff,
+		std::uint64_t key,
+		std::uint64_t maxBytes = 0
+	);
+
+	// Removes the least recently used cache files of the directory until the others
+	// take at most maxBytes, never the one at keep. loadOrBuild() refreshes the
+	// modification time of the files it uses. Also removes the lock files no process
+	// holds whose cache file is gone, and temporary files of builds that died. Returns
+	// the number of bytes removed; maxBytes 0 clears the directory.
+	static std::uint64_t evict(const std::string& directory, std::uint64_t maxBytes, const std::string& keep = {});
+
+	// A cache directory in POSIX shared memory (tmpfs), falling back to the system
+	// temporary directory where /dev/shm does not exist.
+	static std::string sharedDirectory();
+
+	std::uint64_t key() const{
+		return _key;
+	}
+
+	double cutoff() const{
+		return _cutoff;
+	}
+
+	std::size_t numAtoms() const{
+		return _numAtoms;
+	}
+
+	// Empty when the reference has no identifiers.
+	std::span<const std::size_t> identifierOrder() const{
+		return _identifierOrder;
+	}
+
+	std::span<const std::int32_t> neighbors(std::size_t atom) const{
+		return _neighbors.subspan(_neighborOffsets[atom], _neighborOffsets[atom + 1] - _neighborOffsets[atom]);
+	}
+
+	Vector3 delta(std::size_t atom, std::size_t k) const{
+		const double* d = _deltas.data() + 3 * (_neighborOffsets[atom] + k);
+		return Vector3(d[0], d[1], d[2]);
+	}
+
+	// V^-1 over all neighbors of the atom; only valid if invertible(atom).
+	Matrix_3<double> inverseV(std::size_t atom) const;
+
+	bool invertible(std::size_t atom) const{
+		return _invertible[atom] != 0;
+	}
+
+private:
+	std::uint64_t _key = 0;
+	double _cutoff = 0.0;
+	std::size_t _numAtoms = 0;
+	// Owns either the built arrays or the mapping of a cache file.
+	std::shared_ptr<const void> _storage;
+	std::span<const std::size_t> _identifierOrder;
+	std::span<const std::uint64_t> _neighborOffsets;
+	std::span<const std::int32_t> _neighbors;
+	std::span<const double> _deltas;
+	std::span<const double> _inverseV;
+	std::span<const std::uint8_t> _invertible;
+	std::array<double, 12> _cell{};
+	std::span<const PreparedReference::Sample> _samples;
+};
+
+}
@@ -0,0 +1,80 @@
+#pragma once
+
+#include <volt/core/volt.h>
+#include <volt/core/simulation_cell.h>
+#include <volt/core/particle_property.h>
+
+#include <cstddef>
+#include <memory>
+#include <optional>
+#include <vector>
+
+namespace Volt{
+
+// Per-frame engine output handed to the result writers. The per-atom buffers are
+// shared with the engine, so writers never copy them.
+struct AtomicStrainResult{
+	long long timestep = 0;
+	SimulationCell cell;
+	std::shared_ptr<Particles::ParticleProperty> identifiers;
+	std::shared_ptr<Particles::ParticleProperty> positions;
+
+	SimulationCell refCell;
+	std::shared_ptr<Particles::ParticleProperty> refPositions;
+	// Reference index of every current atom, -1 where it has no counterpart.
+	std::shared_ptr<const std::vector<int>> referenceIndices;
+
+	std::shared_ptr<Particles::ParticleProperty> shearStrains;
+	std::shared_ptr<Particles::ParticleProperty> volumetricStrains;
+	std::shared_ptr<Particles::ParticleProperty> strainTensors;
+	std::shared_ptr<Particles::ParticleProperty> deformationGradients;
+	std::shared_ptr<Particles::ParticleProperty> nonaffineSquaredDisplacements;
+	std::shared_ptr<Particles::ParticleProperty> invalidParticles;
+
+	// Atom indices to write, in output order. Null means every atom in frame order.
+	std::shared_ptr<const std::vector<std::size_t>> rows;
+
+	// Restricts the writers to rows [rowBegin, rowBegin + rowCount), e.g. one shard.
+	std::size_t rowBegin = 0;
+	std::optional<std::size_t> rowCount;
+
+	std::size_t numAtoms() const{
+		return positions ? positions->size() : 0;
+	}
+
+	std::size_t totalRows() const{
+		return rows ? rows->size() : numAtoms();
+	}
+
+	std::size_t numRows() const{
+		return rowCount ? *rowCount : totalRows() - rowBegin;
+	}
+
+	std::size_t atomIndex(std::size_t row) const{
+		const std::size_t r = rowBegin + row;
+		return rows ? (*rows)[r] : r;
+	}
+
+	// Shares all buffers, only the row window differs.
+	AtomicStrainResult slice(std::size_t begin, std::size_t count) const{
+		AtomicStrainResult view = *this;
+		view.rowBegin = rowBegin + begin;
+		view.rowCount = count;
+		return view;
+	}
+
+	// Falls back to the current position for atoms without a reference counterpart.
+	Point3 referencePosition(std::size_t atomIndex) const{
+		if(refPositions && referenceIndices){
+			const int refIndex = (*referenceIndices)[atomIndex];
+			if(refIndex >= 0) return refPositions->getPoint3(static_cast<std::size_t>(refIndex));
+		}
+		return positions->getPoint3(atomIndex);
+	}
+
+	int identifier(std::size_t atomIndex) const{
+		return identifiers ? identifiers->getInt(atomIndex) : static_cast<int>(atomIndex) + 1;
+	}
+};
+
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <volt/core/particle_property.h>
+
+#include <cstddef>
+#include <optional>
+#include <vector>
+
+namespace Volt{
+
+// Criteria for extracting plastically active atoms. An atom is selected when its
+// shear strain or D²min exceeds the corresponding threshold, or when it is among
+// the topK atoms with the largest D²min.
+struct AtomicStrainSelection{
+	std::optional<double> shearThreshold;
+	std::optional<double> d2minThreshold;
+	std::size_t topK = 0;
+
+	bool enabled() const{
+		return shearThreshold.has_value() || d2minThreshold.has_value() || topK > 0;
+	}
+
+	bool needsShearStrains() const{
+		return shearThreshold.has_value();
+	}
+
+	bool needsD2min() const{
+		return d2minThreshold.has_value() || topK > 0;
+	}
+};
+
+// Returns the indices of the selected atoms in ascending order. With serial, all work
+// runs on the calling thread.
+std::vector<std::size_t> selectAtoms(
+	const AtomicStrainSelection& selection,
+	const Particles::ParticleProperty* shearStrains,
+	const Particles::ParticleProperty* nonaffineSquaredDisplacements,
+	bool serial = false
+);
+
+}
@@ -3,19 +3,36 @@
 #include <volt/core/volt.h>
 #include <volt/core/lammps_parser.h>
 #include <volt/core/particle_property.h>
+#include <volt/atomic_strain_frame.h>
+#include <volt/atomic_strain_output.h>
+#include <volt/atomic_strain_selection.h>
+#include <volt/atomic_strain_result.h>
+#include <volt/atomic_strain_async_writer.h>
+#include <volt/atomic_strain_delta.h>
+#include <volt/atomic_strain_spatial_index.h>
 #include <nlohmann/json.hpp>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <span>
 #include <string>
+#include <vector>
 
 namespace Volt{
 
 using json = nlohmann::json;
 
+class AtomicStrainPreparedReference;
+
 class AtomicStrainService{
 public:
 	AtomicStrainService();
 
 	void setCutoff(double cutoff);
 	void setReferenceFrame(const LammpsParser::Frame &ref);
+	void setReferenceFrame(AtomicStrainFrame ref);
 	void setOptions(
 		bool eliminateCellDeformation,
 		bool assumeUnwrappedCoordinates,
@@ -24,11 +41,96 @@ public:
 		bool calculateD2min
 	);
 
+	// Restricts the per-atom output to the given fields. In summary-only mode
+	// no per-atom data is materialized and only "main_listing" is produced.
+	void setOutputFields(AtomicStrainField fields);
+	void setSummaryOnly(bool summaryOnly);
+
+	// When enabled, only atoms matching the selection are written to
+	// "per-atom-properties".
+	void setSelection(const AtomicStrainSelection& selection);
+
+	// Emits per-atom rows in ascending identifier order instead of file order.
+	void setSortByIdentifier(bool sortByIdentifier);
+
+	// Emits per-atom rows in Morton order of their reference positions and writes a
+	// block index for box queries next to the output. Takes precedence over sorting
+	// by identifier.
+	void setSpatialOrder(bool enabled, std::size_t blockSize = SpatialIndex::DefaultBlockSize);
+
+	// Throws std::invalid_argument if quantization is requested without a positive error bound.
+	void setEncoding(const AtomicStrainEncodingOptions& encoding);
+
+	// The msgpack file always carries "main_listing"; other formats write the
+	// per-atom data to a separate file next to it.
+	void setOutputFormat(AtomicStrainOutputFormat format);
+	void setColumnChecksums(bool checksums);
+	// Writes columnar and dump output with O_DIRECT, bypassing the page cache.
+	void setDirectIo(bool directIo);
+	// Splits columnar and dump output into this many files plus a manifest.
+	void setShards(std::size_t shards);
+	// Maximum octree depth for the octree format, 0 for automatic.
+	void setOctreeDepth(unsigned depth);
+
+	// Configures the delta format: a full keyframe every keyframeInterval frames,
+	// otherwise only atoms whose fields changed by more than tolerance. Frames are
+	// numbered by the order of compute() calls; changing the options restarts at a keyframe.
+	void setDeltaOptions(std::size_t keyframeInterval, double tolerance);
+
+	// With asynchronous output, compute() hands the result buffers to a dedicated
+	// I/O thread and returns only "main_listing". At most queueDepth results wait
+	// for the writer before compute() blocks.
+	void setAsyncOutput(bool enabled, std::size_t queueDepth = 2);
+	// Rethrows the first error of a queued write that failed since the last call.
+	void waitForPendingWrites();
+
+	// Keeps the neighbor lists and V^-1 of the reference in this directory, keyed by
+	// a hash of the reference content, cutoff and periodicity, and maps them on later
+	// runs instead of rebuilding them. An empty directory disables the cache. With
+	// maxBytes, the least recently used files beyond that size are evicted.
+	void setReferenceCache(std::string directory, std::uint64_t maxBytes = 0);
+
+	// Prepares the reference once and reuses it for every later frame, also without a
+	// cache directory. Meant for runs analyzing many frames against one reference.
+	void setRetainPreparedReference(bool retain);
+
+	// Rough peak memory in bytes of one compute() on a frame of numAtoms atoms in the
+	// cell with the current options: both frames, the neighbor data for the atom
+	// density of the cell, the per-atom results, the output being built and the
+	// results still queued for the asynchronous writer. Parallel output buffers are
+	// sized for the task arena it is called in.
+	std::size_t estimateMemory(std::size_t numAtoms, const SimulationCell& cell) const;
+
 	json compute(
 		const LammpsParser::Frame& currentFrame,
 		const std::string& outputFilename = ""
 	);
 
+	// Frames from the memory-mapped reader are passed to the engine without copies.
+	json compute(
+		const AtomicStrainFrame& currentFrame,
+		const std::string& outputFilename = ""
+	);
+
+	// Frames with fewer atoms are analyzed side by side by computeBatch().
+	void setParallelAtomThreshold(std::size_t atoms);
+
+	std::size_t parallelAtomThreshold() const{
+		return _parallelAtomThreshold;
+	}
+
+	// Analyzes many frames against the reference, writing frame i to outputFilenames[i].
+	// Frames below the parallel atom threshold run concurrently, one task per frame that
+	// also selects, orders and writes its rows on its own thread; larger ones one after
+	// another with atom-level parallelism. Asynchronous writes are queued in frame order
+	// once all frames are analyzed. Delta
+	// output depends on frame order and is always computed in order. A frame that
+	// fails yields a failure result, the others are still analyzed.
+	std::vector<json> computeBatch(
+		std::span<const AtomicStrainFrame> frames,
+		std::span<const std::string> outputFilenames
+	);
+
 private:
 	double _cutoff;
 	bool _eliminateCellDeformation;
@@ -36,14 +138,55 @@ private:
 	bool _calculateDeformationGradient;
 	bool _calculateStrainTensors;
 	bool _calculateD2min;
+	AtomicStrainField _outputFields;
+	bool _summaryOnly;
+	AtomicStrainSelection _selection;
+	bool _sortByIdentifier;
+	bool _spatialOrder;
+	std::size_t _spatialBlockSize;
+	AtomicStrainEncodingOptions _encoding;
+	AtomicStrainOutputFormat _outputFormat;
+	bool _columnChecksums;
+	bool _directIo;
+	std::size_t _shards;
+	unsigned _octreeDepth;
+	AtomicStrainDeltaEncoder _deltaEncoder;
+	std::unique_ptr<AtomicStrainAsyncWriter> _asyncWriter;
 
 	bool _hasReference;
-	LammpsParser::Frame _referenceFrame;
+	AtomicStrainFrame _referenceFrame;
+	std::string _referenceCacheDirectory;
+	std::uint64_t _referenceCacheLimit;
+	bool _retainPreparedReference;
+	std::optional<std::uint64_t> _referenceContentHash;
+	std::shared_ptr<const AtomicStrainPreparedReference> _preparedReference;
+	// Guards the prepared reference while computeBatch() analyzes frames concurrently.
+	std::mutex _preparedReferenceMutex;
+	std::size_t _parallelAtomThreshold;
 
+	std::shared_ptr<const AtomicStrainPreparedReference> preparedReference(const AtomicStrainFrame& currentFrame);
+
+	// With deferredWrite, an asynchronous write is stored there for the caller to
+	// submit rather than submitted, since submit() blocks while the queue is full.
 	json computeAtomicStrain(
-		const LammpsParser::Frame& currentFrame,
-		const LammpsParser::Frame& refFrame,
-		Particles::ParticleProperty* positions,
+		const AtomicStrainFrame& currentFrame,
+		const AtomicStrainFrame& refFrame,
+		const std::string& outputFilename,
+		bool serialKernel = false,
+		std::function<void()>* deferredWrite = nullptr
+	);
+
+	static void appendPerAtomProperties(
+		json& root,
+		const AtomicStrainResult& result,
+		const AtomicStrainOutputOptions& settings
+	);
+
+	// Throws std::runtime_error after attempting every file if any of them failed.
+	static void writeResult(
+		const json& root,
+		const AtomicStrainResult& result,
+		const AtomicStrainOutputOptions& settings,
 		const std::string& outputFilename
 	);
 };
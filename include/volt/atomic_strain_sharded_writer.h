@@ -0,0 +1,23 @@
+#pragma once
+
+#include <volt/atomic_strain_output.h>
+#include <volt/atomic_strain_result.h>
+
+#include <string>
+
+namespace Volt{
+
+// Splits the per-atom rows into options.shards contiguous ranges, writes the ranges
+// to "<prefix>.shard<k>.<ext>" concurrently on the calling TBB arena and records the
+// shards and their row ranges in "<prefix>.manifest.json". Only the columnar and dump
+// formats are supported. With options.spatialBlockSize set, every columnar shard gets
+// its spatial index "<prefix>.shard<k>.vmix", listed as "index" in the manifest.
+// Returns false if any shard or the manifest failed to write; after a failed shard
+// no shard file and no manifest is left behind.
+bool writeShardedResult(
+	const AtomicStrainResult& result,
+	const AtomicStrainOutputOptions& options,
+	const std::string& prefix
+);
+
+}
@@ -0,0 +1,106 @@
+#pragma once
+
+#include <volt/atomic_strain_frame_reader.h>
+#include <volt/atomic_strain_dump_format.h>
+#include <volt/atomic_strain_mapped_file.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string>
+
+namespace Volt{
+
+// Pre-parsed frames of a dump, written by "--convert" as "<dump>.vsnap". A file is a
+// FileHeader, the per-frame arrays and a table of FrameEntry records at the end.
+// Every array starts at a multiple of Snapshot::Alignment, so a mapped array can be
+// copied into the engine buffers page by page without any parsing.
+namespace Snapshot{
+
+inline constexpr char Magic[8] = { 'V', 'O', 'L', 'T', 'S', 'N', 'P', '1' };
+inline constexpr std::uint32_t Version = 1;
+inline constexpr std::uint64_t Alignment = 4096;
+inline constexpr const char* Extension = ".vsnap";
+
+enum FrameFlags : std::uint32_t{
+	HasIdentifiers = 1u << 0
+};
+
+enum FileFlags : std::uint32_t{
+	// Positions were taken from xu/yu/zu columns where the dump had both kinds.
+	PreferUnwrapped = 1u << 0
+};
+
+struct FileHeader{
+	char magic[8];
+	std::uint32_t version;
+	std::uint32_t flags;
+	// Size and modification time of the dump the snapshot was converted from.
+	std::uint64_t dumpSize;
+	std::int64_t dumpModified;
+	std::uint64_t numFrames;
+	std::uint64_t frameTableOffset;
+};
+
+// frame.flags holds the FrameFlags of the frame.
+struct FrameEntry{
+	FrameRecord frame;
+	// natoms x 3 doubles.
+	std::uint64_t positionsOffset;
+	// natoms int32 values, 0 without HasIdentifiers.
+	std::uint64_t identifiersOffset;
+};
+
+static_assert(sizeof(FileHeader) == 48, "Unexpected snapshot header layout");
+static_assert(sizeof(FrameEntry) == 144, "Unexpected snapshot frame entry layout");
+
+}
+
+// Converts every frame of the dump into a snapshot, written under a temporary name
+// and renamed once complete. preferUnwrapped selects the position columns like
+// openDumpReader() does and is recorded in the header. Returns false on I/O errors;
+// malformed dumps throw std::runtime_error.
+bool writeSnapshot(const std::string& dumpPath, const std::string& snapshotPath, bool preferUnwrapped = false);
+
+// "<dump>.vsnap".
+std::string snapshotPathFor(const std::string& dumpPath);
+
+// The snapshot next to the dump, if there is one converted from the dump as it is now
+// with the same position column preference.
+std::optional<std::string> findSnapshot(const std::string& dumpPath, bool preferUnwrapped = false);
+
+bool isSnapshot(const std::string& path);
+
+// Reads frames from a memory-mapped snapshot. ParticleProperty owns its storage, so
+// the arrays are copied once into the frame buffers, in parallel and at memory
+// bandwidth. Seek offsets are those of the frame table entries.
+class AtomicStrainSnapshotReader : public AtomicStrainFrameReader{
+public:
+	explicit AtomicStrainSnapshotReader(const std::string& path);
+
+	AtomicStrainSnapshotReader(const AtomicStrainSnapshotReader&) = delete;
+	AtomicStrainSnapshotReader& operator=(const AtomicStrainSnapshotReader&) = delete;
+
+	bool readFrame(AtomicStrainFrame& frame) override;
+	bool skipFrame(AtomicStrainFrameInfo& info) override;
+
+	bool seekable() const override{
+		return true;
+	}
+
+	void seek(std::uint64_t offset) override;
+
+	const Snapshot::FileHeader& header() const{
+		return *_file.data<Snapshot::FileHeader>();
+	}
+
+private:
+	const Snapshot::FrameEntry& entry(std::size_t frame) const;
+	void validate() const;
+
+	std::string _path;
+	MappedFile _file;
+	std::size_t _nextFrame = 0;
+};
+
+}
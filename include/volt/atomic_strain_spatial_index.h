@@ -0,0 +1,205 @@
+#pragma once
+
+#include <volt/atomic_strain_result.h>
+#include <volt/atomic_strain_morton.h>
+#include <volt/atomic_strain_mapped_file.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace Volt{
+
+// Block index over a columnar result whose rows are sorted by the Morton code of the
+// reference position. Every block covers blockSize consecutive rows and records the
+// code range and bounding box of its atoms; the code of every row and the payload
+// offset of every column are stored as well, so a box query resolves to exact row
+// ranges and those to byte ranges of the columnar file. Row numbers are local to the
+// indexed file, i.e. to one shard of sharded output.
+//
+// Layout: Header, BlockEntry[numBlocks], ColumnRef[numColumns], uint64 code[numRows].
+namespace SpatialIndex{
+
+inline constexpr char Magic[8] = { 'V', 'O', 'L', 'T', 'M', 'I', 'X', '1' };
+inline constexpr std::uint32_t Version = 2;
+inline constexpr std::size_t DefaultBlockSize = 4096;
+
+struct Header{
+	char magic[8];
+	std::uint32_t version;
+	std::uint32_t bits;
+	std::uint64_t numRows;
+	std::uint64_t numBlocks;
+	std::uint32_t blockSize;
+	std::uint32_t numColumns;
+	// Quantization grid of the Morton codes.
+	double origin[3];
+	double cellSize[3];
+};
+
+struct BlockEntry{
+	std::uint64_t firstRow;
+	std::uint32_t numRows;
+	std::uint32_t reserved;
+	std::uint64_t firstCode;
+	std::uint64_t lastCode;
+	double boundsMin[3];
+	double boundsMax[3];
+};
+
+struct ColumnRef{
+	char name[32];
+	// Byte offset of the column payload in the columnar file.
+	std::uint64_t offset;
+	// Components times element size in bits, or components for bitmask columns.
+	std::uint64_t rowBits;
+};
+
+static_assert(sizeof(Header) == 88, "Unexpected spatial index header layout");
+static_assert(sizeof(BlockEntry) == 80, "Unexpected spatial index block layout");
+static_assert(sizeof(ColumnRef) == 48, "Unexpected spatial index column layout");
+
+struct RowRange{
+	std::uint64_t begin;
+	std::uint64_t count;
+};
+
+struct ByteRange{
+	std::uint64_t offset;
+	std::uint64_t size;
+};
+
+}
+
+// Output rows of the result (all atoms or the current selection) reordered by the
+// Morton code of their reference positions. serial keeps the work on the calling
+// thread, as for all writers below.
+std::shared_ptr<const std::vector<std::size_t>> mortonRowOrder(const AtomicStrainResult& result, bool serial = false);
+
+// Grid mortonRowOrder() sorts with: spans the reference positions of all output rows
+// of the result, ignoring its row window.
+Morton::Grid mortonGrid(const AtomicStrainResult& result, bool serial = false);
+
+// Writes the block index for the columnar file just written from the result, whose
+// rows are expected to be in Morton order on the given grid. Returns false on I/O
+// errors or if the columnar file does not match the result.
+bool writeSpatialIndex(
+	const AtomicStrainResult& result,
+	const Morton::Grid& grid,
+	std::size_t blockSize,
+	const std::string& columnarPath,
+	const std::string& path,
+	bool serial = false
+);
+
+// Header-only reader over a memory mapping of the index. Resolves boxes to row
+// ranges and row ranges to byte ranges of the indexed columnar file.
+class AtomicStrainSpatialIndexReader{
+public:
+	explicit AtomicStrainSpatialIndexReader(const std::string& path)
+		: _file(path, "spatial index"){
+		if(_file.size() < sizeof(SpatialIndex::Header)){
+			throw std::runtime_error("Not an atomic strain spatial index: " + path);
+		}
+
+		const SpatialIndex::Header& h = header();
+		const std::uint64_t expected = sizeof(SpatialIndex::Header) +
+			h.numBlocks * sizeof(SpatialIndex::BlockEntry) +
+			std::uint64_t(h.numColumns) * sizeof(SpatialIndex::ColumnRef) +
+			h.numRows * sizeof(std::uint64_t);
+		if(std::memcmp(h.magic, SpatialIndex::Magic, sizeof(h.magic)) != 0 || h.version != SpatialIndex::Version){
+			throw std::runtime_error("Not an atomic strain spatial index: " + path);
+		}
+		if(h.numBlocks > _file.size() || h.numRows > _file.size() || expected != _file.size()){
+			throw std::runtime_error("Spatial index is truncated: " + path);
+		}
+	}
+
+	AtomicStrainSpatialIndexReader(const AtomicStrainSpatialIndexReader&) = delete;
+	AtomicStrainSpatialIndexReader& operator=(const AtomicStrainSpatialIndexReader&) = delete;
+
+	const SpatialIndex::Header& header() const{
+		return *_file.data<SpatialIndex::Header>();
+	}
+
+	std::span<const SpatialIndex::BlockEntry> blocks() const{
+		return { reinterpret_cast<const SpatialIndex::BlockEntry*>(_file.data() + sizeof(SpatialIndex::Header)), header().numBlocks };
+	}
+
+	std::span<const SpatialIndex::ColumnRef> columns() const{
+		return { reinterpret_cast<const SpatialIndex::ColumnRef*>(blocks().data() + blocks().size()), header().numColumns };
+	}
+
+	// Morton code of every row.
+	std::span<const std::uint64_t> codes() const{
+		return { reinterpret_cast<const std::uint64_t*>(columns().data() + columns().size()), header().numRows };
+	}
+
+	const SpatialIndex::ColumnRef* findColumn(std::string_view name) const{
+		for(const auto& column : columns()){
+			if(std::string_view(column.name, ::strnlen(column.name, sizeof(column.name))) == name) return &column;
+		}
+		return nullptr;
+	}
+
+	// Rows whose Morton code lies within the code range of [boxMin, boxMax], searched
+	// only in blocks whose bounding box intersects the box, with adjacent ranges
+	// merged. Rows inside the ranges still need an exact position test.
+	std::vector<SpatialIndex::RowRange> query(const double boxMin[3], const double boxMax[3]) const{
+		const SpatialIndex::Header& h = header();
+		Morton::Grid grid{};
+		std::copy(std::begin(h.origin), std::end(h.origin), grid.origin);
+		std::copy(std::begin(h.cellSize), std::end(h.cellSize), grid.cellSize);
+		grid.bits = h.bits;
+		// Codes grow monotonically with every cell coordinate, so the corners bound them.
+		const std::uint64_t lowCode = grid.code(Point3(boxMin[0], boxMin[1], boxMin[2]));
+		const std::uint64_t highCode = grid.code(Point3(boxMax[0], boxMax[1], boxMax[2]));
+
+		const std::span<const std::uint64_t> rowCodes = codes();
+		std::vector<SpatialIndex::RowRange> ranges;
+		for(const auto& block : blocks()){
+			if(block.lastCode < lowCode || block.firstCode > highCode) continue;
+			bool intersects = true;
+			for(std::size_t k = 0; k < 3; ++k){
+				intersects = intersects && block.boundsMin[k] <= boxMax[k] && block.boundsMax[k] >= boxMin[k];
+			}
+			if(!intersects) continue;
+
+			const auto blockBegin = rowCodes.begin() + static_cast<std::ptrdiff_t>(block.firstRow);
+			const auto blockEnd = blockBegin + block.numRows;
+			const auto first = std::lower_bound(blockBegin, blockEnd, lowCode);
+			const auto last = std::upper_bound(first, blockEnd, highCode);
+			if(first == last) continue;
+
+			const std::uint64_t begin = static_cast<std::uint64_t>(first - rowCodes.begin());
+			const std::uint64_t count = static_cast<std::uint64_t>(last - first);
+			if(!ranges.empty() && ranges.back().begin + ranges.back().count == begin){
+				ranges.back().count += count;
+			}else{
+				ranges.push_back({ begin, count });
+			}
+		}
+		return ranges;
+	}
+
+	// Bytes of the columnar file holding the rows. Bitmask ranges are widened to whole
+	// bytes; the first row starts at bit (rows.begin * rowBits) % 8.
+	static SpatialIndex::ByteRange byteRange(const SpatialIndex::ColumnRef& column, SpatialIndex::RowRange rows){
+		const std::uint64_t firstBit = rows.begin * column.rowBits;
+		const std::uint64_t endBit = (rows.begin + rows.count) * column.rowBits;
+		const std::uint64_t first = firstBit / 8;
+		return { column.offset + first, (endBit + 7) / 8 - first };
+	}
+
+private:
+	MappedFile _file;
+};
+
+}
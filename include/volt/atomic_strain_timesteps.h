@@ -0,0 +1,51 @@
+#pragma once
+
+#include <volt/atomic_strain_frame.h>
+
+#include <cstddef>
+#include <string>
+
+namespace Volt{
+
+class AtomicStrainService;
+
+// Multi-frame runs. Every frame is written to <outputBase>_<timestep>; failures are
+// logged and reported by returning false.
+
+// Waits for queued asynchronous writes. A failed write fails the run.
+bool finishWrites(AtomicStrainService& analyzer);
+
+// Analyzes one frame into <outputBase>_<timestep>.
+bool analyzeFrame(AtomicStrainService& analyzer, const AtomicStrainFrame& frame, const std::string& outputBase);
+
+// Analyzes every frame of the input within [first, last]. Seekable dumps are read
+// through the frame index, several frames concurrently ahead of the analysis;
+// compressed dumps are decompressed frame by frame. Frames below the analyzer's
+// parallel atom threshold are analyzed side by side through computeBatch().
+bool analyzeTimesteps(
+	AtomicStrainService& analyzer,
+	const std::string& filename,
+	const std::string& outputBase,
+	long long first,
+	long long last,
+	bool persistIndex,
+	bool preferUnwrapped,
+	std::size_t readAhead
+);
+
+// Analyzes frames from stdin ("-") or a named pipe as the writer completes them, until
+// it closes the stream. The next frame is parsed while the current one is analyzed,
+// with at most readAhead frames buffered. Without a reference the first frame in
+// [first, last] becomes it.
+bool analyzeStream(
+	AtomicStrainService& analyzer,
+	bool hasReference,
+	const std::string& source,
+	const std::string& outputBase,
+	long long first,
+	long long last,
+	bool preferUnwrapped,
+	std::size_t readAhead
+);
+
+}
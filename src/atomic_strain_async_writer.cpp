@@ -0,0 +1,70 @@
+#include <volt/atomic_strain_async_writer.h>
+
+#include <algorithm>
+#include <exception>
+#include <utility>
+#include <spdlog/spdlog.h>
+
+namespace Volt{
+
+AtomicStrainAsyncWriter::AtomicStrainAsyncWriter(std::size_t maxPendingJobs)
+    : _maxPendingJobs(std::max<std::size_t>(1, maxPendingJobs))
+    , _thread([this]{ run(); }){}
+
+AtomicStrainAsyncWriter::~AtomicStrainAsyncWriter(){
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _stopping = true;
+    }
+    _jobAvailable.notify_all();
+    _thread.join();
+}
+
+void AtomicStrainAsyncWriter::submit(std::function<void()> job){
+    {
+        std::unique_lock<std::mutex> lock(_mutex);
+        _slotAvailable.wait(lock, [this]{ return _jobs.size() < _maxPendingJobs; });
+        _jobs.push_back(std::move(job));
+    }
+    _jobAvailable.notify_one();
+}
+
+void AtomicStrainAsyncWriter::wait(){
+    std::unique_lock<std::mutex> lock(_mutex);
+    _idle.wait(lock, [this]{ return _jobs.empty() && _activeJobs == 0; });
+    if(_error){
+        std::rethrow_exception(std::exchange(_error, nullptr));
+    }
+}
+
+void AtomicStrainAsyncWriter::run(){
+    for(;;){
+        std::function<void()> job;
+        {
+            std::unique_lock<std::mutex> lock(_mutex);
+            _jobAvailable.wait(lock, [this]{ return _stopping || !_jobs.empty(); });
+            if(_jobs.empty()) return;
+            job = std::move(_jobs.front());
+            _jobs.pop_front();
+            ++_activeJobs;
+        }
+        _slotAvailable.notify_one();
+
+        std::exception_ptr error;
+        try{
+            job();
+        }catch(const std::exception& e){
+            spdlog::error("Asynchronous atomic strain write failed: {}", e.what());
+            error = std::current_exception();
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            --_activeJobs;
+            if(error && !_error) _error = std::move(error);
+        }
+        _idle.notify_all();
+    }
+}
+
+}
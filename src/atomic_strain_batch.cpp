@@ -0,0 +1,211 @@
+#include <volt/atomic_strain_batch.h>
+#include <volt/atomic_strain_service.h>
+#include <volt/atomic_strain_input.h>
+#include <volt/atomic_strain_timesteps.h>
+#include <volt/cli/common.h>
+
+#include <algorithm>
+#include <condition_variable>
+#include <exception>
+#include <filesystem>
+#include <fstream>
+#include <limits>
+#include <mutex>
+#include <numeric>
+#include <stdexcept>
+#include <thread>
+#include <nlohmann/json.hpp>
+#include <spdlog/spdlog.h>
+#include <tbb/task_arena.h>
+#include <unistd.h>
+
+namespace Volt{
+
+namespace{
+
+constexpr std::size_t BytesPerMiB = 1u << 20;
+
+// Atoms per worker thread granted to a job; smaller systems get fewer threads so that
+// more jobs run side by side.
+constexpr std::size_t BatchAtomsPerThread = 50000;
+
+std::string manifestPath(const nlohmann::json& job, const char* key, const std::filesystem::path& base){
+    const auto it = job.find(key);
+    if(it == job.end()) return {};
+    if(!it->is_string()) throw std::runtime_error(std::string("Batch job \"") + key + "\" must be a string");
+    const std::filesystem::path path = it->get<std::string>();
+    return path.is_absolute() ? path.string() : (base / path).string();
+}
+
+}
+
+std::vector<AtomicStrainBatchJob> readBatchManifest(const std::string& path){
+    std::ifstream in(path);
+    if(!in) throw std::runtime_error("Cannot open batch manifest: " + path);
+
+    nlohmann::json manifest;
+    try{
+        manifest = nlohmann::json::parse(in);
+    }catch(const nlohmann::json::parse_error& e){
+        throw std::runtime_error("Malformed batch manifest " + path + ": " + e.what());
+    }
+    const nlohmann::json& entries = manifest.is_object() ? manifest.value("jobs", nlohmann::json()) : manifest;
+    if(!entries.is_array()) throw std::runtime_error("Batch manifest has no job list: " + path);
+
+    const std::filesystem::path base = std::filesystem::path(path).parent_path();
+    std::vector<AtomicStrainBatchJob> jobs;
+    jobs.reserve(entries.size());
+    for(const auto& entry : entries){
+        if(!entry.is_object()) throw std::runtime_error("Batch job must be an object: " + path);
+        AtomicStrainBatchJob job;
+        job.input = manifestPath(entry, "input", base);
+        job.reference = manifestPath(entry, "reference", base);
+        job.output = manifestPath(entry, "output", base);
+        if(job.input.empty()) throw std::runtime_error("Batch job without \"input\" in " + path);
+        jobs.push_back(std::move(job));
+    }
+    return jobs;
+}
+
+AtomicStrainBatchScheduler::AtomicStrainBatchScheduler(std::size_t memoryBudget, std::size_t maxThreads)
+    : _memoryBudget(memoryBudget), _maxThreads(std::max<std::size_t>(1, maxThreads)){}
+
+std::size_t AtomicStrainBatchScheduler::run(
+    const std::vector<AtomicStrainBatchJob>& jobs,
+    const std::function<bool(const AtomicStrainBatchJob&)>& execute
+){
+    // Largest first, so long jobs start early and small ones fill the gaps.
+    std::vector<std::size_t> pending(jobs.size());
+    std::iota(pending.begin(), pending.end(), 0);
+    std::stable_sort(pending.begin(), pending.end(), [&jobs](std::size_t a, std::size_t b){
+        return jobs[a].estimatedBytes > jobs[b].estimatedBytes;
+    });
+
+    std::mutex mutex;
+    std::condition_variable finished;
+    std::size_t usedBytes = 0;
+    std::size_t usedThreads = 0;
+    std::size_t running = 0;
+    std::size_t failures = 0;
+    std::vector<std::thread> workers;
+    workers.reserve(jobs.size());
+
+    std::unique_lock<std::mutex> lock(mutex);
+    while(!pending.empty()){
+        auto next = pending.end();
+        finished.wait(lock, [&]{
+            next = std::find_if(pending.begin(), pending.end(), [&](std::size_t i){
+                const AtomicStrainBatchJob& job = jobs[i];
+                const std::size_t threads = std::min(job.threads, _maxThreads);
+                if(running == 0) return true;
+                return usedThreads + threads <= _maxThreads && usedBytes + job.estimatedBytes <= _memoryBudget;
+            });
+            return next != pending.end();
+        });
+
+        const AtomicStrainBatchJob& job = jobs[*next];
+        pending.erase(next);
+        const std::size_t threads = std::min(job.threads, _maxThreads);
+        if(job.estimatedBytes > _memoryBudget){
+            spdlog::warn("{} needs about {} MiB, more than the {} MiB budget; running it alone",
+                job.input, job.estimatedBytes / BytesPerMiB, _memoryBudget / BytesPerMiB);
+        }
+        usedBytes += job.estimatedBytes;
+        usedThreads += threads;
+        ++running;
+        spdlog::info("Starting {} ({} atoms, ~{} MiB, {} threads)", job.input, job.numAtoms, job.estimatedBytes / BytesPerMiB, threads);
+
+        workers.emplace_back([&, threads, &job = job]{
+            bool ok = false;
+            try{
+                tbb::task_arena arena(static_cast<int>(threads));
+                ok = arena.execute([&]{ return execute(job); });
+            }catch(const std::exception& e){
+                spdlog::error("{}: {}", job.input, e.what());
+            }
+            std::lock_guard<std::mutex> guard(mutex);
+            usedBytes -= job.estimatedBytes;
+            usedThreads -= threads;
+            --running;
+            if(!ok) ++failures;
+            finished.notify_all();
+        });
+    }
+    lock.unlock();
+
+    for(auto& worker : workers) worker.join();
+    return failures;
+}
+
+std::size_t defaultMemoryBudget(){
+    const long pages = ::sysconf(_SC_PHYS_PAGES);
+    const long pageSize = ::sysconf(_SC_PAGE_SIZE);
+    if(pages <= 0 || pageSize <= 0) return std::numeric_limits<std::size_t>::max();
+    return static_cast<std::size_t>(pages) / 5 * 4 * static_cast<std::size_t>(pageSize);
+}
+
+bool runBatch(
+    const std::string& manifestPath,
+    std::size_t memoryBudget,
+    std::size_t maxThreads,
+    bool useMmap,
+    bool useSnapshot,
+    bool preferUnwrapped,
+    const std::function<bool(AtomicStrainService&)>& configure
+){
+    std::vector<AtomicStrainBatchJob> jobs;
+    AtomicStrainService estimator;
+    if(!configure(estimator)) return false;
+    try{
+        jobs = readBatchManifest(manifestPath);
+        for(AtomicStrainBatchJob& job : jobs){
+            const AtomicStrainFrameInfo first = peekFrame(resolveInput(job.input, useSnapshot, preferUnwrapped));
+            job.numAtoms = first.natoms;
+            job.threads = std::clamp<std::size_t>((job.numAtoms + BatchAtomsPerThread - 1) / BatchAtomsPerThread, 1, maxThreads);
+            // Estimated in an arena of the job's size, which bounds its parallel output buffers.
+            tbb::task_arena arena(static_cast<int>(job.threads));
+            job.estimatedBytes = arena.execute([&]{ return estimator.estimateMemory(job.numAtoms, first.simulationCell); });
+        }
+    }catch(const std::runtime_error& e){
+        spdlog::error("{}", e.what());
+        return false;
+    }
+    spdlog::info("Batch of {} jobs, memory budget {} MiB", jobs.size(), memoryBudget / BytesPerMiB);
+
+    AtomicStrainBatchScheduler scheduler(memoryBudget, maxThreads);
+    const std::size_t failures = scheduler.run(jobs, [&](const AtomicStrainBatchJob& job){
+        AtomicStrainService analyzer;
+        if(!configure(analyzer)) return false;
+
+        AtomicStrainFrame frame;
+        if(!loadFrame(resolveInput(job.input, useSnapshot, preferUnwrapped), useMmap, preferUnwrapped, frame)) return false;
+        if(!job.reference.empty()){
+            AtomicStrainFrame refFrame;
+            if(!loadFrame(resolveInput(job.reference, useSnapshot, preferUnwrapped), useMmap, preferUnwrapped, refFrame)) return false;
+            if(refFrame.natoms != frame.natoms){
+                spdlog::error("Atom count mismatch: {}={} {}={}", job.input, frame.natoms, job.reference, refFrame.natoms);
+                return false;
+            }
+            analyzer.setReferenceFrame(std::move(refFrame));
+        }
+
+        const std::string output = job.output.empty() ? CLI::deriveOutputBase(job.input, "") : job.output;
+        json result = analyzer.compute(frame, output);
+        if(!finishWrites(analyzer)) return false;
+        if(result.value("is_failed", false)){
+            spdlog::error("Analysis of {} failed: {}", job.input, result.value("error", "Unknown error"));
+            return false;
+        }
+        spdlog::info("{} written to {}", job.input, output);
+        return true;
+    });
+
+    if(failures > 0){
+        spdlog::error("{} of {} batch jobs failed", failures, jobs.size());
+        return false;
+    }
+    spdlog::info("Batch completed.");
+    return true;
+}
+
+}
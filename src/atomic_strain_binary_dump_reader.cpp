@@ -0,0 +1,268 @@
+#include <volt/atomic_strain_binary_dump_reader.h>
+#include <volt/atomic_strain_dump_format.h>
+
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <tbb/parallel_for.h>
+#include <tbb/blocked_range.h>
+
+namespace Volt{
+
+using namespace Volt::Particles;
+
+namespace{
+
+constexpr std::int32_t NativeEndianFlag = 0x0001;
+constexpr std::int64_t MaxMagicLength = 64;
+// Values of the triclinic header field: orthogonal boxes are 0.
+constexpr std::int32_t RestrictedTriclinic = 1;
+constexpr std::int32_t GeneralTriclinic = 2;
+// id type xs ys zs.
+constexpr std::int32_t DumpAtomColumns = 5;
+
+class ByteCursor{
+public:
+    ByteCursor(const char* data, std::size_t size, std::size_t offset, const std::string& path)
+        : _data(data), _size(size), _offset(offset), _path(path){}
+
+    template<typename T>
+    T read(){
+        T value;
+        std::memcpy(&value, bytes(sizeof(T)), sizeof(T));
+        return value;
+    }
+
+    const char* bytes(std::size_t count){
+        if(count > _size - _offset){
+            throw std::runtime_error("Truncated LAMMPS binary dump: " + _path);
+        }
+        const char* p = _data + _offset;
+        _offset += count;
+        return p;
+    }
+
+    std::size_t offset() const{
+        return _offset;
+    }
+
+private:
+    const char* _data;
+    std::size_t _size;
+    std::size_t _offset;
+    const std::string& _path;
+};
+
+// One per-processor block of rows, each row holding sizeOne doubles.
+struct BinaryChunk{
+    const char* data;
+    std::size_t firstAtom;
+    std::size_t numAtoms;
+};
+
+std::vector<std::string_view> splitColumnNames(std::string_view columns){
+    std::vector<std::string_view> names;
+    std::size_t i = 0;
+    while(i < columns.size()){
+        while(i < columns.size() && columns[i] == ' ') ++i;
+        const std::size_t begin = i;
+        while(i < columns.size() && columns[i] != ' ') ++i;
+        if(i > begin) names.push_back(columns.substr(begin, i - begin));
+    }
+    return names;
+}
+
+double readDouble(const char* row, int column){
+    double value;
+    std::memcpy(&value, row + static_cast<std::size_t>(column) * sizeof(double), sizeof(double));
+    return value;
+}
+
+// Header and chunk table of one frame; the chunks point into the mapping.
+struct BinaryFrame{
+    long long timestep = 0;
+    std::size_t natoms = 0;
+    SimulationCell simulationCell;
+    DumpColumnLayout layout;
+    std::int32_t sizeOne = 0;
+    std::vector<BinaryChunk> chunks;
+    // Offset of the next frame.
+    std::size_t end = 0;
+};
+
+BinaryFrame parseBinaryFrame(const char* data, std::size_t size, std::size_t offset, const std::string& path, bool preferUnwrapped){
+    ByteCursor in(data, size, offset, path);
+
+    // Revised files start every frame with the negated length of a magic string.
+    std::int64_t timestep = in.read<std::int64_t>();
+    std::string_view magic;
+    std::int32_t revision = 0;
+    if(timestep < 0){
+        if(-timestep > MaxMagicLength){
+            throw std::runtime_error("Invalid magic string length in LAMMPS binary dump: " + path);
+        }
+        const std::size_t length = static_cast<std::size_t>(-timestep);
+        magic = std::string_view(in.bytes(length), length);
+        if(in.read<std::int32_t>() != NativeEndianFlag){
+            throw std::runtime_error("LAMMPS binary dump was written with a different byte order: " + path);
+        }
+        revision = in.read<std::int32_t>();
+        timestep = in.read<std::int64_t>();
+    }
+
+    const std::int64_t natoms = in.read<std::int64_t>();
+    if(natoms < 0 || natoms > std::numeric_limits<int>::max()){
+        throw std::runtime_error("Invalid atom count in LAMMPS binary dump: " + path);
+    }
+    const std::int32_t triclinic = in.read<std::int32_t>();
+    if(triclinic < 0 || triclinic > GeneralTriclinic){
+        throw std::runtime_error("Unknown cell type " + std::to_string(triclinic) + " in LAMMPS binary dump: " + path);
+    }
+    std::int32_t boundary[6];
+    for(std::int32_t& b : boundary) b = in.read<std::int32_t>();
+    const std::array<bool, 3> pbc{ boundary[0] == 0, boundary[2] == 0, boundary[4] == 0 };
+
+    SimulationCell cell;
+    if(triclinic == GeneralTriclinic){
+        // Edge vectors A, B, C and the origin; positions are given in the same frame.
+        double edges[3][3], origin[3];
+        for(auto& edge : edges){
+            for(double& v : edge) v = in.read<double>();
+        }
+        for(double& v : origin) v = in.read<double>();
+        cell = makeGeneralDumpCell(edges, origin, pbc);
+    }else{
+        double lo[3], hi[3], tilt[3] = { 0.0, 0.0, 0.0 };
+        for(std::size_t k = 0; k < 3; ++k){
+            lo[k] = in.read<double>();
+            hi[k] = in.read<double>();
+        }
+        if(triclinic == RestrictedTriclinic){
+            for(double& t : tilt) t = in.read<double>();
+        }
+        cell = makeDumpCell(lo, hi, tilt, pbc);
+    }
+    const std::int32_t sizeOne = in.read<std::int32_t>();
+    if(sizeOne <= 0){
+        throw std::runtime_error("Invalid row size in LAMMPS binary dump: " + path);
+    }
+
+    std::vector<std::string_view> names;
+    if(!magic.empty() && revision > 1){
+        const std::int32_t unitsLength = in.read<std::int32_t>();
+        if(unitsLength > 0) in.bytes(static_cast<std::size_t>(unitsLength));
+        if(in.read<char>()) in.read<double>();
+        const std::int32_t columnsLength = in.read<std::int32_t>();
+        if(columnsLength < 0){
+            throw std::runtime_error("Invalid column header in LAMMPS binary dump: " + path);
+        }
+        names = splitColumnNames(std::string_view(in.bytes(static_cast<std::size_t>(columnsLength)), columnsLength));
+    }
+    if(names.empty()){
+        // "dump atom" rows, with or without the three image flags.
+        if(sizeOne != DumpAtomColumns && sizeOne != DumpAtomColumns + 3){
+            throw std::runtime_error(
+                "LAMMPS binary dump without column names has " + std::to_string(sizeOne) +
+                " values per atom, expected the 5 or 8 of dump atom: " + path
+            );
+        }
+        names = { "id", "type", "xs", "ys", "zs" };
+    }
+    BinaryFrame frame;
+    frame.layout = findDumpColumns(names, path, preferUnwrapped);
+    frame.sizeOne = sizeOne;
+    if(frame.layout.lastUsed() >= sizeOne){
+        throw std::runtime_error("LAMMPS binary dump rows are shorter than the column layout: " + path);
+    }
+
+    const std::int32_t numChunks = in.read<std::int32_t>();
+    std::size_t atoms = 0;
+    for(std::int32_t c = 0; c < numChunks; ++c){
+        const std::int32_t values = in.read<std::int32_t>();
+        if(values < 0 || values % sizeOne != 0){
+            throw std::runtime_error("Invalid chunk size in LAMMPS binary dump: " + path);
+        }
+        const std::size_t rows = static_cast<std::size_t>(values / sizeOne);
+        frame.chunks.push_back({ in.bytes(static_cast<std::size_t>(values) * sizeof(double)), atoms, rows });
+        atoms += rows;
+    }
+    if(atoms != static_cast<std::size_t>(natoms)){
+        throw std::runtime_error("LAMMPS binary dump chunks do not add up to the atom count: " + path);
+    }
+
+    frame.timestep = timestep;
+    frame.natoms = atoms;
+    frame.simulationCell = cell;
+    frame.end = in.offset();
+    return frame;
+}
+
+}
+
+AtomicStrainBinaryDumpReader::AtomicStrainBinaryDumpReader(const std::string& path, bool preferUnwrapped)
+    : _path(path), _file(path, "LAMMPS binary dump", MappedFile::Access::Sequential), _preferUnwrapped(preferUnwrapped){}
+
+bool AtomicStrainBinaryDumpReader::readFrame(AtomicStrainFrame& frame){
+    if(_offset >= _file.size()) return false;
+    const BinaryFrame parsed = parseBinaryFrame(_file.data(), _file.size(), _offset, _path, _preferUnwrapped);
+    const DumpColumnLayout& layout = parsed.layout;
+    const std::size_t atoms = parsed.natoms;
+
+    AtomicStrainFrame result;
+    result.timestep = parsed.timestep;
+    result.natoms = atoms;
+    result.simulationCell = parsed.simulationCell;
+    result.positions = std::make_shared<ParticleProperty>(atoms, DataType::Double, 3, 0, false);
+    if(layout.id >= 0){
+        result.identifiers = std::make_shared<ParticleProperty>(atoms, DataType::Int, 1, 0, false);
+    }
+
+    double* positions = result.positions->dataDouble();
+    int* identifiers = result.identifiers ? result.identifiers->dataInt() : nullptr;
+    const std::size_t rowBytes = static_cast<std::size_t>(parsed.sizeOne) * sizeof(double);
+    for(const BinaryChunk& chunk : parsed.chunks){
+        tbb::parallel_for(tbb::blocked_range<std::size_t>(0, chunk.numAtoms),
+            [&](const tbb::blocked_range<std::size_t>& r){
+                for(std::size_t i = r.begin(); i < r.end(); ++i){
+                    const char* row = chunk.data + i * rowBytes;
+                    const std::size_t atom = chunk.firstAtom + i;
+                    for(std::size_t k = 0; k < 3; ++k){
+                        positions[3 * atom + k] = readDouble(row, layout.position[k]);
+                    }
+                    if(identifiers){
+                        identifiers[atom] = static_cast<int>(readDouble(row, layout.id));
+                    }
+                }
+            });
+    }
+    if(layout.scaled){
+        unscaleDumpPositions(positions, atoms, result.simulationCell);
+    }
+
+    _offset = parsed.end;
+    frame = std::move(result);
+    return true;
+}
+
+bool AtomicStrainBinaryDumpReader::skipFrame(AtomicStrainFrameInfo& info){
+    if(_offset >= _file.size()) return false;
+    const BinaryFrame parsed = parseBinaryFrame(_file.data(), _file.size(), _offset, _path, _preferUnwrapped);
+    info.timestep = parsed.timestep;
+    info.offset = _offset;
+    info.natoms = parsed.natoms;
+    info.simulationCell = parsed.simulationCell;
+    _offset = parsed.end;
+    return true;
+}
+
+void AtomicStrainBinaryDumpReader::seek(std::uint64_t offset){
+    if(offset > _file.size()) throw std::out_of_range("Frame offset beyond the end of LAMMPS binary dump: " + _path);
+    _offset = static_cast<std::size_t>(offset);
+}
+
+}
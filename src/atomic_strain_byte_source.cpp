@@ -0,0 +1,305 @@
+#include <volt/atomic_strain_byte_source.h>
+#include <volt/atomic_strain_mapped_file.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <exception>
+#include <fstream>
+#include <functional>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+#include <fcntl.h>
+#include <unistd.h>
+#include <zlib.h>
+#include <zstd.h>
+#include <tbb/parallel_for.h>
+
+namespace Volt{
+
+namespace{
+
+constexpr std::size_t BlockSize = 4u << 20;
+constexpr std::size_t MaxQueuedBlocks = 8;
+// Decompressed bytes waiting for the consumer. A larger block (a whole zstd frame) is
+// still queued once the queue has drained.
+constexpr std::size_t MaxQueuedBytes = MaxQueuedBlocks * BlockSize;
+// zstd frames larger than this are streamed instead of decompressed in one piece.
+constexpr unsigned long long MaxParallelFrameSize = 64ull << 20;
+// Decompressed bytes of the frames decompressed side by side in one batch.
+constexpr unsigned long long MaxParallelBytes = 256ull << 20;
+
+// Runs a producer on its own thread; blocks handed to emit() are returned by read()
+// in order. emit() blocks while the queue is full and returns false once the
+// consumer is gone, so the producer can stop early.
+class BackgroundSource : public ByteSource{
+public:
+    using Producer = std::function<void(const std::function<bool(std::vector<char>&&)>&)>;
+
+    explicit BackgroundSource(Producer producer)
+        : _thread([this, producer = std::move(producer)]{ run(producer); }){}
+
+    ~BackgroundSource() override{
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _cancelled = true;
+        }
+        _changed.notify_all();
+        _thread.join();
+    }
+
+    std::size_t read(char* buffer, std::size_t size) override{
+        std::size_t copied = 0;
+        while(copied < size){
+            if(_current >= _block.size()){
+                std::unique_lock<std::mutex> lock(_mutex);
+                _changed.wait(lock, [this]{ return !_blocks.empty() || _finished; });
+                if(_blocks.empty()){
+                    if(_error) std::rethrow_exception(_error);
+                    break;
+                }
+                _block = std::move(_blocks.front());
+                _blocks.pop_front();
+                _queuedBytes -= _block.size();
+                _current = 0;
+                lock.unlock();
+                _changed.notify_all();
+            }
+            const std::size_t chunk = std::min(size - copied, _block.size() - _current);
+            std::memcpy(buffer + copied, _block.data() + _current, chunk);
+            _current += chunk;
+            copied += chunk;
+        }
+        return copied;
+    }
+
+private:
+    void run(const Producer& producer){
+        try{
+            producer([this](std::vector<char>&& block){
+                std::unique_lock<std::mutex> lock(_mutex);
+                _changed.wait(lock, [this, &block]{
+                    return _cancelled || _blocks.empty() ||
+                        (_blocks.size() < MaxQueuedBlocks && _queuedBytes + block.size() <= MaxQueuedBytes);
+                });
+                if(_cancelled) return false;
+                _queuedBytes += block.size();
+                if(!block.empty()) _blocks.push_back(std::move(block));
+                lock.unlock();
+                _changed.notify_all();
+                return true;
+            });
+        }catch(...){
+            std::lock_guard<std::mutex> lock(_mutex);
+            _error = std::current_exception();
+        }
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _finished = true;
+        }
+        _changed.notify_all();
+    }
+
+    std::mutex _mutex;
+    std::condition_variable _changed;
+    std::deque<std::vector<char>> _blocks;
+    std::size_t _queuedBytes = 0;
+    bool _finished = false;
+    bool _cancelled = false;
+    std::exception_ptr _error;
+
+    std::vector<char> _block;
+    std::size_t _current = 0;
+
+    std::thread _thread;
+};
+
+// Inflates all gzip members back to back, as concatenated or bgzip files contain several.
+void inflateGzip(const std::string& path, const std::function<bool(std::vector<char>&&)>& emit){
+    const MappedFile input(path, "compressed dump", MappedFile::Access::Sequential);
+
+    z_stream stream{};
+    if(inflateInit2(&stream, 15 + 32) != Z_OK){
+        throw std::runtime_error("Cannot initialize zlib for " + path);
+    }
+    std::unique_ptr<z_stream, int(*)(z_stream*)> guard(&stream, inflateEnd);
+
+    std::size_t consumed = 0;
+    bool insideMember = false;
+    for(;;){
+        std::vector<char> block(BlockSize);
+        stream.next_out = reinterpret_cast<Bytef*>(block.data());
+        stream.avail_out = static_cast<uInt>(block.size());
+
+        while(stream.avail_out > 0){
+            if(consumed >= input.size() && !insideMember) break;
+            const std::size_t available = std::min<std::size_t>(input.size() - consumed, 1u << 30);
+            stream.next_in = const_cast<Bytef*>(input.data<unsigned char>() + consumed);
+            stream.avail_in = static_cast<uInt>(available);
+            const int status = inflate(&stream, Z_NO_FLUSH);
+            consumed += available - stream.avail_in;
+            if(status == Z_STREAM_END){
+                if(inflateReset(&stream) != Z_OK) throw std::runtime_error("Cannot reset zlib for " + path);
+                insideMember = false;
+            }else if(status == Z_OK){
+                insideMember = true;
+            }else if(status == Z_BUF_ERROR && consumed >= input.size()){
+                throw std::runtime_error("Truncated gzip data in " + path);
+            }else{
+                throw std::runtime_error("Corrupt gzip data in " + path);
+            }
+        }
+
+        block.resize(block.size() - stream.avail_out);
+        const bool finished = consumed >= input.size() && !insideMember;
+        if(!emit(std::move(block)) || finished) return;
+    }
+}
+
+struct ZstdFrame{
+    std::size_t offset;
+    std::size_t compressedSize;
+    unsigned long long contentSize;
+};
+
+void decompressZstd(const std::string& path, const std::function<bool(std::vector<char>&&)>& emit){
+    const MappedFile input(path, "compressed dump", MappedFile::Access::Sequential);
+
+    // Frame boundaries are found from the block headers without decompressing.
+    std::vector<ZstdFrame> frames;
+    bool parallel = true;
+    for(std::size_t offset = 0; offset < input.size();){
+        const std::size_t compressedSize = ZSTD_findFrameCompressedSize(input.data<unsigned char>() + offset, input.size() - offset);
+        if(ZSTD_isError(compressedSize)){
+            throw std::runtime_error("Corrupt zstd data in " + path + ": " + ZSTD_getErrorName(compressedSize));
+        }
+        const unsigned long long contentSize = ZSTD_getFrameContentSize(input.data<unsigned char>() + offset, compressedSize);
+        if(contentSize == ZSTD_CONTENTSIZE_UNKNOWN || contentSize == ZSTD_CONTENTSIZE_ERROR || contentSize > MaxParallelFrameSize){
+            parallel = false;
+        }
+        frames.push_back({ offset, compressedSize, contentSize });
+        offset += compressedSize;
+    }
+
+    // Only input of several frames, such as pzstd output, can be split up; plain
+    // "zstd -T" writes a single frame and is streamed below.
+    if(parallel && frames.size() > 1){
+        // A batch holds one frame per thread, but never more than MaxParallelBytes of
+        // decompressed output, which together with the queue bounds the memory in flight.
+        const std::size_t maxFrames = std::max<std::size_t>(2, std::thread::hardware_concurrency());
+        for(std::size_t begin = 0, end = 0; begin < frames.size(); begin = end){
+            unsigned long long bytes = 0;
+            end = begin;
+            while(end < frames.size() && end - begin < maxFrames &&
+                (end == begin || bytes + frames[end].contentSize <= MaxParallelBytes)){
+                bytes += frames[end].contentSize;
+                ++end;
+            }
+            std::vector<std::vector<char>> outputs(end - begin);
+            tbb::parallel_for(begin, end, [&](std::size_t f){
+                const ZstdFrame& frame = frames[f];
+                std::vector<char>& output = outputs[f - begin];
+                output.resize(static_cast<std::size_t>(frame.contentSize));
+                const std::size_t written = ZSTD_decompress(output.data(), output.size(), input.data<unsigned char>() + frame.offset, frame.compressedSize);
+                if(ZSTD_isError(written) || written != output.size()){
+                    throw std::runtime_error("Corrupt zstd frame in " + path);
+                }
+            });
+            for(auto& output : outputs){
+                if(!emit(std::move(output))) return;
+            }
+        }
+        return;
+    }
+
+    std::unique_ptr<ZSTD_DStream, std::size_t(*)(ZSTD_DStream*)> stream(ZSTD_createDStream(), ZSTD_freeDStream);
+    if(!stream) throw std::runtime_error("Cannot initialize zstd for " + path);
+    ZSTD_inBuffer in{ input.data<unsigned char>(), input.size(), 0 };
+    std::size_t lastResult = 0;
+    while(in.pos < in.size){
+        std::vector<char> block(BlockSize);
+        ZSTD_outBuffer out{ block.data(), block.size(), 0 };
+        while(out.pos < out.size && in.pos < in.size){
+            lastResult = ZSTD_decompressStream(stream.get(), &out, &in);
+            if(ZSTD_isError(lastResult)){
+                throw std::runtime_error("Corrupt zstd data in " + path + ": " + ZSTD_getErrorName(lastResult));
+            }
+        }
+        block.resize(out.pos);
+        if(!emit(std::move(block))) return;
+    }
+    // Flush whatever the decoder still holds for the last frame.
+    while(lastResult != 0){
+        std::vector<char> block(BlockSize);
+        ZSTD_outBuffer out{ block.data(), block.size(), 0 };
+        lastResult = ZSTD_decompressStream(stream.get(), &out, &in);
+        if(ZSTD_isError(lastResult) || (out.pos == 0 && lastResult != 0)){
+            throw std::runtime_error("Truncated zstd data in " + path);
+        }
+        block.resize(out.pos);
+        if(!emit(std::move(block))) return;
+    }
+}
+
+class PipeSource : public ByteSource{
+public:
+    PipeSource(int fd, bool owned, std::string name)
+        : _fd(fd), _owned(owned), _name(std::move(name)){}
+
+    ~PipeSource() override{
+        if(_owned) ::close(_fd);
+    }
+
+    PipeSource(const PipeSource&) = delete;
+    PipeSource& operator=(const PipeSource&) = delete;
+
+    std::size_t read(char* buffer, std::size_t size) override{
+        for(;;){
+            const ssize_t n = ::read(_fd, buffer, size);
+            if(n >= 0) return static_cast<std::size_t>(n);
+            if(errno != EINTR) throw std::runtime_error("Cannot read " + _name + ": " + std::strerror(errno));
+        }
+    }
+
+private:
+    int _fd;
+    bool _owned;
+    std::string _name;
+};
+
+}
+
+Compression detectCompression(const std::string& path){
+    std::ifstream in(path, std::ios::binary);
+    unsigned char magic[4] = {};
+    in.read(reinterpret_cast<char*>(magic), sizeof(magic));
+    const std::streamsize length = in.gcount();
+    if(length >= 2 && magic[0] == 0x1f && magic[1] == 0x8b) return Compression::Gzip;
+    if(length >= 4 && magic[0] == 0x28 && magic[1] == 0xb5 && magic[2] == 0x2f && magic[3] == 0xfd) return Compression::Zstd;
+    return Compression::None;
+}
+
+std::unique_ptr<ByteSource> openDecompressingSource(const std::string& path, Compression compression){
+    switch(compression){
+        case Compression::Gzip:
+            return std::make_unique<BackgroundSource>([path](const auto& emit){ inflateGzip(path, emit); });
+        case Compression::Zstd:
+            return std::make_unique<BackgroundSource>([path](const auto& emit){ decompressZstd(path, emit); });
+        case Compression::None:
+            break;
+    }
+    throw std::invalid_argument("Input is not compressed: " + path);
+}
+
+std::unique_ptr<ByteSource> openPipeSource(const std::string& path){
+    if(path == "-") return std::make_unique<PipeSource>(STDIN_FILENO, false, "standard input");
+    const int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if(fd < 0) throw std::runtime_error("Cannot open " + path + ": " + std::strerror(errno));
+    return std::make_unique<PipeSource>(fd, true, path);
+}
+
+}
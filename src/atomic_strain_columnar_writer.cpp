@@ -0,0 +1,248 @@
+#include <volt/atomic_strain_columnar_writer.h>
+#include <volt/atomic_strain_columnar_format.h>
+#include <volt/atomic_strain_dump_format.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <vector>
+#include <spdlog/spdlog.h>
+
+namespace Volt{
+
+using namespace Particles;
+
+namespace{
+
+constexpr std::size_t ChunkRows = 1u << 16;
+
+struct ColumnSource{
+    const char* name;
+    const ParticleProperty* property;
+    Columnar::ColumnType type;
+    std::uint32_t components;
+    double scale;
+    // Property component written at each position, nullptr for the stored order.
+    const std::uint32_t* componentOrder = nullptr;
+
+    std::size_t component(std::uint32_t c) const{
+        return componentOrder ? componentOrder[c] : c;
+    }
+};
+
+Columnar::ColumnType valueColumnType(const AtomicStrainEncodingOptions& encoding){
+    switch(encoding.encoding){
+        case AtomicStrainEncoding::Float32: return Columnar::ColumnType::Float32;
+        case AtomicStrainEncoding::Quantized: return Columnar::ColumnType::QuantizedInt32;
+        case AtomicStrainEncoding::Float64: break;
+    }
+    return Columnar::ColumnType::Float64;
+}
+
+std::vector<ColumnSource> collectColumns(
+    const AtomicStrainResult& result,
+    AtomicStrainField fields,
+    const AtomicStrainEncodingOptions& encoding
+){
+    const Columnar::ColumnType valueType = valueColumnType(encoding);
+    const double scale = valueType == Columnar::ColumnType::QuantizedInt32 ? encoding.quantizationStep() : 0.0;
+
+    std::vector<ColumnSource> columns;
+    columns.push_back({ "id", result.identifiers.get(), Columnar::ColumnType::Int32, 1, 0.0 });
+
+    const auto addValueColumn = [&](
+        AtomicStrainField field,
+        const char* name,
+        const ParticleProperty* property,
+        std::uint32_t components,
+        const std::uint32_t* componentOrder = nullptr
+    ){
+        if(hasField(fields, field) && property){
+            columns.push_back({ name, property, valueType, components, scale, componentOrder });
+        }
+    };
+    addValueColumn(AtomicStrainField::ShearStrain, "shear_strain", result.shearStrains.get(), 1);
+    addValueColumn(AtomicStrainField::VolumetricStrain, "volumetric_strain", result.volumetricStrains.get(), 1);
+    addValueColumn(AtomicStrainField::StrainTensor, "strain_tensor", result.strainTensors.get(), 6, StrainTensorOutputOrder.data());
+    addValueColumn(AtomicStrainField::DeformationGradient, "deformation_gradient", result.deformationGradients.get(), 9);
+    addValueColumn(AtomicStrainField::D2min, "D2min", result.nonaffineSquaredDisplacements.get(), 1);
+
+    if(hasField(fields, AtomicStrainField::Invalid) && result.invalidParticles){
+        columns.push_back({
+            "invalid",
+            result.invalidParticles.get(),
+            encoding.invalidBitmask ? Columnar::ColumnType::Bitmask : Columnar::ColumnType::Int32,
+            1,
+            0.0
+        });
+    }
+    return columns;
+}
+
+// Int32 codes only hold values up to about 2^31 quantization steps, and non-finite
+// values have no code at all.
+bool fitsQuantized(const AtomicStrainResult& result, const ColumnSource& column){
+    constexpr double limit = static_cast<double>(std::numeric_limits<std::int32_t>::max());
+    const std::size_t numRows = result.numRows();
+    for(std::size_t row = 0; row < numRows; ++row){
+        const std::size_t atom = result.atomIndex(row);
+        for(std::uint32_t c = 0; c < column.components; ++c){
+            const double code = column.property->getDoubleComponent(atom, c) / column.scale;
+            if(!std::isfinite(code) || std::abs(code) >= limit) return false;
+        }
+    }
+    return true;
+}
+
+// Converts rows [rowBegin, rowEnd) of a column into its on-disk representation.
+void encodeRows(
+    const AtomicStrainResult& result,
+    const ColumnSource& column,
+    std::size_t rowBegin,
+    std::size_t rowEnd,
+    std::vector<char>& out
+){
+    const std::size_t count = rowEnd - rowBegin;
+    out.assign(Columnar::payloadSize(column.type, column.components, count), 0);
+
+    for(std::size_t row = rowBegin; row < rowEnd; ++row){
+        const std::size_t atom = result.atomIndex(row);
+        const std::size_t local = row - rowBegin;
+
+        if(column.type == Columnar::ColumnType::Bitmask){
+            if(column.property->getInt(atom) != 0){
+                out[local / 8] |= static_cast<char>(1u << (local % 8));
+            }
+            continue;
+        }
+
+        for(std::uint32_t c = 0; c < column.components; ++c){
+            const std::size_t element = local * column.components + c;
+            switch(column.type){
+                case Columnar::ColumnType::Int32:{
+                    const std::int32_t value = column.property
+                        ? static_cast<std::int32_t>(column.property->getInt(atom))
+                        : static_cast<std::int32_t>(result.identifier(atom));
+                    std::memcpy(out.data() + element * 4, &value, 4);
+                    break;
+                }
+                case Columnar::ColumnType::Float64:{
+                    const double value = column.property->getDoubleComponent(atom, column.component(c));
+                    std::memcpy(out.data() + element * 8, &value, 8);
+                    break;
+                }
+                case Columnar::ColumnType::Float32:{
+                    const float value = static_cast<float>(column.property->getDoubleComponent(atom, column.component(c)));
+                    std::memcpy(out.data() + element * 4, &value, 4);
+                    break;
+                }
+                case Columnar::ColumnType::QuantizedInt32:{
+                    const std::int32_t value = static_cast<std::int32_t>(
+                        std::lround(column.property->getDoubleComponent(atom, column.component(c)) / column.scale));
+                    std::memcpy(out.data() + element * 4, &value, 4);
+                    break;
+                }
+                case Columnar::ColumnType::Bitmask:
+                    break;
+            }
+        }
+    }
+}
+
+// Columns stored with their in-memory layout can be written straight from the
+// ParticleProperty buffer.
+const void* directPayload(const AtomicStrainResult& result, const ColumnSource& column){
+    if(result.rows || !column.property || column.componentOrder) return nullptr;
+    const std::size_t first = result.rowBegin * column.components;
+    if(column.type == Columnar::ColumnType::Float64 && column.property->dataType() == DataType::Double){
+        return column.property->constDataDouble() + first;
+    }
+    if(column.type == Columnar::ColumnType::Int32 && column.property->dataType() == DataType::Int){
+        return column.property->constDataInt() + first;
+    }
+    return nullptr;
+}
+
+}
+
+bool writeColumnarResult(
+    const AtomicStrainResult& result,
+    AtomicStrainField fields,
+    const AtomicStrainEncodingOptions& encoding,
+    bool checksums,
+    const std::string& path,
+    FileWriteMode mode
+){
+    std::vector<ColumnSource> sources = collectColumns(result, fields, encoding);
+    for(ColumnSource& source : sources){
+        if(source.type == Columnar::ColumnType::QuantizedInt32 && !fitsQuantized(result, source)){
+            spdlog::warn("Column {} exceeds the quantized range at error bound {}, storing it as float64", source.name, encoding.errorBound);
+            source.type = Columnar::ColumnType::Float64;
+            source.scale = 0.0;
+        }
+    }
+    const std::uint64_t numRows = result.numRows();
+
+    Columnar::FileHeader header{};
+    std::memcpy(header.magic, Columnar::Magic, sizeof(header.magic));
+    header.version = Columnar::Version;
+    header.flags = checksums ? static_cast<std::uint32_t>(Columnar::HasChecksums) : 0u;
+    header.numRows = numRows;
+    header.numColumns = static_cast<std::uint32_t>(sources.size());
+    header.columnTableOffset = sizeof(Columnar::FileHeader);
+    cellToArray(result.cell, header.cell, header.pbc);
+
+    std::vector<Columnar::ColumnEntry> entries(sources.size());
+    std::uint64_t offset = Columnar::alignUp(header.columnTableOffset + entries.size() * sizeof(Columnar::ColumnEntry));
+    for(std::size_t i = 0; i < sources.size(); ++i){
+        Columnar::ColumnEntry& entry = entries[i];
+        std::strncpy(entry.name, sources[i].name, sizeof(entry.name) - 1);
+        entry.type = sources[i].type;
+        entry.components = sources[i].components;
+        entry.offset = offset;
+        entry.size = Columnar::payloadSize(entry.type, entry.components, numRows);
+        entry.checksum = 0;
+        entry.scale = sources[i].scale;
+        offset = Columnar::alignUp(offset + entry.size);
+    }
+    header.fileSize = offset;
+
+    BufferedFileWriter writer(BufferedFileWriter::DefaultBufferSize, mode);
+    if(!writer.open(path, header.fileSize)) return false;
+    writer.write(&header, sizeof(header));
+    writer.write(entries.data(), entries.size() * sizeof(Columnar::ColumnEntry));
+
+    std::vector<char> staging;
+    for(std::size_t i = 0; i < sources.size(); ++i){
+        Columnar::ColumnEntry& entry = entries[i];
+        writer.writePadding(Columnar::Alignment);
+        std::uint64_t hash = Columnar::ChecksumSeed;
+
+        if(const void* payload = directPayload(result, sources[i])){
+            writer.write(payload, entry.size);
+            if(checksums) hash = Columnar::checksum(payload, entry.size, hash);
+        }else{
+            for(std::size_t rowBegin = 0; rowBegin < numRows; rowBegin += ChunkRows){
+                const std::size_t rowEnd = std::min<std::size_t>(numRows, rowBegin + ChunkRows);
+                encodeRows(result, sources[i], rowBegin, rowEnd, staging);
+                writer.write(staging.data(), staging.size());
+                if(checksums) hash = Columnar::checksum(staging.data(), staging.size(), hash);
+            }
+        }
+        entry.checksum = checksums ? hash : 0;
+    }
+    writer.writePadding(Columnar::Alignment);
+
+    if(checksums){
+        writer.writeAt(header.columnTableOffset, entries.data(), entries.size() * sizeof(Columnar::ColumnEntry));
+    }
+
+    if(!writer.close()){
+        spdlog::warn("Failed to write columnar atomic strain result: {}", path);
+        return false;
+    }
+    return true;
+}
+
+}
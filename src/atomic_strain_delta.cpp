@@ -0,0 +1,261 @@
+#include <volt/atomic_strain_delta.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <numeric>
+#include <stdexcept>
+#include <tbb/parallel_for.h>
+#include <tbb/blocked_range.h>
+
+namespace Volt{
+
+using namespace Particles;
+using json = nlohmann::json;
+
+namespace{
+
+struct DeltaField{
+    std::string name;
+    const ParticleProperty* property;
+    std::size_t components;
+    // Property component written at each position, nullptr for the stored order.
+    const std::uint32_t* componentOrder = nullptr;
+};
+
+std::vector<DeltaField> collectFields(const AtomicStrainResult& result, AtomicStrainField fields){
+    std::vector<DeltaField> columns;
+    const auto add = [&](
+        AtomicStrainField field,
+        const char* name,
+        const std::shared_ptr<ParticleProperty>& property,
+        std::size_t components,
+        const std::uint32_t* componentOrder = nullptr
+    ){
+        if(hasField(fields, field) && property) columns.push_back({ name, property.get(), components, componentOrder });
+    };
+    add(AtomicStrainField::ShearStrain, "shear_strain", result.shearStrains, 1);
+    add(AtomicStrainField::VolumetricStrain, "volumetric_strain", result.volumetricStrains, 1);
+    add(AtomicStrainField::StrainTensor, "strain_tensor", result.strainTensors, 6, StrainTensorOutputOrder.data());
+    add(AtomicStrainField::DeformationGradient, "deformation_gradient", result.deformationGradients, 9);
+    add(AtomicStrainField::D2min, "D2min", result.nonaffineSquaredDisplacements, 1);
+    add(AtomicStrainField::Invalid, "invalid", result.invalidParticles, 1);
+    return columns;
+}
+
+bool isFlagField(const DeltaField& column){
+    return column.name == "invalid";
+}
+
+// Values as the decoder will see them: rounded to float32 or to the quantization
+// step for the value fields, flags unchanged.
+void gatherValues(const std::vector<DeltaField>& columns, std::size_t atom, const AtomicStrainEncodingOptions& encoding, double* out){
+    for(const DeltaField& column : columns){
+        if(isFlagField(column)){
+            *out++ = column.property->getInt(atom);
+            continue;
+        }
+        for(std::size_t c = 0; c < column.components; ++c){
+            const std::size_t component = column.componentOrder ? column.componentOrder[c] : c;
+            const double value = column.property->getDoubleComponent(atom, component);
+            switch(encoding.encoding){
+                case AtomicStrainEncoding::Float32:
+                    *out++ = static_cast<double>(static_cast<float>(value));
+                    break;
+                case AtomicStrainEncoding::Quantized:
+                    *out++ = std::round(value / encoding.quantizationStep()) * encoding.quantizationStep();
+                    break;
+                case AtomicStrainEncoding::Float64:
+                    *out++ = value;
+                    break;
+            }
+        }
+    }
+}
+
+// Quantized values are written as codes (value / scale), integers where they fit
+// into int64; everything else as plain numbers.
+json encodedValue(double value, bool flag, const AtomicStrainEncodingOptions& encoding){
+    if(!flag && encoding.encoding == AtomicStrainEncoding::Quantized){
+        const double code = std::round(value / encoding.quantizationStep());
+        if(std::abs(code) < 9.0e18) return static_cast<std::int64_t>(code);
+        return code;
+    }
+    return value;
+}
+
+}
+
+AtomicStrainDeltaEncoder::AtomicStrainDeltaEncoder(std::size_t keyframeInterval, double tolerance)
+    : _keyframeInterval(std::max<std::size_t>(1, keyframeInterval))
+    , _tolerance(tolerance){}
+
+void AtomicStrainDeltaEncoder::reset(){
+    _frame = 0;
+    _fields.clear();
+    _stride = 0;
+    _slots.clear();
+    _values.clear();
+    _freeSlots.clear();
+    _numSlots = 0;
+}
+
+json AtomicStrainDeltaEncoder::encode(
+    const AtomicStrainResult& result,
+    AtomicStrainField fields,
+    const AtomicStrainEncodingOptions& encoding
+){
+    const std::vector<DeltaField> columns = collectFields(result, fields);
+    std::vector<std::string> names;
+    std::vector<std::size_t> components;
+    std::vector<unsigned char> flags;
+    for(const DeltaField& column : columns){
+        names.push_back(column.name);
+        components.push_back(column.components);
+        flags.insert(flags.end(), column.components, isFlagField(column) ? 1 : 0);
+    }
+    const std::size_t stride = std::accumulate(components.begin(), components.end(), std::size_t{0});
+    const double scale = encoding.encoding == AtomicStrainEncoding::Quantized ? encoding.quantizationStep() : 0.0;
+
+    const bool keyframe = _frame % _keyframeInterval == 0 || names != _fields ||
+        encoding.encoding != _encoding || scale != _scale;
+    const std::size_t numRows = result.numRows();
+
+    // Current values of every row, gathered in parallel.
+    std::vector<double> current(numRows * stride);
+    std::vector<int> ids(numRows);
+    std::vector<unsigned char> changed(numRows, 1);
+    std::vector<unsigned char> seen(keyframe ? 0 : _numSlots, 0);
+
+    tbb::parallel_for(tbb::blocked_range<std::size_t>(0, numRows),
+        [&](const tbb::blocked_range<std::size_t>& r){
+            for(std::size_t row = r.begin(); row < r.end(); ++row){
+                const std::size_t atom = result.atomIndex(row);
+                ids[row] = result.identifier(atom);
+                double* values = current.data() + row * stride;
+                gatherValues(columns, atom, encoding, values);
+                if(keyframe) continue;
+
+                auto it = _slots.find(ids[row]);
+                if(it == _slots.end()) continue;
+                seen[it->second] = 1;
+                const double* previous = _values.data() + it->second * stride;
+                bool moved = false;
+                for(std::size_t c = 0; c < stride && !moved; ++c){
+                    moved = std::abs(values[c] - previous[c]) > _tolerance;
+                }
+                changed[row] = moved ? 1 : 0;
+            }
+        });
+
+    json record;
+    record["keyframe"] = keyframe;
+    record["frame"] = _frame;
+    record["tolerance"] = _tolerance;
+    record["fields"] = names;
+    record["components"] = components;
+    record["encoding"] = atomicStrainEncodingName(encoding.encoding);
+    if(scale > 0.0) record["scale"] = scale;
+
+    json removed = json::array();
+    if(keyframe){
+        _fields = names;
+        _stride = stride;
+        _encoding = encoding.encoding;
+        _scale = scale;
+        _slots.clear();
+        _values.clear();
+        _freeSlots.clear();
+        _numSlots = 0;
+    }else{
+        // Slots of atoms that disappeared are reused by atoms appearing later, so the
+        // state never holds more slots than atoms were present at once.
+        for(auto it = _slots.begin(); it != _slots.end();){
+            if(!seen[it->second]){
+                removed.push_back(it->first);
+                _freeSlots.push_back(it->second);
+                it = _slots.erase(it);
+            }else{
+                ++it;
+            }
+        }
+    }
+
+    json outIds = json::array();
+    json outValues = json::array();
+    for(std::size_t row = 0; row < numRows; ++row){
+        if(!changed[row]) continue;
+        const double* values = current.data() + row * stride;
+        outIds.push_back(ids[row]);
+        for(std::size_t c = 0; c < stride; ++c) outValues.push_back(encodedValue(values[c], flags[c] != 0, encoding));
+
+        const auto it = _slots.find(ids[row]);
+        std::size_t slot = 0;
+        if(it != _slots.end()){
+            slot = it->second;
+        }else if(!_freeSlots.empty()){
+            slot = _freeSlots.back();
+            _freeSlots.pop_back();
+            _slots.emplace(ids[row], slot);
+        }else{
+            slot = _numSlots++;
+            _slots.emplace(ids[row], slot);
+            _values.resize(_numSlots * stride);
+        }
+        std::copy(values, values + stride, _values.begin() + slot * stride);
+    }
+
+    record["ids"] = std::move(outIds);
+    record["values"] = std::move(outValues);
+    record["removed_ids"] = std::move(removed);
+    ++_frame;
+    return record;
+}
+
+void AtomicStrainDeltaDecoder::apply(const json& record){
+    const bool keyframe = record.at("keyframe").get<bool>();
+    if(!keyframe && !_hasKeyframe){
+        throw std::runtime_error("Atomic strain delta record applied before any keyframe.");
+    }
+
+    if(keyframe){
+        auto fields = record.at("fields").get<std::vector<std::string>>();
+        auto components = record.at("components").get<std::vector<std::size_t>>();
+        if(components.size() != fields.size()){
+            throw std::runtime_error("Atomic strain delta keyframe lists " + std::to_string(fields.size()) +
+                " fields but " + std::to_string(components.size()) + " component counts.");
+        }
+        _hasKeyframe = true;
+        _atoms.clear();
+        _fields = std::move(fields);
+        _components = std::move(components);
+        _stride = std::accumulate(_components.begin(), _components.end(), std::size_t{0});
+        _scale = record.value("scale", 0.0);
+        _flags.clear();
+        for(std::size_t f = 0; f < _fields.size(); ++f){
+            _flags.insert(_flags.end(), _components[f], _fields[f] == "invalid" ? 1 : 0);
+        }
+    }
+
+    const auto& ids = record.at("ids");
+    const auto& values = record.at("values");
+    if(!ids.is_array() || !values.is_array() || values.size() != ids.size() * _stride){
+        throw std::runtime_error("Atomic strain delta record does not hold " + std::to_string(_stride) +
+            " values for each of its atoms.");
+    }
+
+    for(const auto& id : record.at("removed_ids")){
+        _atoms.erase(id.get<int>());
+    }
+
+    for(std::size_t i = 0; i < ids.size(); ++i){
+        std::vector<double>& atom = _atoms[ids.at(i).get<int>()];
+        atom.resize(_stride);
+        for(std::size_t c = 0; c < _stride; ++c){
+            const double value = values.at(i * _stride + c).get<double>();
+            atom[c] = _scale > 0.0 && !_flags[c] ? value * _scale : value;
+        }
+    }
+}
+
+}
@@ -0,0 +1,136 @@
+#include <volt/atomic_strain_directory_watch.h>
+#include <volt/atomic_strain_service.h>
+#include <volt/atomic_strain_frame_index.h>
+#include <volt/atomic_strain_frame_reader.h>
+#include <volt/atomic_strain_snapshot.h>
+#include <volt/atomic_strain_prepared_reference.h>
+#include <volt/atomic_strain_timesteps.h>
+#include <volt/cli/common.h>
+
+#include <cerrno>
+#include <cstring>
+#include <exception>
+#include <filesystem>
+#include <stdexcept>
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#include <spdlog/spdlog.h>
+
+namespace Volt{
+
+namespace{
+
+// Room for many events per read; every event carries at most NAME_MAX + 1 name bytes.
+constexpr std::size_t EventBufferSize = 64u << 10;
+
+// Analyzes every frame of one dump within [first, last], writing the results next to it.
+// Returns once the dump's asynchronous writes have finished, false if any of them failed.
+bool analyzeDump(AtomicStrainService& analyzer, const std::string& path, long long first, long long last, bool preferUnwrapped){
+    const std::string outputBase = CLI::deriveOutputBase(path, "");
+    std::size_t analyzed = 0;
+    bool ok = true;
+    try{
+        auto reader = openDumpReader(path, preferUnwrapped);
+        AtomicStrainFrame frame;
+        while(ok && reader->readFrame(frame)){
+            if(frame.timestep < first || frame.timestep > last) continue;
+            ok = analyzeFrame(analyzer, frame, outputBase);
+            ++analyzed;
+        }
+    }catch(const std::exception& e){
+        spdlog::error("{}", e.what());
+        ok = false;
+    }
+    const bool written = finishWrites(analyzer);
+    if(!ok || !written) return false;
+    if(analyzed == 0) spdlog::warn("No frames to analyze in {}", path);
+    return true;
+}
+
+}
+
+AtomicStrainDirectoryWatch::AtomicStrainDirectoryWatch(const std::string& directory)
+    : _directory(directory){
+    _fd = ::inotify_init1(IN_CLOEXEC | IN_NONBLOCK);
+    if(_fd < 0) throw std::runtime_error(std::string("Cannot initialize inotify: ") + std::strerror(errno));
+    if(::inotify_add_watch(_fd, directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO | IN_ONLYDIR) < 0){
+        const int error = errno;
+        ::close(_fd);
+        throw std::runtime_error("Cannot watch " + directory + ": " + std::strerror(error));
+    }
+}
+
+AtomicStrainDirectoryWatch::~AtomicStrainDirectoryWatch(){
+    if(_fd >= 0) ::close(_fd);
+}
+
+std::vector<std::string> AtomicStrainDirectoryWatch::wait(int timeoutMs){
+    std::vector<std::string> paths;
+    pollfd descriptor{ _fd, POLLIN, 0 };
+    const int ready = ::poll(&descriptor, 1, timeoutMs);
+    if(ready < 0 && errno != EINTR) throw std::runtime_error(std::string("Cannot wait for inotify events: ") + std::strerror(errno));
+    if(ready <= 0) return paths;
+
+    alignas(inotify_event) char buffer[EventBufferSize];
+    for(;;){
+        const ssize_t length = ::read(_fd, buffer, sizeof(buffer));
+        if(length < 0){
+            if(errno == EINTR) continue;
+            if(errno == EAGAIN) break;
+            throw std::runtime_error(std::string("Cannot read inotify events: ") + std::strerror(errno));
+        }
+        for(ssize_t offset = 0; offset < length;){
+            const auto* event = reinterpret_cast<const inotify_event*>(buffer + offset);
+            if(event->mask & IN_Q_OVERFLOW){
+                spdlog::warn("inotify event queue overflowed, files added to {} may have been missed", _directory);
+            }
+            if(event->len > 0 && !(event->mask & IN_ISDIR)){
+                paths.push_back((std::filesystem::path(_directory) / event->name).string());
+            }
+            offset += sizeof(inotify_event) + event->len;
+        }
+    }
+    return paths;
+}
+
+bool isWatchedDump(const std::filesystem::path& path){
+    const std::string name = path.filename().string();
+    if(name.empty() || name.front() == '.' || name.find("_atomic_strain") != std::string::npos) return false;
+    const std::string extension = path.extension().string();
+    for(const char* skipped : { FrameIndex::Extension, Snapshot::Extension, PreparedReference::Extension, ".tmp", ".lock" }){
+        if(extension == skipped) return false;
+    }
+    return true;
+}
+
+bool watchDirectory(
+    AtomicStrainService& analyzer,
+    const std::string& directory,
+    long long first,
+    long long last,
+    bool preferUnwrapped,
+    const std::function<bool()>& stopRequested
+){
+    try{
+        AtomicStrainDirectoryWatch watch(directory);
+        spdlog::info("Watching {} for new dumps", directory);
+        while(!stopRequested()){
+            for(const std::string& path : watch.wait(1000)){
+                if(stopRequested()) break;
+                if(!isWatchedDump(path)) continue;
+                spdlog::info("Analyzing {}", path);
+                if(!analyzeDump(analyzer, path, first, last, preferUnwrapped)){
+                    spdlog::error("Skipping {}", path);
+                }
+            }
+        }
+    }catch(const std::exception& e){
+        spdlog::error("{}", e.what());
+        return false;
+    }
+    spdlog::info("Stopped watching {}", directory);
+    return true;
+}
+
+}
@@ -0,0 +1,158 @@
+#include <volt/atomic_strain_dump_format.h>
+
+#include <algorithm>
+#include <stdexcept>
+#include <sys/stat.h>
+#include <tbb/parallel_for.h>
+#include <tbb/blocked_range.h>
+
+namespace Volt{
+
+int DumpColumnLayout::lastUsed() const{
+    return std::max({ id, position[0], position[1], position[2] });
+}
+
+DumpColumnLayout findDumpColumns(const std::vector<std::string_view>& names, const std::string& path, bool preferUnwrapped){
+    static constexpr std::array<std::array<std::string_view, 3>, 4> Wrapped{{
+        {{ "x", "y", "z" }},
+        {{ "xu", "yu", "zu" }},
+        {{ "xs", "ys", "zs" }},
+        {{ "xsu", "ysu", "zsu" }}
+    }};
+    static constexpr std::array<std::array<std::string_view, 3>, 4> Unwrapped{{
+        {{ "xu", "yu", "zu" }},
+        {{ "x", "y", "z" }},
+        {{ "xsu", "ysu", "zsu" }},
+        {{ "xs", "ys", "zs" }}
+    }};
+    const auto& Candidates = preferUnwrapped ? Unwrapped : Wrapped;
+
+    DumpColumnLayout layout;
+    for(std::size_t i = 0; i < names.size(); ++i){
+        if(names[i] == "id") layout.id = static_cast<int>(i);
+    }
+    for(std::size_t c = 0; c < Candidates.size() && layout.position[0] < 0; ++c){
+        std::array<int, 3> found{ -1, -1, -1 };
+        for(std::size_t i = 0; i < names.size(); ++i){
+            for(std::size_t k = 0; k < 3; ++k){
+                if(names[i] == Candidates[c][k]) found[k] = static_cast<int>(i);
+            }
+        }
+        if(found[0] >= 0 && found[1] >= 0 && found[2] >= 0){
+            layout.position = found;
+            layout.scaled = c >= 2;
+        }
+    }
+    if(layout.position[0] < 0){
+        throw std::runtime_error("LAMMPS dump has no position columns: " + path);
+    }
+    return layout;
+}
+
+SimulationCell makeDumpCell(
+    const double lo[3],
+    const double hi[3],
+    const double tilt[3],
+    const std::array<bool, 3>& pbc
+){
+    const double xy = tilt[0], xz = tilt[1], yz = tilt[2];
+    const double xlo = lo[0] - std::min({ 0.0, xy, xz, xy + xz });
+    const double xhi = hi[0] - std::max({ 0.0, xy, xz, xy + xz });
+    const double ylo = lo[1] - std::min(0.0, yz);
+    const double yhi = hi[1] - std::max(0.0, yz);
+    const double zlo = lo[2];
+    const double zhi = hi[2];
+
+    AffineTransformation matrix;
+    matrix(0, 0) = xhi - xlo; matrix(0, 1) = xy;        matrix(0, 2) = xz;        matrix(0, 3) = xlo;
+    matrix(1, 0) = 0.0;       matrix(1, 1) = yhi - ylo; matrix(1, 2) = yz;        matrix(1, 3) = ylo;
+    matrix(2, 0) = 0.0;       matrix(2, 1) = 0.0;       matrix(2, 2) = zhi - zlo; matrix(2, 3) = zlo;
+
+    SimulationCell cell;
+    cell.setMatrix(matrix);
+    cell.setPbcFlags(pbc[0], pbc[1], pbc[2]);
+    return cell;
+}
+
+SimulationCell makeGeneralDumpCell(
+    const double edges[3][3],
+    const double origin[3],
+    const std::array<bool, 3>& pbc
+){
+    AffineTransformation matrix;
+    for(std::size_t r = 0; r < 3; ++r){
+        for(std::size_t c = 0; c < 3; ++c){
+            matrix(r, c) = edges[c][r];
+        }
+        matrix(r, 3) = origin[r];
+    }
+
+    SimulationCell cell;
+    cell.setMatrix(matrix);
+    cell.setPbcFlags(pbc[0], pbc[1], pbc[2]);
+    return cell;
+}
+
+void unscaleDumpPositions(double* positions, std::size_t natoms, const SimulationCell& cell){
+    const AffineTransformation& m = cell.matrix();
+    tbb::parallel_for(tbb::blocked_range<std::size_t>(0, natoms),
+        [&](const tbb::blocked_range<std::size_t>& r){
+            for(std::size_t atom = r.begin(); atom < r.end(); ++atom){
+                double* p = positions + 3 * atom;
+                const double s[3] = { p[0], p[1], p[2] };
+                for(std::size_t k = 0; k < 3; ++k){
+                    p[k] = m(k, 3) + m(k, 0) * s[0] + m(k, 1) * s[1] + m(k, 2) * s[2];
+                }
+            }
+        });
+}
+
+DumpStamp stampDump(const std::string& path){
+    struct stat st{};
+    if(::stat(path.c_str(), &st) != 0) throw std::runtime_error("Cannot stat LAMMPS dump: " + path);
+    return {
+        static_cast<std::uint64_t>(st.st_size),
+        static_cast<std::int64_t>(st.st_mtim.tv_sec) * 1000000000 + st.st_mtim.tv_nsec
+    };
+}
+
+std::array<double, 12> cellToArray(const SimulationCell& cell){
+    std::array<double, 12> matrix;
+    for(std::size_t r = 0; r < 3; ++r){
+        for(std::size_t c = 0; c < 4; ++c){
+            matrix[r * 4 + c] = cell.matrix()(r, c);
+        }
+    }
+    return matrix;
+}
+
+void cellToArray(const SimulationCell& cell, double (&matrix)[12], std::uint32_t (&pbc)[3]){
+    const std::array<double, 12> values = cellToArray(cell);
+    std::copy(values.begin(), values.end(), matrix);
+    for(std::size_t r = 0; r < 3; ++r){
+        pbc[r] = cell.pbcFlags()[r] ? 1 : 0;
+    }
+}
+
+SimulationCell cellFromArray(const double (&matrix)[12], const std::uint32_t (&pbc)[3]){
+    AffineTransformation m;
+    for(std::size_t r = 0; r < 3; ++r){
+        for(std::size_t c = 0; c < 4; ++c){
+            m(r, c) = matrix[r * 4 + c];
+        }
+    }
+    SimulationCell cell;
+    cell.setMatrix(m);
+    cell.setPbcFlags(pbc[0] != 0, pbc[1] != 0, pbc[2] != 0);
+    return cell;
+}
+
+FrameRecord makeFrameRecord(std::int64_t timestep, std::uint64_t natoms, const SimulationCell& cell){
+    FrameRecord record{};
+    record.timestep = timestep;
+    record.natoms = natoms;
+    cellToArray(cell, record.cell, record.pbc);
+    return record;
+}
+
+}
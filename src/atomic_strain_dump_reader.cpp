@@ -0,0 +1,542 @@
+#include <volt/atomic_strain_dump_reader.h>
+#include <volt/atomic_strain_dump_format.h>
+
+#include <algorithm>
+#include <array>
+#include <charconv>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <string_view>
+#include <vector>
+#include <tbb/parallel_for.h>
+
+namespace Volt{
+
+using namespace Volt::Particles;
+
+namespace{
+
+enum class ColumnAction : std::uint8_t{
+    Skip,
+    Identifier,
+    PositionX,
+    PositionY,
+    PositionZ
+};
+
+// Column layout of an "ITEM: ATOMS" section. The projection lists what to do with
+// each column up to the last one the engine needs; later columns are never tokenized.
+struct AtomColumns{
+    DumpColumnLayout layout;
+    std::vector<ColumnAction> projection;
+};
+
+bool isBlank(char c){
+    return c == ' ' || c == '\t' || c == '\r';
+}
+
+std::string_view trim(std::string_view s){
+    while(!s.empty() && isBlank(s.front())) s.remove_prefix(1);
+    while(!s.empty() && isBlank(s.back())) s.remove_suffix(1);
+    return s;
+}
+
+std::vector<std::string_view> splitFields(std::string_view line){
+    std::vector<std::string_view> fields;
+    std::size_t i = 0;
+    while(i < line.size()){
+        while(i < line.size() && isBlank(line[i])) ++i;
+        const std::size_t begin = i;
+        while(i < line.size() && !isBlank(line[i])) ++i;
+        if(i > begin) fields.push_back(line.substr(begin, i - begin));
+    }
+    return fields;
+}
+
+template<typename T>
+const char* parseNumber(const char* begin, const char* end, T& value){
+    if(begin != end && *begin == '+') ++begin;
+    const auto [ptr, ec] = std::from_chars(begin, end, value);
+    return ec == std::errc() ? ptr : nullptr;
+}
+
+template<typename T>
+T parseField(std::string_view field, const std::string& path, const char* what){
+    T value{};
+    const char* end = field.data() + field.size();
+    if(parseNumber(field.data(), end, value) != end){
+        throw std::runtime_error("Invalid " + std::string(what) + " in LAMMPS dump " + path + ": " + std::string(field));
+    }
+    return value;
+}
+
+class LineCursor{
+public:
+    LineCursor(const char* data, std::size_t size, std::size_t offset)
+        : _data(data), _size(size), _offset(offset){}
+
+    bool atEnd() const{
+        return _offset >= _size;
+    }
+
+    std::string_view next(){
+        const char* begin = _data + _offset;
+        const void* newline = std::memchr(begin, '\n', _size - _offset);
+        const std::size_t length = newline ? static_cast<const char*>(newline) - begin : _size - _offset;
+        _offset += length + (newline ? 1 : 0);
+        return trim(std::string_view(begin, length));
+    }
+
+    std::size_t offset() const{
+        return _offset;
+    }
+
+private:
+    const char* _data;
+    std::size_t _size;
+    std::size_t _offset;
+};
+
+AtomColumns parseAtomColumns(const std::vector<std::string_view>& fields, const std::string& path, bool preferUnwrapped){
+    // "ITEM: ATOMS <names...>"
+    AtomColumns columns;
+    columns.layout = findDumpColumns({ fields.begin() + 2, fields.end() }, path, preferUnwrapped);
+
+    const DumpColumnLayout& layout = columns.layout;
+    columns.projection.assign(static_cast<std::size_t>(layout.lastUsed()) + 1, ColumnAction::Skip);
+    if(layout.id >= 0) columns.projection[layout.id] = ColumnAction::Identifier;
+    columns.projection[layout.position[0]] = ColumnAction::PositionX;
+    columns.projection[layout.position[1]] = ColumnAction::PositionY;
+    columns.projection[layout.position[2]] = ColumnAction::PositionZ;
+    return columns;
+}
+
+template<typename Lines>
+SimulationCell parseBox(const std::vector<std::string_view>& fields, Lines& cursor, const std::string& path){
+    // "ITEM: BOX BOUNDS [xy xz yz] pp pp pp"
+    const bool triclinic = fields.size() >= 6 && fields[3] == "xy";
+    const std::size_t flagsBegin = triclinic ? 6 : 3;
+
+    std::array<bool, 3> pbc{ true, true, true };
+    for(std::size_t k = 0; k < 3 && flagsBegin + k < fields.size(); ++k){
+        pbc[k] = fields[flagsBegin + k] == "pp";
+    }
+
+    double lo[3], hi[3], tilt[3] = { 0.0, 0.0, 0.0 };
+    for(std::size_t k = 0; k < 3; ++k){
+        if(cursor.atEnd()) throw std::runtime_error("Truncated box bounds in LAMMPS dump: " + path);
+        const auto values = splitFields(cursor.next());
+        if(values.size() < (triclinic ? 3u : 2u)){
+            throw std::runtime_error("Invalid box bounds in LAMMPS dump: " + path);
+        }
+        lo[k] = parseField<double>(values[0], path, "box bound");
+        hi[k] = parseField<double>(values[1], path, "box bound");
+        if(triclinic) tilt[k] = parseField<double>(values[2], path, "tilt factor");
+    }
+
+    return makeDumpCell(lo, hi, tilt, pbc);
+}
+
+bool isTokenEnd(const char* p, const char* end){
+    return p >= end || isBlank(*p) || *p == '\n';
+}
+
+// Parses natoms atom lines starting at begin following the column projection:
+// skipped columns are only stepped over, never converted, and everything after the
+// last projected column is passed over with memchr. Returns the end of the last line.
+const char* parseAtomLines(
+    const char* begin,
+    const char* end,
+    std::size_t natoms,
+    const AtomColumns& columns,
+    double* positions,
+    int* identifiers,
+    const std::string& path
+){
+    const char* p = begin;
+    for(std::size_t atom = 0; atom < natoms; ++atom){
+        for(const ColumnAction action : columns.projection){
+            while(p < end && isBlank(*p)) ++p;
+            if(p >= end || *p == '\n'){
+                throw std::runtime_error("Truncated atom line in LAMMPS dump: " + path);
+            }
+
+            const char* next = p;
+            switch(action){
+                case ColumnAction::Skip:
+                    while(!isTokenEnd(next, end)) ++next;
+                    break;
+                case ColumnAction::Identifier:
+                    next = parseNumber(p, end, identifiers[atom]);
+                    break;
+                case ColumnAction::PositionX:
+                    next = parseNumber(p, end, positions[3 * atom]);
+                    break;
+                case ColumnAction::PositionY:
+                    next = parseNumber(p, end, positions[3 * atom + 1]);
+                    break;
+                case ColumnAction::PositionZ:
+                    next = parseNumber(p, end, positions[3 * atom + 2]);
+                    break;
+            }
+            if(!next || !isTokenEnd(next, end)){
+                throw std::runtime_error("Invalid atom line in LAMMPS dump: " + path);
+            }
+            p = next;
+        }
+
+        const void* newline = std::memchr(p, '\n', end - p);
+        p = newline ? static_cast<const char*>(newline) + 1 : end;
+    }
+    return p;
+}
+
+// Newline-aligned piece of an ATOMS section holding numAtoms lines.
+struct AtomChunk{
+    const char* begin;
+    const char* end;
+    std::size_t firstAtom;
+    std::size_t numAtoms;
+};
+
+constexpr std::size_t ChunkBytes = 4u << 20;
+constexpr std::size_t StreamReadSize = 4u << 20;
+constexpr std::size_t StreamRegionSize = 64u << 20;
+constexpr std::size_t ChunksPerBatch = 64;
+
+// First pass: cuts the text after begin into newline-aligned chunks and counts their
+// lines in parallel, batch by batch, until natoms lines are covered. The chunk that
+// contains the last atom line is cut right after it.
+std::vector<AtomChunk> splitAtomSection(const char* begin, const char* fileEnd, std::size_t natoms){
+    std::vector<AtomChunk> chunks;
+    std::size_t atoms = 0;
+    const char* p = begin;
+    while(atoms < natoms && p < fileEnd){
+        std::vector<AtomChunk> batch;
+        while(batch.size() < ChunksPerBatch && p < fileEnd){
+            const char* chunkEnd = fileEnd;
+            if(static_cast<std::size_t>(fileEnd - p) > ChunkBytes){
+                const void* newline = std::memchr(p + ChunkBytes, '\n', fileEnd - (p + ChunkBytes));
+                chunkEnd = newline ? static_cast<const char*>(newline) + 1 : fileEnd;
+            }
+            batch.push_back({ p, chunkEnd, 0, 0 });
+            p = chunkEnd;
+        }
+
+        tbb::parallel_for(std::size_t(0), batch.size(), [&batch, fileEnd](std::size_t i){
+            AtomChunk& chunk = batch[i];
+            chunk.numAtoms = static_cast<std::size_t>(std::count(chunk.begin, chunk.end, '\n'));
+            // A last line without trailing newline still counts.
+            if(chunk.end == fileEnd && chunk.end > chunk.begin && chunk.end[-1] != '\n') ++chunk.numAtoms;
+        });
+
+        for(AtomChunk& chunk : batch){
+            chunk.firstAtom = atoms;
+            if(atoms + chunk.numAtoms >= natoms){
+                chunk.numAtoms = natoms - atoms;
+                const char* cut = chunk.begin;
+                for(std::size_t line = 0; line < chunk.numAtoms && cut < chunk.end; ++line){
+                    const void* newline = std::memchr(cut, '\n', chunk.end - cut);
+                    cut = newline ? static_cast<const char*>(newline) + 1 : chunk.end;
+                }
+                chunk.end = cut;
+                atoms = natoms;
+                chunks.push_back(chunk);
+                break;
+            }
+            atoms += chunk.numAtoms;
+            chunks.push_back(chunk);
+        }
+    }
+    return chunks;
+}
+
+// Reads the header items of the next frame up to and including "ITEM: ATOMS".
+// Returns false if only blank lines remain.
+template<typename Lines>
+bool parseFrameHeader(Lines& lines, AtomicStrainFrame& result, AtomColumns& columns, const std::string& path, bool preferUnwrapped){
+    std::string_view line;
+    do{
+        if(lines.atEnd()) return false;
+        line = lines.next();
+    }while(line.empty());
+    if(line != "ITEM: TIMESTEP"){
+        throw std::runtime_error("Expected ITEM: TIMESTEP in LAMMPS dump " + path + ": " + std::string(line));
+    }
+
+    bool hasBox = false;
+    bool hasCount = false;
+    for(;;){
+        bool nextItemRead = false;
+        if(line == "ITEM: TIMESTEP"){
+            result.timestep = parseField<long long>(lines.next(), path, "timestep");
+        }else if(line == "ITEM: NUMBER OF ATOMS"){
+            result.natoms = parseField<std::size_t>(lines.next(), path, "atom count");
+            hasCount = true;
+        }else if(line.starts_with("ITEM: BOX BOUNDS")){
+            result.simulationCell = parseBox(splitFields(line), lines, path);
+            hasBox = true;
+        }else if(line.starts_with("ITEM: ATOMS")){
+            columns = parseAtomColumns(splitFields(line), path, preferUnwrapped);
+            break;
+        }else{
+            // Unknown items such as ITEM: UNITS or ITEM: TIME are skipped.
+            while(!nextItemRead && !lines.atEnd()){
+                line = lines.next();
+                nextItemRead = line.starts_with("ITEM:");
+            }
+        }
+        if(!nextItemRead){
+            if(lines.atEnd()) throw std::runtime_error("Truncated frame header in LAMMPS dump: " + path);
+            line = lines.next();
+        }
+    }
+    if(!hasCount || !hasBox){
+        throw std::runtime_error("LAMMPS dump frame lacks atom count or box bounds: " + path);
+    }
+    return true;
+}
+
+// Atom lines of a frame whose header ended at begin, which must all be present.
+std::vector<AtomChunk> frameAtomChunks(const char* begin, const char* end, std::size_t natoms, const std::string& path){
+    std::vector<AtomChunk> chunks = splitAtomSection(begin, end, natoms);
+    const std::size_t found = chunks.empty() ? 0 : chunks.back().firstAtom + chunks.back().numAtoms;
+    if(found < natoms){
+        throw std::runtime_error("LAMMPS dump ends after " + std::to_string(found) + " of " + std::to_string(natoms) + " atoms: " + path);
+    }
+    return chunks;
+}
+
+void allocateFrameBuffers(AtomicStrainFrame& frame, const AtomColumns& columns){
+    frame.positions = std::make_shared<ParticleProperty>(frame.natoms, DataType::Double, 3, 0, false);
+    if(columns.layout.id >= 0){
+        frame.identifiers = std::make_shared<ParticleProperty>(frame.natoms, DataType::Int, 1, 0, false);
+    }
+}
+
+// Second pass: every chunk knows its first atom, so all chunks are parsed
+// concurrently into their own slice of the preallocated buffers.
+void parseAtomChunks(
+    const std::vector<AtomChunk>& chunks,
+    const AtomColumns& columns,
+    AtomicStrainFrame& frame,
+    std::size_t firstAtom,
+    const std::string& path
+){
+    double* positions = frame.positions->dataDouble();
+    int* identifiers = frame.identifiers ? frame.identifiers->dataInt() : nullptr;
+    tbb::parallel_for(std::size_t(0), chunks.size(), [&](std::size_t i){
+        const AtomChunk& chunk = chunks[i];
+        const std::size_t atom = firstAtom + chunk.firstAtom;
+        parseAtomLines(
+            chunk.begin,
+            chunk.end,
+            chunk.numAtoms,
+            columns,
+            positions + 3 * atom,
+            identifiers ? identifiers + atom : nullptr,
+            path
+        );
+    });
+}
+
+}
+
+AtomicStrainDumpReader::AtomicStrainDumpReader(const std::string& path, bool preferUnwrapped)
+    : _path(path), _file(path, "LAMMPS dump", MappedFile::Access::Sequential), _preferUnwrapped(preferUnwrapped){}
+
+bool AtomicStrainDumpReader::readFrame(AtomicStrainFrame& frame){
+    LineCursor cursor(_file.data(), _file.size(), _offset);
+    AtomicStrainFrame result;
+    AtomColumns columns;
+    if(!parseFrameHeader(cursor, result, columns, _path, _preferUnwrapped)){
+        _offset = _file.size();
+        return false;
+    }
+    allocateFrameBuffers(result, columns);
+
+    const std::vector<AtomChunk> chunks = frameAtomChunks(_file.data() + cursor.offset(), _file.data() + _file.size(), result.natoms, _path);
+    parseAtomChunks(chunks, columns, result, 0, _path);
+    const char* end = chunks.empty() ? _file.data() + cursor.offset() : chunks.back().end;
+
+    if(columns.layout.scaled){
+        unscaleDumpPositions(result.positions->dataDouble(), result.natoms, result.simulationCell);
+    }
+
+    _offset = static_cast<std::size_t>(end - _file.data());
+    frame = std::move(result);
+    return true;
+}
+
+bool AtomicStrainDumpReader::skipFrame(AtomicStrainFrameInfo& info){
+    LineCursor cursor(_file.data(), _file.size(), _offset);
+    AtomicStrainFrame header;
+    AtomColumns columns;
+    if(!parseFrameHeader(cursor, header, columns, _path, _preferUnwrapped)){
+        _offset = _file.size();
+        return false;
+    }
+
+    // Only newlines are counted, the atom lines themselves are never tokenized.
+    const std::vector<AtomChunk> chunks = frameAtomChunks(_file.data() + cursor.offset(), _file.data() + _file.size(), header.natoms, _path);
+    const char* end = chunks.empty() ? _file.data() + cursor.offset() : chunks.back().end;
+
+    info.timestep = header.timestep;
+    info.offset = _offset;
+    info.natoms = header.natoms;
+    info.simulationCell = header.simulationCell;
+    _offset = static_cast<std::size_t>(end - _file.data());
+    return true;
+}
+
+void AtomicStrainDumpReader::seek(std::uint64_t offset){
+    if(offset > _file.size()) throw std::out_of_range("Frame offset beyond the end of LAMMPS dump: " + _path);
+    _offset = static_cast<std::size_t>(offset);
+}
+
+struct AtomicStrainDumpStreamReader::Lines{
+    AtomicStrainDumpStreamReader& reader;
+
+    bool atEnd(){
+        return reader._begin == reader._end && !reader.fill();
+    }
+
+    // The view stays valid until the next call that reads from the source.
+    std::string_view next(){
+        for(;;){
+            const char* begin = reader._buffer.data() + reader._begin;
+            const std::size_t available = reader._end - reader._begin;
+            const void* newline = std::memchr(begin, '\n', available);
+            if(newline){
+                const std::size_t length = static_cast<const char*>(newline) - begin;
+                reader._begin += length + 1;
+                return trim(std::string_view(begin, length));
+            }
+            if(!reader.fill()){
+                reader._begin = reader._end;
+                return trim(std::string_view(begin, available));
+            }
+        }
+    }
+};
+
+AtomicStrainDumpStreamReader::AtomicStrainDumpStreamReader(std::unique_ptr<ByteSource> source, std::string name, bool preferUnwrapped)
+    : _source(std::move(source)), _name(std::move(name)), _preferUnwrapped(preferUnwrapped){}
+
+bool AtomicStrainDumpStreamReader::fill(){
+    if(_eof) return false;
+    if(_begin > 0 && (_begin == _end || _begin >= _buffer.size() / 2)){
+        std::memmove(_buffer.data(), _buffer.data() + _begin, _end - _begin);
+        _bufferOffset += _begin;
+        _end -= _begin;
+        _begin = 0;
+    }
+    if(_buffer.size() - _end < StreamReadSize){
+        _buffer.resize(std::max(2 * _buffer.size(), _end + StreamReadSize));
+    }
+    const std::size_t read = _source->read(_buffer.data() + _end, StreamReadSize);
+    if(read == 0){
+        _eof = true;
+        return false;
+    }
+    _end += read;
+    return true;
+}
+
+void AtomicStrainDumpStreamReader::fillAtomLines(std::size_t lines){
+    // Newlines are counted as bytes arrive so that filling stops at the end of the
+    // frame; a live pipe may not deliver anything beyond it for a long time.
+    std::size_t scanned = 0;
+    std::size_t found = 0;
+    for(;;){
+        const char* p = _buffer.data() + _begin + scanned;
+        const char* end = _buffer.data() + _end;
+        while(found < lines){
+            const void* newline = std::memchr(p, '\n', end - p);
+            if(!newline) break;
+            p = static_cast<const char*>(newline) + 1;
+            ++found;
+        }
+        scanned = static_cast<std::size_t>(p - (_buffer.data() + _begin));
+        if(found >= lines || _end - _begin >= StreamRegionSize || !fill()) return;
+    }
+}
+
+bool AtomicStrainDumpStreamReader::readFrame(AtomicStrainFrame& frame){
+    Lines lines{ *this };
+    AtomicStrainFrame result;
+    AtomColumns columns;
+    if(!parseFrameHeader(lines, result, columns, _name, _preferUnwrapped)) return false;
+    allocateFrameBuffers(result, columns);
+
+    // Atom lines are buffered into large regions, each cut at its last complete line
+    // and parsed in parallel while the source keeps producing the next region.
+    std::size_t parsed = 0;
+    while(parsed < result.natoms){
+        fillAtomLines(result.natoms - parsed);
+        const char* begin = _buffer.data() + _begin;
+        const char* regionEnd = _buffer.data() + _end;
+        if(!_eof){
+            while(regionEnd > begin && regionEnd[-1] != '\n') --regionEnd;
+            if(regionEnd == begin){
+                // A single line longer than the region; read on until it is complete.
+                fill();
+                continue;
+            }
+        }
+
+        const std::vector<AtomChunk> chunks = splitAtomSection(begin, regionEnd, result.natoms - parsed);
+        const std::size_t count = chunks.empty() ? 0 : chunks.back().firstAtom + chunks.back().numAtoms;
+        if(count == 0){
+            throw std::runtime_error("LAMMPS dump ends after " + std::to_string(parsed) + " of " + std::to_string(result.natoms) + " atoms: " + _name);
+        }
+        parseAtomChunks(chunks, columns, result, parsed, _name);
+        parsed += count;
+        _begin = static_cast<std::size_t>(chunks.back().end - _buffer.data());
+    }
+
+    if(columns.layout.scaled){
+        unscaleDumpPositions(result.positions->dataDouble(), result.natoms, result.simulationCell);
+    }
+    frame = std::move(result);
+    return true;
+}
+
+bool AtomicStrainDumpStreamReader::skipFrame(AtomicStrainFrameInfo& info){
+    Lines lines{ *this };
+    const std::uint64_t offset = _bufferOffset + _begin;
+    AtomicStrainFrame header;
+    AtomColumns columns;
+    if(!parseFrameHeader(lines, header, columns, _name, _preferUnwrapped)) return false;
+
+    std::size_t remaining = header.natoms;
+    while(remaining > 0){
+        const char* p = _buffer.data() + _begin;
+        const char* end = _buffer.data() + _end;
+        while(remaining > 0){
+            const void* newline = std::memchr(p, '\n', end - p);
+            if(!newline) break;
+            p = static_cast<const char*>(newline) + 1;
+            --remaining;
+        }
+        _begin = static_cast<std::size_t>(p - _buffer.data());
+        if(remaining == 0) break;
+        if(!fill()){
+            // A last line without trailing newline still counts.
+            if(remaining == 1 && _begin < _end){
+                _begin = _end;
+                break;
+            }
+            throw std::runtime_error("LAMMPS dump ends after " + std::to_string(header.natoms - remaining) + " of " + std::to_string(header.natoms) + " atoms: " + _name);
+        }
+    }
+
+    info.timestep = header.timestep;
+    info.offset = offset;
+    info.natoms = header.natoms;
+    info.simulationCell = header.simulationCell;
+    return true;
+}
+
+}
@@ -0,0 +1,283 @@
+#include <volt/atomic_strain_dump_writer.h>
+
+#include <algorithm>
+#include <charconv>
+#include <cmath>
+#include <filesystem>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <tbb/parallel_pipeline.h>
+#include <tbb/task_arena.h>
+#include <spdlog/spdlog.h>
+
+namespace Volt{
+
+using namespace Particles;
+
+namespace{
+
+constexpr std::size_t MaxRoom = 4096;
+
+// Appends numbers to a string using std::to_chars, growing it in large steps.
+class LineFormatter{
+public:
+    explicit LineFormatter(const AtomicStrainEncodingOptions& encoding)
+        : _encoding(encoding){
+        if(encoding.encoding == AtomicStrainEncoding::Quantized){
+            _quantizedDigits = std::max(0, static_cast<int>(std::ceil(-std::log10(encoding.quantizationStep()))));
+        }
+    }
+
+    void reset(std::string& out){
+        _out = &out;
+        _out->clear();
+    }
+
+    void integer(long long value){
+        append(24, value);
+    }
+
+    void position(double value){
+        append(32, value);
+    }
+
+    void value(double value){
+        switch(_encoding.encoding){
+            case AtomicStrainEncoding::Float32:
+                append(48, static_cast<float>(value));
+                break;
+            case AtomicStrainEncoding::Quantized:{
+                // Rounded in floating point, so huge or non-finite values cannot overflow.
+                const double step = _encoding.quantizationStep();
+                append(48, std::round(value / step) * step, std::chars_format::fixed, _quantizedDigits);
+                break;
+            }
+            case AtomicStrainEncoding::Float64:
+                append(48, value);
+                break;
+        }
+    }
+
+    void separator(char c){
+        _out->push_back(c);
+    }
+
+private:
+    // Fixed notation of a large double needs over 300 characters, so the room is
+    // grown on errc::value_too_large; any other error is reported.
+    template<typename... Args>
+    void append(std::size_t room, Args... args){
+        for(;;){
+            char* p = reserve(room);
+            const auto [end, ec] = std::to_chars(p, p + room, args...);
+            if(ec == std::errc{}){
+                commit(end);
+                return;
+            }
+            commit(p);
+            if(ec != std::errc::value_too_large || room >= MaxRoom){
+                throw std::runtime_error("Cannot format dump value: " + std::make_error_code(ec).message());
+            }
+            room *= 4;
+        }
+    }
+
+    char* reserve(std::size_t n){
+        _size = _out->size();
+        if(_out->capacity() < _size + n) _out->reserve(std::max(_out->capacity() * 2, _size + n));
+        _out->resize(_size + n);
+        return _out->data() + _size;
+    }
+
+    void commit(char* end){
+        _out->resize(static_cast<std::size_t>(end - _out->data()));
+    }
+
+    const AtomicStrainEncodingOptions& _encoding;
+    int _quantizedDigits = 0;
+    std::string* _out = nullptr;
+    std::size_t _size = 0;
+};
+
+std::string columnHeader(const AtomicStrainResult& result, AtomicStrainField fields){
+    std::string header = "ITEM: ATOMS id x y z";
+    if(hasField(fields, AtomicStrainField::ShearStrain) && result.shearStrains) header += " shear_strain";
+    if(hasField(fields, AtomicStrainField::VolumetricStrain) && result.volumetricStrains) header += " volumetric_strain";
+    if(hasField(fields, AtomicStrainField::StrainTensor) && result.strainTensors){
+        header += " strain_xx strain_yy strain_zz strain_xy strain_xz strain_yz";
+    }
+    if(hasField(fields, AtomicStrainField::DeformationGradient) && result.deformationGradients){
+        header += " F_xx F_yx F_zx F_xy F_yy F_zy F_xz F_yz F_zz";
+    }
+    if(hasField(fields, AtomicStrainField::D2min) && result.nonaffineSquaredDisplacements) header += " D2min";
+    if(hasField(fields, AtomicStrainField::Invalid) && result.invalidParticles) header += " invalid";
+    header += '\n';
+    return header;
+}
+
+std::string frameHeader(const AtomicStrainResult& result, AtomicStrainField fields){
+    const AffineTransformation& m = result.cell.matrix();
+    const double xy = m(0, 1), xz = m(0, 2), yz = m(1, 2);
+    const bool triclinic = xy != 0.0 || xz != 0.0 || yz != 0.0;
+
+    const double xlo = m(0, 3), ylo = m(1, 3), zlo = m(2, 3);
+    const double xhi = xlo + m(0, 0), yhi = ylo + m(1, 1), zhi = zlo + m(2, 2);
+    const double xloBound = xlo + std::min({ 0.0, xy, xz, xy + xz });
+    const double xhiBound = xhi + std::max({ 0.0, xy, xz, xy + xz });
+    const double yloBound = ylo + std::min(0.0, yz);
+    const double yhiBound = yhi + std::max(0.0, yz);
+
+    std::string pbc;
+    for(std::size_t k = 0; k < 3; ++k){
+        pbc += result.cell.pbcFlags()[k] ? " pp" : " ff";
+    }
+
+    std::string header;
+    header += "ITEM: TIMESTEP\n" + std::to_string(result.timestep) + '\n';
+    header += "ITEM: NUMBER OF ATOMS\n" + std::to_string(result.numRows()) + '\n';
+
+    AtomicStrainEncodingOptions exact;
+    LineFormatter f(exact);
+    std::string bounds;
+    f.reset(bounds);
+    const auto boundLine = [&](double lo, double hi, double tilt){
+        f.position(lo); f.separator(' '); f.position(hi);
+        if(triclinic){ f.separator(' '); f.position(tilt); }
+        f.separator('\n');
+    };
+    boundLine(xloBound, xhiBound, xy);
+    boundLine(yloBound, yhiBound, xz);
+    boundLine(zlo, zhi, yz);
+
+    header += triclinic ? "ITEM: BOX BOUNDS xy xz yz" : "ITEM: BOX BOUNDS";
+    header += pbc + '\n' + bounds;
+    header += columnHeader(result, fields);
+    return header;
+}
+
+void formatRows(
+    const AtomicStrainResult& result,
+    AtomicStrainField fields,
+    LineFormatter& f,
+    std::size_t rowBegin,
+    std::size_t rowEnd,
+    std::string& out
+){
+    const bool writeShear = hasField(fields, AtomicStrainField::ShearStrain) && result.shearStrains;
+    const bool writeVolumetric = hasField(fields, AtomicStrainField::VolumetricStrain) && result.volumetricStrains;
+    const bool writeStrain = hasField(fields, AtomicStrainField::StrainTensor) && result.strainTensors;
+    const bool writeDefgrad = hasField(fields, AtomicStrainField::DeformationGradient) && result.deformationGradients;
+    const bool writeD2min = hasField(fields, AtomicStrainField::D2min) && result.nonaffineSquaredDisplacements;
+    const bool writeInvalid = hasField(fields, AtomicStrainField::Invalid) && result.invalidParticles;
+
+    f.reset(out);
+    out.reserve((rowEnd - rowBegin) * 96);
+    for(std::size_t row = rowBegin; row < rowEnd; ++row){
+        const std::size_t i = result.atomIndex(row);
+        const Point3 p = result.positions->getPoint3(i);
+
+        f.integer(result.identifier(i));
+        f.separator(' '); f.position(p.x());
+        f.separator(' '); f.position(p.y());
+        f.separator(' '); f.position(p.z());
+        if(writeShear){ f.separator(' '); f.value(result.shearStrains->getDouble(i)); }
+        if(writeVolumetric){ f.separator(' '); f.value(result.volumetricStrains->getDouble(i)); }
+        if(writeStrain){
+            for(std::uint32_t c : StrainTensorOutputOrder){ f.separator(' '); f.value(result.strainTensors->getDoubleComponent(i, c)); }
+        }
+        if(writeDefgrad){
+            for(std::size_t c = 0; c < 9; ++c){ f.separator(' '); f.value(result.deformationGradients->getDoubleComponent(i, c)); }
+        }
+        if(writeD2min){ f.separator(' '); f.value(result.nonaffineSquaredDisplacements->getDouble(i)); }
+        if(writeInvalid){ f.separator(' '); f.integer(result.invalidParticles->getInt(i)); }
+        f.separator('\n');
+    }
+}
+
+}
+
+std::size_t dumpWriterChunksInFlight(){
+    return 2 * static_cast<std::size_t>(std::max(1, tbb::this_task_arena::max_concurrency()));
+}
+
+bool writeLammpsDumpResult(
+    const AtomicStrainResult& result,
+    AtomicStrainField fields,
+    const AtomicStrainEncodingOptions& encoding,
+    const std::string& path,
+    FileWriteMode mode,
+    bool serial
+){
+    if(!result.positions) return false;
+
+    const std::string header = frameHeader(result, fields);
+    // "ITEM: ATOMS" plus one space per column; about 20 characters per column is
+    // enough to size the buffers.
+    const std::size_t columns = static_cast<std::size_t>(std::ranges::count(columnHeader(result, fields), ' ')) - 1;
+    BufferedFileWriter writer(DumpWriterBufferSize, mode);
+    if(!writer.open(path, header.size() + result.numRows() * columns * 20)) return false;
+
+    writer.write(header.data(), header.size());
+
+    // Chunks are formatted concurrently unless serial and handed to the writer in row order.
+    const std::size_t numRows = result.numRows();
+    std::size_t nextRow = 0;
+
+    struct Chunk{
+        std::size_t begin;
+        std::size_t end;
+        std::string text;
+    };
+
+    using ChunkPtr = std::unique_ptr<Chunk>;
+
+    try{
+        if(serial){
+            LineFormatter formatter(encoding);
+            std::string text;
+            for(std::size_t begin = 0; begin < numRows; begin += DumpWriterChunkRows){
+                formatRows(result, fields, formatter, begin, std::min(numRows, begin + DumpWriterChunkRows), text);
+                writer.write(text.data(), text.size());
+            }
+        }else{
+            tbb::parallel_pipeline(dumpWriterChunksInFlight(),
+                tbb::make_filter<void, ChunkPtr>(tbb::filter_mode::serial_in_order,
+                    [&](tbb::flow_control& fc) -> ChunkPtr{
+                        if(nextRow >= numRows){
+                            fc.stop();
+                            return nullptr;
+                        }
+                        auto chunk = std::make_unique<Chunk>(Chunk{ nextRow, std::min(numRows, nextRow + DumpWriterChunkRows), {} });
+                        nextRow = chunk->end;
+                        return chunk;
+                    }) &
+                tbb::make_filter<ChunkPtr, ChunkPtr>(tbb::filter_mode::parallel,
+                    [&](ChunkPtr chunk) -> ChunkPtr{
+                        LineFormatter formatter(encoding);
+                        formatRows(result, fields, formatter, chunk->begin, chunk->end, chunk->text);
+                        return chunk;
+                    }) &
+                tbb::make_filter<ChunkPtr, void>(tbb::filter_mode::serial_in_order,
+                    [&](ChunkPtr chunk){
+                        writer.write(chunk->text.data(), chunk->text.size());
+                    })
+            );
+        }
+    }catch(const std::exception& e){
+        writer.close();
+        std::error_code ec;
+        std::filesystem::remove(path, ec);
+        spdlog::warn("Failed to write atomic strain dump {}: {}", path, e.what());
+        return false;
+    }
+
+    if(!writer.close()){
+        spdlog::warn("Failed to write atomic strain dump: {}", path);
+        return false;
+    }
+    return true;
+}
+
+}
@@ -1,17 +1,78 @@
 #include <volt/atomic_strain_engine.h>
+#include <volt/atomic_strain_prepared_reference.h>
 #include <volt/analysis/cutoff_neighbor_finder.h>
 
+#include <algorithm>
 #include <cmath>
 #include <numeric>
-#include <map>
+#include <span>
 #include <cassert>
 #include <tbb/parallel_for.h>
 #include <tbb/blocked_range.h>
+#include <tbb/combinable.h>
+#include <tbb/parallel_sort.h>
 
 namespace Volt{
 
 using namespace Particles;
 
+namespace{
+
+std::vector<std::size_t> sortedByIdentifier(const int* ids, std::size_t n, bool serial){
+    std::vector<std::size_t> order(n);
+    std::iota(order.begin(), order.end(), std::size_t{0});
+    const auto byIdentifier = [ids](std::size_t a, std::size_t b){
+        return ids[a] < ids[b];
+    };
+    if(serial){
+        std::sort(order.begin(), order.end(), byIdentifier);
+    }else{
+        tbb::parallel_sort(order.begin(), order.end(), byIdentifier);
+    }
+    return order;
+}
+
+// Neighbors from a cutoff query on the reference configuration.
+struct FinderNeighbors{
+    CutoffNeighborFinder& finder;
+
+    template<typename Visit>
+    void forEach(std::size_t refIndex, Visit&& visit) const{
+        for(CutoffNeighborFinder::Query query(finder, refIndex); !query.atEnd(); query.next()){
+            visit(query.current(), query.delta());
+        }
+    }
+
+    bool inverseV(std::size_t, Matrix_3<double>&) const{
+        return false;
+    }
+
+    static constexpr bool HasInverseV = false;
+};
+
+// Neighbors and V^-1 read from a prepared reference.
+struct PreparedNeighbors{
+    const AtomicStrainPreparedReference& prepared;
+
+    template<typename Visit>
+    void forEach(std::size_t refIndex, Visit&& visit) const{
+        const std::span<const std::int32_t> neighbors = prepared.neighbors(refIndex);
+        for(std::size_t k = 0; k < neighbors.size(); ++k){
+            visit(static_cast<std::size_t>(neighbors[k]), prepared.delta(refIndex, k));
+        }
+    }
+
+    bool inverseV(std::size_t refIndex, Matrix_3<double>& inverse) const{
+        if(!prepared.invertible(refIndex)) return false;
+        inverse = prepared.inverseV(refIndex);
+        return true;
+    }
+
+    static constexpr bool HasInverseV = true;
+};
+
+}
+
 AtomicStrainModifier::AtomicStrainEngine::AtomicStrainEngine(
     ParticleProperty* positions,
     const SimulationCell& cell,
@@ -43,60 +104,113 @@ AtomicStrainModifier::AtomicStrainEngine::AtomicStrainEngine(
     _numInvalidParticles.store(0, std::memory_order_relaxed);
 }
 
+void AtomicStrainModifier::AtomicStrainEngine::setOutputProperties(
+    bool shearStrains,
+    bool volumetricStrains,
+    bool invalidParticles
+){
+    _outputShearStrains = shearStrains;
+    _outputVolumetricStrains = volumetricStrains;
+    _outputInvalidParticles = invalidParticles;
+}
+
+void AtomicStrainModifier::AtomicStrainEngine::setPreparedReference(std::shared_ptr<const AtomicStrainPreparedReference> prepared){
+    _preparedReference = std::move(prepared);
+}
+
 void AtomicStrainModifier::AtomicStrainEngine::perform(){
     std::vector<int> currentToRefIndexMap(positions()->size());
     std::vector<int> refToCurrentIndexMap(refPositions()->size());
 
+    const AtomicStrainPreparedReference* prepared = _preparedReference.get();
+    if(prepared && (prepared->numAtoms() != refPositions()->size() || prepared->cutoff() != _cutoff)){
+        prepared = nullptr;
+    }
+
     if(_identifiers && _refIdentifiers){
         assert(_identifiers->size()    == positions()->size());
         assert(_refIdentifiers->size() == refPositions()->size());
 
-        std::map<int,int> refMap;
-        int index = 0;
-        for(int id : _refIdentifiers->constIntRange()){
-            if(!refMap.insert(std::make_pair(id,index)).second)
+        // Both configurations are ordered by identifier and matched with a merge join.
+        // The sorted current order doubles as the permutation for ID-sorted output.
+        const int* currentIds = _identifiers->constDataInt();
+        const int* refIds = _refIdentifiers->constDataInt();
+        std::vector<std::size_t> currentOrder = sortedByIdentifier(currentIds, currentToRefIndexMap.size(), _serial);
+
+        const auto hasDuplicates = [](const int* ids, std::span<const std::size_t> order){
+            return std::adjacent_find(order.begin(), order.end(), [ids](std::size_t a, std::size_t b){
+                return ids[a] == ids[b];
+            }) != order.end();
+        };
+
+        // A prepared order was already checked for duplicates when it was built.
+        std::vector<std::size_t> sortedRefOrder;
+        std::span<const std::size_t> refOrder;
+        if(prepared && !prepared->identifierOrder().empty()){
+            refOrder = prepared->identifierOrder();
+        }else{
+            sortedRefOrder = sortedByIdentifier(refIds, refToCurrentIndexMap.size(), _serial);
+            refOrder = sortedRefOrder;
+            if(hasDuplicates(refIds, refOrder))
                 throw std::runtime_error("Particles with duplicate identifiers detected in reference configuration.");
-            ++index;
         }
-
-        std::map<int,int> currentMap;
-        index = 0;
-        for(int id : _identifiers->constIntRange()){
-            if(!currentMap.insert(std::make_pair(id,index)).second)
-                throw std::runtime_error("Particles with duplicate identifiers detected in current configuration.");
-            ++index;
-        }
-
-        const int* id = _identifiers->constDataInt();
-        for(auto& mappedIndex : currentToRefIndexMap){
-            auto it = refMap.find(*id);
-            mappedIndex = (it != refMap.end()) ? it->second : -1;
-            ++id;
+        if(hasDuplicates(currentIds, currentOrder))
+            throw std::runtime_error("Particles with duplicate identifiers detected in current configuration.");
+
+        std::fill(currentToRefIndexMap.begin(), currentToRefIndexMap.end(), -1);
+        std::fill(refToCurrentIndexMap.begin(), refToCurrentIndexMap.end(), -1);
+        std::size_t matched = 0;
+        auto current = currentOrder.begin();
+        auto ref = refOrder.begin();
+        while(current != currentOrder.end() && ref != refOrder.end()){
+            if(currentIds[*current] < refIds[*ref]){
+                ++current;
+            }else if(refIds[*ref] < currentIds[*current]){
+                ++ref;
+            }else{
+                currentToRefIndexMap[*current] = static_cast<int>(*ref);
+                refToCurrentIndexMap[*ref] = static_cast<int>(*current);
+                ++matched;
+                ++current;
+                ++ref;
+            }
         }
+        _allReferenceMatched = matched == refToCurrentIndexMap.size();
 
-        id = _refIdentifiers->constDataInt();
-        for(auto& mappedIndex : refToCurrentIndexMap){
-            auto it = currentMap.find(*id);
-            mappedIndex = (it != currentMap.end()) ? it->second : -1;
-            ++id;
-        }
+        _identifierOrder = std::make_shared<const std::vector<std::size_t>>(std::move(currentOrder));
     }else{
         if(positions()->size() != refPositions()->size())
             throw std::runtime_error("Cannot calculate displacements. Numbers of particles in reference configuration and current configuration do not match.");
         std::iota(refToCurrentIndexMap.begin(),   refToCurrentIndexMap.end(),   0);
         std::iota(currentToRefIndexMap.begin(),   currentToRefIndexMap.end(),   0);
+        _identifierOrder.reset();
+        _allReferenceMatched = true;
     }
 
     _simCellRef.setPbcFlags(_simCell.pbcFlags());
 
     CutoffNeighborFinder neighborFinder;
-    if(!neighborFinder.prepare(_cutoff, refPositions(), refCell())) return;
+    if(!prepared && !neighborFinder.prepare(_cutoff, refPositions(), refCell())) return;
 
     const std::size_t n = positions()->size();
 
-    _shearStrains = std::make_shared<ParticleProperty>(n, DataType::Double, 1, 0, true);
-    _volumetricStrains = std::make_shared<ParticleProperty>(n, DataType::Double, 1, 0, true);
-    _invalidParticles = std::make_shared<ParticleProperty>(n, DataType::Int, 1, 0, true);
+    if(_outputShearStrains){
+        _shearStrains = std::make_shared<ParticleProperty>(n, DataType::Double, 1, 0, true);
+    }else{
+        _shearStrains.reset();
+    }
+
+    if(_outputVolumetricStrains){
+        _volumetricStrains = std::make_shared<ParticleProperty>(n, DataType::Double, 1, 0, true);
+    }else{
+        _volumetricStrains.reset();
+    }
+
+    if(_outputInvalidParticles){
+        _invalidParticles = std::make_shared<ParticleProperty>(n, DataType::Int, 1, 0, true);
+    }else{
+        _invalidParticles.reset();
+    }
 
     if(_calculateStrainTensors){
         _strainTensors = std::make_shared<ParticleProperty>(n, DataType::Double, 6, 0, true);
@@ -116,38 +230,81 @@ void AtomicStrainModifier::AtomicStrainEngine::perform(){
         _nonaffineSquaredDisplacements.reset();
     }
 
-    tbb::parallel_for(tbb::blocked_range<std::size_t>(0, n),
-        [this, &neighborFinder, &refToCurrentIndexMap, &currentToRefIndexMap](const tbb::blocked_range<std::size_t>& r){
-            for(std::size_t i = r.begin(); i < r.end(); ++i){
+    struct Summary{
+        double totalShear = 0.0;
+        double totalVolumetric = 0.0;
+        double maxShear = 0.0;
+    };
+    tbb::combinable<Summary> summaries;
+
+    const auto computeAll = [this, n, &refToCurrentIndexMap, &currentToRefIndexMap, &summaries](const auto& neighbors){
+        const auto computeRange = [this, &neighbors, &refToCurrentIndexMap, &currentToRefIndexMap, &summaries](std::size_t begin, std::size_t end){
+            Summary& summary = summaries.local();
+            for(std::size_t i = begin; i < end; ++i){
+                double shearStrain = 0.0;
+                double volumetricStrain = 0.0;
                 if(!computeStrain(i,
-                                  neighborFinder,
+                                  neighbors,
                                   refToCurrentIndexMap,
-                                  currentToRefIndexMap)){
+                                  currentToRefIndexMap,
+                                  shearStrain,
+                                  volumetricStrain)){
                     _numInvalidParticles.fetch_add(1, std::memory_order_relaxed);
                 }
+                summary.totalShear += shearStrain;
+                summary.totalVolumetric += volumetricStrain;
+                if(shearStrain > summary.maxShear) summary.maxShear = shearStrain;
             }
-        });
+        };
+        if(_serial){
+            computeRange(0, n);
+        }else{
+            tbb::parallel_for(tbb::blocked_range<std::size_t>(0, n), [&computeRange](const tbb::blocked_range<std::size_t>& r){
+                computeRange(r.begin(), r.end());
+            });
+        }
+    };
+    if(prepared){
+        computeAll(PreparedNeighbors{ *prepared });
+    }else{
+        computeAll(FinderNeighbors{ neighborFinder });
+    }
+
+    Summary total = summaries.combine([](const Summary& a, const Summary& b){
+        return Summary{
+            a.totalShear + b.totalShear,
+            a.totalVolumetric + b.totalVolumetric,
+            std::max(a.maxShear, b.maxShear)
+        };
+    });
+    _totalShearStrain = total.totalShear;
+    _totalVolumetricStrain = total.totalVolumetric;
+    _maxShearStrain = total.maxShear;
+    _currentToReferenceIndices = std::make_shared<const std::vector<int>>(std::move(currentToRefIndexMap));
 }
 
+template<typename Neighbors>
 bool AtomicStrainModifier::AtomicStrainEngine::computeStrain(
     std::size_t                 particleIndex,
-    CutoffNeighborFinder&       neighborFinder,
+    const Neighbors&            neighbors,
     const std::vector<int>&     refToCurrentIndexMap,
-    const std::vector<int>&     currentToRefIndexMap){
+    const std::vector<int>&     currentToRefIndexMap,
+    double&                     shearStrain,
+    double&                     volumetricStrain){
     Matrix_3<double> V = Matrix_3<double>::Zero();
     Matrix_3<double> W = Matrix_3<double>::Zero();
     int numNeighbors = 0;
 
     int particleIndexReference = currentToRefIndexMap[particleIndex];
+    // With all neighbors matched, V is the prepared one and need not be accumulated.
+    const bool storedV = Neighbors::HasInverseV && _allReferenceMatched;
 
     if(particleIndexReference != -1){
         const Point3 x = positions()->getPoint3(particleIndex);
 
-        for(CutoffNeighborFinder::Query neighQuery(neighborFinder, particleIndexReference);
-            !neighQuery.atEnd(); neighQuery.next()){
-            const Vector3& r0 = neighQuery.delta();
-            int neighborIndexCurrent = refToCurrentIndexMap[neighQuery.current()];
-            if(neighborIndexCurrent == -1) continue;
+        neighbors.forEach(particleIndexReference, [&](std::size_t neighborIndexReference, const Vector3& r0){
+            int neighborIndexCurrent = refToCurrentIndexMap[neighborIndexReference];
+            if(neighborIndexCurrent == -1) return;
 
             Vector3 r = positions()->getPoint3(neighborIndexCurrent) - x;
             Vector3 sr = _currentSimCellInv * r; 
@@ -163,18 +320,23 @@ bool AtomicStrainModifier::AtomicStrainEngine::computeStrain(
 
             for(std::size_t i = 0; i < 3; ++i){
                 for(std::size_t j = 0; j < 3; ++j){
-                    V(i,j) += r0[j] * r0[i];
+                    if(!storedV) V(i,j) += r0[j] * r0[i];
                     W(i,j) += r0[j] * r[i];
                 }
             }
 
             ++numNeighbors;
-        }
+        });
     }
 
     Matrix_3<double> inverseV;
-    if(numNeighbors < 3 || !V.inverse(inverseV, 1e-4) || std::abs(W.determinant()) < 1e-4){
-        _invalidParticles->setInt(particleIndex, 1);
+    const auto invertV = [&](){
+        return storedV ? neighbors.inverseV(particleIndexReference, inverseV) : V.inverse(inverseV, 1e-4);
+    };
+    if(numNeighbors < 3 || !invertV() || std::abs(W.determinant()) < 1e-4){
+        if(_invalidParticles){
+            _invalidParticles->setInt(particleIndex, 1);
+        }
 
         if(_deformationGradients){
             for(Matrix_3<double>::size_type col = 0; col < 3; ++col){
@@ -193,8 +355,14 @@ bool AtomicStrainModifier::AtomicStrainEngine::computeStrain(
             _nonaffineSquaredDisplacements->setDouble(particleIndex, 0.0);
         }
 
-        _shearStrains->setDouble(particleIndex, 0.0);
-        _volumetricStrains->setDouble(particleIndex, 0.0);
+        if(_shearStrains){
+            _shearStrains->setDouble(particleIndex, 0.0);
+        }
+        if(_volumetricStrains){
+            _volumetricStrains->setDouble(particleIndex, 0.0);
+        }
+        shearStrain = 0.0;
+        volumetricStrain = 0.0;
         return false;
     }
 
@@ -220,12 +388,9 @@ bool AtomicStrainModifier::AtomicStrainEngine::computeStrain(
         double D2min = 0.0;
         const Point3 x = positions()->getPoint3(particleIndex);
 
-        for(CutoffNeighborFinder::Query neighQuery(neighborFinder, particleIndexReference);
-            !neighQuery.atEnd(); neighQuery.next())
-        {
-            const Vector3& r0 = neighQuery.delta();
-            int neighborIndexCurrent = refToCurrentIndexMap[neighQuery.current()];
-            if(neighborIndexCurrent == -1) continue;
+        neighbors.forEach(particleIndexReference, [&](std::size_t neighborIndexReference, const Vector3& r0){
+            int neighborIndexCurrent = refToCurrentIndexMap[neighborIndexReference];
+            if(neighborIndexCurrent == -1) return;
 
             Vector3 r = positions()->getPoint3(neighborIndexCurrent) - x;
             Vector3 sr = _currentSimCellInv * r;
@@ -241,7 +406,7 @@ bool AtomicStrainModifier::AtomicStrainEngine::computeStrain(
             Vector_3<double> r0Double(r0.x(), r0.y(), r0.z());
             Vector_3<double> dr = rDouble - F * r0Double;
             D2min += dr.squaredLength();
-        }
+        });
 
         _nonaffineSquaredDisplacements->setDouble(particleIndex, D2min);
     }
@@ -249,21 +414,27 @@ bool AtomicStrainModifier::AtomicStrainEngine::computeStrain(
     double xydiff = strain.xx() - strain.yy();
     double xzdiff = strain.xx() - strain.zz();
     double yzdiff = strain.yy() - strain.zz();
-    double shearStrain = std::sqrt(
+    shearStrain = std::sqrt(
         strain.xy()*strain.xy() +
         strain.xz()*strain.xz() +
         strain.yz()*strain.yz() +
         (xydiff*xydiff + xzdiff*xzdiff + yzdiff*yzdiff) / 6.0
     );
     assert(std::isfinite(shearStrain));
-    _shearStrains->setDouble(particleIndex, shearStrain);
+    if(_shearStrains){
+        _shearStrains->setDouble(particleIndex, shearStrain);
+    }
 
-    double volumetricStrain =
+    volumetricStrain =
         (strain(0,0) + strain(1,1) + strain(2,2)) / 3.0;
     assert(std::isfinite(volumetricStrain));
-    _volumetricStrains->setDouble(particleIndex, volumetricStrain);
+    if(_volumetricStrains){
+        _volumetricStrains->setDouble(particleIndex, volumetricStrain);
+    }
 
-    _invalidParticles->setInt(particleIndex, 0);
+    if(_invalidParticles){
+        _invalidParticles->setInt(particleIndex, 0);
+    }
     return true;
 }
 
@@ -0,0 +1,355 @@
+#include <volt/atomic_strain_file_writer.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <fcntl.h>
+#include <unistd.h>
+#include <spdlog/spdlog.h>
+
+namespace Volt{
+
+namespace{
+
+constexpr std::size_t DirectAlignment = 4096;
+constexpr std::size_t DirectBlocksInFlight = 4;
+constexpr std::size_t MinBlockSize = 256u << 10;
+
+std::size_t alignUp(std::size_t value, std::size_t alignment){
+    return (value + alignment - 1) / alignment * alignment;
+}
+
+}
+
+struct BufferedFileWriter::DirectBlock{
+    explicit DirectBlock(std::size_t capacity)
+        : data(static_cast<char*>(std::aligned_alloc(DirectAlignment, capacity)))
+        , capacity(capacity){
+        if(!data) throw std::bad_alloc();
+    }
+
+    ~DirectBlock(){
+        std::free(data);
+    }
+
+    char* data;
+    std::size_t capacity;
+    int fd = -1;
+    std::size_t size = 0;
+    std::uint64_t offset = 0;
+    // Guarded by _ioMutex while the block is queued or being written.
+    bool pending = false;
+    bool ok = true;
+};
+
+BufferedFileWriter::BufferedFileWriter(std::size_t bufferSize, FileWriteMode mode)
+    : _requestedMode(mode)
+    , _mode(mode)
+    , _bufferSize(std::max<std::size_t>(bufferSize, 4096)){}
+
+BufferedFileWriter::~BufferedFileWriter(){
+    close();
+}
+
+bool BufferedFileWriter::open(const std::string& path, std::uint64_t sizeHint){
+    close();
+    _offset = 0;
+    _buffered = 0;
+    _failed = false;
+    _mode = _requestedMode;
+
+    // Small outputs get buffers sized for the whole file instead of the default.
+    const std::size_t bufferSize = sizeHint > 0
+        ? static_cast<std::size_t>(std::min<std::uint64_t>(_bufferSize, std::max<std::uint64_t>(sizeHint, 4096)))
+        : _bufferSize;
+
+    if(_mode == FileWriteMode::Direct){
+        const std::size_t perBlock = sizeHint > 0
+            ? static_cast<std::size_t>(std::min<std::uint64_t>(_bufferSize, sizeHint / DirectBlocksInFlight + 1))
+            : _bufferSize;
+        _blockSize = alignUp(std::max(perBlock, MinBlockSize), DirectAlignment);
+        if(openDirect(path)) return true;
+        if(_failed) return false;
+        _mode = FileWriteMode::Buffered;
+    }
+
+    _buffer.resize(bufferSize);
+    _fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    _failed = _fd < 0;
+    if(_failed){
+        spdlog::warn("Could not open {} for writing: {}", path, std::strerror(errno));
+    }
+    return !_failed;
+}
+
+bool BufferedFileWriter::openDirect(const std::string& path){
+    // Read access is needed to patch already written aligned blocks in writeAt().
+    _fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC | O_DIRECT, 0644);
+    if(_fd < 0){
+        if(errno == EINVAL){
+            spdlog::warn("O_DIRECT is not supported for {}, using buffered writes", path);
+            _failed = false;
+        }else{
+            spdlog::warn("Could not open {} for writing: {}", path, std::strerror(errno));
+            _failed = true;
+        }
+        return false;
+    }
+
+    _blockOffset = 0;
+    _currentBlock = 0;
+    if(!_blocks.empty() && _blocks.front()->capacity != _blockSize){
+        _blocks.clear();
+    }
+    if(_blocks.empty()){
+        _blocks.push_back(std::make_unique<DirectBlock>(_blockSize));
+    }
+    _buffer.clear();
+    _buffer.shrink_to_fit();
+    startIoThreads();
+    return true;
+}
+
+void BufferedFileWriter::startIoThreads(){
+    _stopIo = false;
+    // One block is filled by the caller while the others are written.
+    for(std::size_t i = 0; i + 1 < DirectBlocksInFlight; ++i){
+        _ioThreads.emplace_back([this]{ runIoThread(); });
+    }
+}
+
+void BufferedFileWriter::stopIoThreads(){
+    {
+        std::lock_guard<std::mutex> lock(_ioMutex);
+        _stopIo = true;
+    }
+    _ioAvailable.notify_all();
+    for(std::thread& thread : _ioThreads){
+        thread.join();
+    }
+    _ioThreads.clear();
+}
+
+void BufferedFileWriter::runIoThread(){
+    for(;;){
+        DirectBlock* block = nullptr;
+        {
+            std::unique_lock<std::mutex> lock(_ioMutex);
+            _ioAvailable.wait(lock, [this]{ return _stopIo || !_submitted.empty(); });
+            if(_submitted.empty()) return;
+            block = _submitted.front();
+            _submitted.pop_front();
+        }
+
+        const bool ok = pwriteFully(block->fd, block->data, block->size, block->offset);
+
+        {
+            std::lock_guard<std::mutex> lock(_ioMutex);
+            block->ok = ok;
+            block->pending = false;
+        }
+        _ioDone.notify_all();
+    }
+}
+
+bool BufferedFileWriter::writeFully(const void* data, std::size_t size){
+    const char* bytes = static_cast<const char*>(data);
+    while(size > 0){
+        const ssize_t written = ::write(_fd, bytes, size);
+        if(written < 0){
+            if(errno == EINTR) continue;
+            _failed = true;
+            return false;
+        }
+        bytes += written;
+        size -= static_cast<std::size_t>(written);
+    }
+    return true;
+}
+
+bool BufferedFileWriter::pwriteFully(int fd, const void* data, std::size_t size, std::uint64_t offset){
+    const char* bytes = static_cast<const char*>(data);
+    while(size > 0){
+        const ssize_t written = ::pwrite(fd, bytes, size, static_cast<off_t>(offset));
+        if(written < 0){
+            if(errno == EINTR) continue;
+            return false;
+        }
+        bytes += written;
+        offset += static_cast<std::uint64_t>(written);
+        size -= static_cast<std::size_t>(written);
+    }
+    return true;
+}
+
+bool BufferedFileWriter::preadFully(int fd, void* data, std::size_t size, std::uint64_t offset){
+    char* bytes = static_cast<char*>(data);
+    while(size > 0){
+        const ssize_t count = ::pread(fd, bytes, size, static_cast<off_t>(offset));
+        if(count < 0){
+            if(errno == EINTR) continue;
+            return false;
+        }
+        if(count == 0) return false;
+        bytes += count;
+        offset += static_cast<std::uint64_t>(count);
+        size -= static_cast<std::size_t>(count);
+    }
+    return true;
+}
+
+bool BufferedFileWriter::write(const void* data, std::size_t size){
+    if(!good()) return false;
+    _offset += size;
+
+    if(_mode == FileWriteMode::Direct){
+        const char* bytes = static_cast<const char*>(data);
+        while(size > 0){
+            const std::size_t chunk = std::min(size, _blockSize - _buffered);
+            std::memcpy(_blocks[_currentBlock]->data + _buffered, bytes, chunk);
+            _buffered += chunk;
+            bytes += chunk;
+            size -= chunk;
+            if(_buffered == _blockSize && !submitDirectBlock()) return false;
+        }
+        return true;
+    }
+
+    // Large blocks bypass the staging buffer to avoid an extra copy.
+    if(size >= _buffer.size()){
+        return flush() && writeFully(data, size);
+    }
+
+    if(_buffered + size > _buffer.size() && !flush()) return false;
+    std::memcpy(_buffer.data() + _buffered, data, size);
+    _buffered += size;
+    return true;
+}
+
+bool BufferedFileWriter::submitDirectBlock(){
+    DirectBlock& block = *_blocks[_currentBlock];
+    {
+        std::lock_guard<std::mutex> lock(_ioMutex);
+        block.fd = _fd;
+        block.size = _buffered;
+        block.offset = _blockOffset;
+        block.pending = true;
+        _submitted.push_back(&block);
+    }
+    _ioAvailable.notify_one();
+
+    _blockOffset += _buffered;
+    _buffered = 0;
+
+    // Blocks are allocated on demand, so outputs smaller than a block never use more
+    // than one buffer.
+    _currentBlock = (_currentBlock + 1) % DirectBlocksInFlight;
+    if(_currentBlock == _blocks.size()){
+        _blocks.push_back(std::make_unique<DirectBlock>(_blockSize));
+    }
+
+    // The next block is reused as soon as its previous write has completed.
+    return waitDirectBlock(*_blocks[_currentBlock]);
+}
+
+bool BufferedFileWriter::waitDirectBlock(DirectBlock& block){
+    std::unique_lock<std::mutex> lock(_ioMutex);
+    _ioDone.wait(lock, [&block]{ return !block.pending; });
+    if(!block.ok){
+        _failed = true;
+        block.ok = true;
+    }
+    return !_failed;
+}
+
+bool BufferedFileWriter::drainDirectBlocks(){
+    bool ok = true;
+    for(auto& block : _blocks){
+        ok = waitDirectBlock(*block) && ok;
+    }
+    return ok;
+}
+
+bool BufferedFileWriter::writePadding(std::size_t alignment){
+    static constexpr char zeros[256] = {};
+    std::size_t remaining = (alignment - _offset % alignment) % alignment;
+    while(remaining > 0){
+        const std::size_t chunk = std::min(remaining, sizeof(zeros));
+        if(!write(zeros, chunk)) return false;
+        remaining -= chunk;
+    }
+    return true;
+}
+
+bool BufferedFileWriter::writeAt(std::uint64_t offset, const void* data, std::size_t size){
+    if(!flush()) return false;
+    if(_mode == FileWriteMode::Buffered){
+        if(!pwriteFully(_fd, data, size, offset)) _failed = true;
+        return !_failed;
+    }
+
+    if(offset + size > _offset){
+        _failed = true;
+        return false;
+    }
+
+    // Bytes still staged in the current block are patched in memory, bytes already
+    // on disk through the same O_DIRECT descriptor.
+    const char* bytes = static_cast<const char*>(data);
+    if(offset + size > _blockOffset){
+        const std::uint64_t begin = std::max(offset, _blockOffset);
+        std::memcpy(_blocks[_currentBlock]->data + (begin - _blockOffset), bytes + (begin - offset), offset + size - begin);
+        size = static_cast<std::size_t>(begin - offset);
+    }
+    if(size == 0) return true;
+    if(!patchDirect(offset, bytes, size)) _failed = true;
+    return !_failed;
+}
+
+// Read-modify-write of the aligned range covering [offset, offset + size). Only
+// called after flush(), when no block is in flight, for bytes below _blockOffset.
+bool BufferedFileWriter::patchDirect(std::uint64_t offset, const void* data, std::size_t size){
+    const std::uint64_t begin = offset / DirectAlignment * DirectAlignment;
+    const std::uint64_t end = alignUp(offset + size, DirectAlignment);
+    DirectBlock scratch(static_cast<std::size_t>(end - begin));
+    if(!preadFully(_fd, scratch.data, scratch.capacity, begin)) return false;
+    std::memcpy(scratch.data + (offset - begin), data, size);
+    return pwriteFully(_fd, scratch.data, scratch.capacity, begin);
+}
+
+bool BufferedFileWriter::flush(){
+    if(!good()) return false;
+    if(_mode == FileWriteMode::Direct) return drainDirectBlocks();
+    if(_buffered == 0) return true;
+    const bool ok = writeFully(_buffer.data(), _buffered);
+    _buffered = 0;
+    return ok;
+}
+
+bool BufferedFileWriter::closeDirect(){
+    bool ok = drainDirectBlocks() && !_failed;
+    stopIoThreads();
+    if(ok && _buffered > 0){
+        // The tail is padded to the alignment O_DIRECT requires and truncated afterwards.
+        const std::size_t padded = alignUp(_buffered, DirectAlignment);
+        char* tail = _blocks[_currentBlock]->data;
+        std::memset(tail + _buffered, 0, padded - _buffered);
+        ok = pwriteFully(_fd, tail, padded, _blockOffset);
+    }
+    _buffered = 0;
+    if(ok) ok = ::ftruncate(_fd, static_cast<off_t>(_offset)) == 0;
+    return ok;
+}
+
+bool BufferedFileWriter::close(){
+    if(_fd < 0) return !_failed;
+    const bool flushed = _mode == FileWriteMode::Direct ? closeDirect() : flush();
+    const bool closed = ::close(_fd) == 0;
+    _fd = -1;
+    _failed = _failed || !flushed || !closed;
+    return !_failed;
+}
+
+}
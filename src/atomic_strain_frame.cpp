@@ -0,0 +1,16 @@
+#include <volt/atomic_strain_frame.h>
+#include <volt/core/frame_adapter.h>
+
+namespace Volt{
+
+AtomicStrainFrame AtomicStrainFrame::fromLammpsFrame(const LammpsParser::Frame& frame){
+    AtomicStrainFrame result;
+    result.timestep = frame.timestep;
+    result.natoms = static_cast<std::size_t>(frame.natoms);
+    result.simulationCell = frame.simulationCell;
+    result.positions = FrameAdapter::createPositionPropertyShared(frame);
+    result.identifiers = FrameAdapter::createIdentifierProperty(frame);
+    return result;
+}
+
+}
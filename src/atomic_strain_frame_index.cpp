@@ -0,0 +1,203 @@
+#include <volt/atomic_strain_frame_index.h>
+#include <volt/atomic_strain_byte_source.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <stdexcept>
+#include <spdlog/spdlog.h>
+#include <tbb/parallel_pipeline.h>
+
+namespace Volt{
+
+namespace{
+
+FrameIndex::Entry toEntry(const AtomicStrainFrameInfo& info){
+    return { makeFrameRecord(info.timestep, info.natoms, info.simulationCell), info.offset };
+}
+
+AtomicStrainFrameInfo fromEntry(const FrameIndex::Entry& entry){
+    AtomicStrainFrameInfo info;
+    info.timestep = entry.frame.timestep;
+    info.offset = entry.offset;
+    info.natoms = static_cast<std::size_t>(entry.frame.natoms);
+    info.simulationCell = cellFromArray(entry.frame.cell, entry.frame.pbc);
+    return info;
+}
+
+}
+
+AtomicStrainFrameIndex AtomicStrainFrameIndex::build(const std::string& dumpPath){
+    if(detectCompression(dumpPath) != Compression::None){
+        throw std::runtime_error("Compressed dumps cannot be indexed for random access: " + dumpPath);
+    }
+
+    AtomicStrainFrameIndex index;
+    index._dumpPath = dumpPath;
+    index._dumpStamp = stampDump(dumpPath);
+
+    auto reader = openDumpReader(dumpPath);
+    AtomicStrainFrameInfo info;
+    while(reader->skipFrame(info)){
+        index._frames.push_back(info);
+    }
+    return index;
+}
+
+std::optional<AtomicStrainFrameIndex> AtomicStrainFrameIndex::load(const std::string& dumpPath){
+    const std::string sidecarPath = dumpPath + FrameIndex::Extension;
+    std::ifstream in(sidecarPath, std::ios::binary);
+    if(!in) return std::nullopt;
+
+    FrameIndex::FileHeader header{};
+    in.read(reinterpret_cast<char*>(&header), sizeof(header));
+    if(!in || std::memcmp(header.magic, FrameIndex::Magic, sizeof(header.magic)) != 0 || header.version != FrameIndex::Version){
+        spdlog::warn("Ignoring invalid frame index: {}", sidecarPath);
+        return std::nullopt;
+    }
+
+    const DumpStamp stamp = stampDump(dumpPath);
+    if(DumpStamp{ header.dumpSize, header.dumpModified } != stamp){
+        spdlog::info("Frame index {} is out of date", sidecarPath);
+        return std::nullopt;
+    }
+
+    // The frame count is checked against the file before it sizes any allocation.
+    std::error_code ec;
+    const std::uintmax_t fileSize = std::filesystem::file_size(sidecarPath, ec);
+    if(ec || fileSize < sizeof(header) ||
+        header.numFrames != (fileSize - sizeof(header)) / sizeof(FrameIndex::Entry) ||
+        (fileSize - sizeof(header)) % sizeof(FrameIndex::Entry) != 0){
+        spdlog::warn("Ignoring truncated frame index: {}", sidecarPath);
+        return std::nullopt;
+    }
+
+    std::vector<FrameIndex::Entry> entries(static_cast<std::size_t>(header.numFrames));
+    in.read(reinterpret_cast<char*>(entries.data()), entries.size() * sizeof(FrameIndex::Entry));
+    const bool inside = std::all_of(entries.begin(), entries.end(), [&stamp](const FrameIndex::Entry& entry){
+        return entry.offset < stamp.size;
+    });
+    if(!in || !inside){
+        spdlog::warn("Ignoring invalid frame index: {}", sidecarPath);
+        return std::nullopt;
+    }
+
+    AtomicStrainFrameIndex index;
+    index._dumpPath = dumpPath;
+    index._dumpStamp = stamp;
+    index._frames.reserve(entries.size());
+    for(const auto& entry : entries){
+        index._frames.push_back(fromEntry(entry));
+    }
+    return index;
+}
+
+AtomicStrainFrameIndex AtomicStrainFrameIndex::open(const std::string& dumpPath, bool persist, bool preferUnwrapped){
+    if(auto index = load(dumpPath)){
+        index->_preferUnwrapped = preferUnwrapped;
+        return std::move(*index);
+    }
+
+    AtomicStrainFrameIndex index = build(dumpPath);
+    spdlog::info("Indexed {} frames of {}", index._frames.size(), dumpPath);
+    if(persist) index.save();
+    index._preferUnwrapped = preferUnwrapped;
+    return index;
+}
+
+bool AtomicStrainFrameIndex::save() const{
+    const std::string sidecarPath = _dumpPath + FrameIndex::Extension;
+    // Written under a temporary name and renamed, so concurrent runs never see a partial index.
+    const std::string tempPath = sidecarPath + ".tmp";
+
+    FrameIndex::FileHeader header{};
+    std::memcpy(header.magic, FrameIndex::Magic, sizeof(header.magic));
+    header.version = FrameIndex::Version;
+    header.dumpSize = _dumpStamp.size;
+    header.dumpModified = _dumpStamp.modified;
+    header.numFrames = _frames.size();
+
+    std::vector<FrameIndex::Entry> entries;
+    entries.reserve(_frames.size());
+    for(const auto& info : _frames){
+        entries.push_back(toEntry(info));
+    }
+
+    {
+        std::ofstream out(tempPath, std::ios::binary | std::ios::trunc);
+        out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        out.write(reinterpret_cast<const char*>(entries.data()), entries.size() * sizeof(FrameIndex::Entry));
+        if(!out){
+            spdlog::warn("Failed to write frame index: {}", sidecarPath);
+            std::remove(tempPath.c_str());
+            return false;
+        }
+    }
+    if(std::rename(tempPath.c_str(), sidecarPath.c_str()) != 0){
+        spdlog::warn("Failed to write frame index: {}", sidecarPath);
+        std::remove(tempPath.c_str());
+        return false;
+    }
+    return true;
+}
+
+const AtomicStrainFrameInfo* AtomicStrainFrameIndex::find(long long timestep) const{
+    const auto it = std::find_if(_frames.begin(), _frames.end(), [timestep](const AtomicStrainFrameInfo& info){
+        return info.timestep == timestep;
+    });
+    return it == _frames.end() ? nullptr : &*it;
+}
+
+std::vector<AtomicStrainFrameInfo> AtomicStrainFrameIndex::range(long long first, long long last) const{
+    std::vector<AtomicStrainFrameInfo> frames;
+    for(const auto& info : _frames){
+        if(info.timestep >= first && info.timestep <= last) frames.push_back(info);
+    }
+    return frames;
+}
+
+AtomicStrainFrame AtomicStrainFrameIndex::readFrame(const AtomicStrainFrameInfo& info) const{
+    auto reader = openDumpReader(_dumpPath, _preferUnwrapped);
+    reader->seek(info.offset);
+    AtomicStrainFrame frame;
+    if(!reader->readFrame(frame) || frame.timestep != info.timestep || frame.natoms != info.natoms){
+        throw std::runtime_error("Frame index does not match LAMMPS dump: " + _dumpPath);
+    }
+    return frame;
+}
+
+void AtomicStrainFrameIndex::forEachFrame(
+    const std::vector<AtomicStrainFrameInfo>& frames,
+    std::size_t maxInFlight,
+    const std::function<void(AtomicStrainFrame&)>& consume
+) const{
+    // Every token is the index of a frame; its slot holds the frame from the moment it
+    // has been read until consume() is done with it.
+    std::vector<AtomicStrainFrame> slots(frames.size());
+    std::size_t next = 0;
+
+    tbb::parallel_pipeline(std::max<std::size_t>(1, maxInFlight),
+        tbb::make_filter<void, std::size_t>(tbb::filter_mode::serial_in_order,
+            [&](tbb::flow_control& fc) -> std::size_t{
+                if(next >= frames.size()){
+                    fc.stop();
+                    return 0;
+                }
+                return next++;
+            }) &
+        tbb::make_filter<std::size_t, std::size_t>(tbb::filter_mode::parallel,
+            [&](std::size_t i) -> std::size_t{
+                slots[i] = readFrame(frames[i]);
+                return i;
+            }) &
+        tbb::make_filter<std::size_t, void>(tbb::filter_mode::serial_in_order,
+            [&](std::size_t i){
+                consume(slots[i]);
+                slots[i] = AtomicStrainFrame{};
+            })
+    );
+}
+
+}
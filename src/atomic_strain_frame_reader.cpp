@@ -0,0 +1,46 @@
+#include <volt/atomic_strain_frame_reader.h>
+#include <volt/atomic_strain_dump_reader.h>
+#include <volt/atomic_strain_binary_dump_reader.h>
+#include <volt/atomic_strain_snapshot.h>
+
+#include <cctype>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <string_view>
+
+namespace Volt{
+
+void AtomicStrainFrameReader::seek(std::uint64_t){
+    throw std::runtime_error("This dump input can only be read sequentially");
+}
+
+std::unique_ptr<AtomicStrainFrameReader> openDumpReader(const std::string& path, bool preferUnwrapped){
+    const Compression compression = detectCompression(path);
+    if(compression != Compression::None){
+        return std::make_unique<AtomicStrainDumpStreamReader>(openDecompressingSource(path, compression), path, preferUnwrapped);
+    }
+
+    std::ifstream in(path, std::ios::binary);
+    if(!in) throw std::runtime_error("Cannot open dump: " + path);
+
+    char prefix[64] = {};
+    in.read(prefix, sizeof(prefix));
+    const std::streamsize length = in.gcount();
+    if(length >= static_cast<std::streamsize>(sizeof(Snapshot::Magic)) && std::memcmp(prefix, Snapshot::Magic, sizeof(Snapshot::Magic)) == 0){
+        return std::make_unique<AtomicStrainSnapshotReader>(path);
+    }
+
+    std::streamsize i = 0;
+    while(i < length && std::isspace(static_cast<unsigned char>(prefix[i]))) ++i;
+    const bool text = length - i >= 5 && std::string_view(prefix + i, 5) == "ITEM:";
+
+    if(text) return std::make_unique<AtomicStrainDumpReader>(path, preferUnwrapped);
+    return std::make_unique<AtomicStrainBinaryDumpReader>(path, preferUnwrapped);
+}
+
+std::unique_ptr<AtomicStrainFrameReader> openStreamReader(const std::string& path, bool preferUnwrapped){
+    return std::make_unique<AtomicStrainDumpStreamReader>(openPipeSource(path), path == "-" ? "standard input" : path, preferUnwrapped);
+}
+
+}
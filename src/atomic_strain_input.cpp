@@ -0,0 +1,77 @@
+#include <volt/atomic_strain_input.h>
+#include <volt/atomic_strain_byte_source.h>
+#include <volt/atomic_strain_frame_index.h>
+#include <volt/atomic_strain_snapshot.h>
+#include <volt/cli/common.h>
+
+#include <stdexcept>
+#include <spdlog/spdlog.h>
+
+namespace Volt{
+
+std::string resolveInput(const std::string& path, bool useSnapshot, bool preferUnwrapped){
+    if(!useSnapshot) return path;
+    try{
+        if(auto snapshot = findSnapshot(path, preferUnwrapped)){
+            spdlog::info("Reading snapshot {}", *snapshot);
+            return *snapshot;
+        }
+    }catch(const std::runtime_error&){
+        // A missing dump is reported when it is read.
+    }
+    return path;
+}
+
+bool loadFrame(const std::string& path, bool useMmap, bool preferUnwrapped, AtomicStrainFrame& frame){
+    // LammpsParser reads neither compressed dumps nor snapshots and has no say in
+    // which position columns it takes, so those cases always take their own reader.
+    const bool ownReader = detectCompression(path) != Compression::None || isSnapshot(path) || preferUnwrapped;
+    if(useMmap || ownReader){
+        try{
+            auto reader = openDumpReader(path, preferUnwrapped);
+            if(reader->readFrame(frame)) return true;
+            spdlog::warn("No frame found in {}", path);
+            if(ownReader) return false;
+        }catch(const std::runtime_error& e){
+            if(ownReader){
+                spdlog::error("{}", e.what());
+                return false;
+            }
+            spdlog::warn("{}; falling back to LammpsParser", e.what());
+        }
+    }
+    LammpsParser::Frame parsed;
+    if(!CLI::parseFrame(path, parsed)) return false;
+    frame = AtomicStrainFrame::fromLammpsFrame(parsed);
+    return true;
+}
+
+bool loadTimestep(const std::string& path, long long timestep, bool persistIndex, bool preferUnwrapped, AtomicStrainFrame& frame){
+    try{
+        if(detectCompression(path) != Compression::None){
+            auto reader = openDumpReader(path, preferUnwrapped);
+            while(reader->readFrame(frame)){
+                if(frame.timestep == timestep) return true;
+            }
+        }else{
+            const auto index = AtomicStrainFrameIndex::open(path, persistIndex, preferUnwrapped);
+            if(const auto* info = index.find(timestep)){
+                frame = index.readFrame(*info);
+                return true;
+            }
+        }
+        spdlog::error("Timestep {} not found in {}", timestep, path);
+    }catch(const std::runtime_error& e){
+        spdlog::error("{}", e.what());
+    }
+    return false;
+}
+
+AtomicStrainFrameInfo peekFrame(const std::string& path){
+    auto reader = openDumpReader(path);
+    AtomicStrainFrameInfo info;
+    if(!reader->skipFrame(info)) throw std::runtime_error("No frame found in " + path);
+    return info;
+}
+
+}
@@ -0,0 +1,245 @@
+#include <volt/atomic_strain_octree.h>
+#include <volt/atomic_strain_morton.h>
+#include <volt/atomic_strain_parallel.h>
+
+#include <algorithm>
+#include <cstring>
+#include <limits>
+#include <numeric>
+#include <vector>
+#include <tbb/blocked_range.h>
+#include <tbb/combinable.h>
+#include <spdlog/spdlog.h>
+
+namespace Volt{
+
+namespace{
+
+constexpr std::size_t TargetPointsPerLeaf = 64;
+
+struct Bounds{
+    double min[3] = {
+        std::numeric_limits<double>::max(),
+        std::numeric_limits<double>::max(),
+        std::numeric_limits<double>::max()
+    };
+    double max[3] = {
+        std::numeric_limits<double>::lowest(),
+        std::numeric_limits<double>::lowest(),
+        std::numeric_limits<double>::lowest()
+    };
+
+    void add(const Point3& p){
+        for(std::size_t k = 0; k < 3; ++k){
+            min[k] = std::min(min[k], p[k]);
+            max[k] = std::max(max[k], p[k]);
+        }
+    }
+
+    void merge(const Bounds& other){
+        for(std::size_t k = 0; k < 3; ++k){
+            min[k] = std::min(min[k], other.min[k]);
+            max[k] = std::max(max[k], other.max[k]);
+        }
+    }
+};
+
+struct Level{
+    std::vector<Octree::Node> nodes;
+    std::vector<double> shearSums;
+};
+
+unsigned automaticDepth(std::size_t numPoints){
+    unsigned depth = 1;
+    while(depth < Morton::MaxBitsPerAxis && (std::uint64_t{1} << (3 * depth)) * TargetPointsPerLeaf < numPoints){
+        ++depth;
+    }
+    return depth;
+}
+
+// Groups the nodes of a level by parent cell and aggregates the groups in parallel.
+Level buildParentLevel(const Level& children, std::uint32_t parentLevel, bool serial){
+    std::vector<std::size_t> groupStarts;
+    for(std::size_t i = 0; i < children.nodes.size(); ++i){
+        if(i == 0 || (children.nodes[i].code >> 3) != (children.nodes[i - 1].code >> 3)){
+            groupStarts.push_back(i);
+        }
+    }
+    groupStarts.push_back(children.nodes.size());
+
+    Level parents;
+    parents.nodes.resize(groupStarts.size() - 1);
+    parents.shearSums.resize(groupStarts.size() - 1);
+
+    parallelFor(tbb::blocked_range<std::size_t>(0, parents.nodes.size()), serial,
+        [&](const tbb::blocked_range<std::size_t>& r){
+            for(std::size_t g = r.begin(); g < r.end(); ++g){
+                const std::size_t begin = groupStarts[g];
+                const std::size_t end = groupStarts[g + 1];
+
+                Octree::Node& node = parents.nodes[g];
+                node.code = children.nodes[begin].code >> 3;
+                node.firstPoint = children.nodes[begin].firstPoint;
+                node.level = parentLevel;
+                node.firstChild = static_cast<std::uint32_t>(begin);
+                node.numChildren = static_cast<std::uint32_t>(end - begin);
+                node.count = 0;
+                node.maxShear = 0.0f;
+
+                double sum = 0.0;
+                for(std::size_t c = begin; c < end; ++c){
+                    node.count += children.nodes[c].count;
+                    node.maxShear = std::max(node.maxShear, children.nodes[c].maxShear);
+                    sum += children.shearSums[c];
+                }
+                parents.shearSums[g] = sum;
+                node.meanShear = node.count > 0 ? static_cast<float>(sum / node.count) : 0.0f;
+            }
+        });
+    return parents;
+}
+
+}
+
+bool writeOctreeResult(
+    const AtomicStrainResult& result,
+    unsigned maxDepth,
+    const std::string& path,
+    FileWriteMode mode,
+    bool serial
+){
+    if(!result.shearStrains || !result.positions) return false;
+
+    const std::size_t n = result.numRows();
+    std::vector<Point3> points(n);
+    tbb::combinable<Bounds> localBounds;
+    parallelFor(tbb::blocked_range<std::size_t>(0, n), serial,
+        [&](const tbb::blocked_range<std::size_t>& r){
+            Bounds& bounds = localBounds.local();
+            for(std::size_t row = r.begin(); row < r.end(); ++row){
+                points[row] = result.referencePosition(result.atomIndex(row));
+                bounds.add(points[row]);
+            }
+        });
+    Bounds bounds;
+    localBounds.combine_each([&bounds](const Bounds& b){ bounds.merge(b); });
+    if(n == 0){
+        for(std::size_t k = 0; k < 3; ++k) bounds.min[k] = bounds.max[k] = 0.0;
+    }
+
+    const unsigned depth = maxDepth > 0 ? std::min(maxDepth, Morton::MaxBitsPerAxis) : automaticDepth(n);
+    const Morton::Grid grid = Morton::makeGrid(bounds.min, bounds.max, depth);
+
+    std::vector<std::uint64_t> codes(n);
+    std::vector<std::size_t> order(n);
+    parallelFor(tbb::blocked_range<std::size_t>(0, n), serial,
+        [&](const tbb::blocked_range<std::size_t>& r){
+            for(std::size_t row = r.begin(); row < r.end(); ++row){
+                codes[row] = grid.code(points[row]);
+                order[row] = row;
+            }
+        });
+    parallelSort(order.begin(), order.end(), serial, [&codes](std::size_t a, std::size_t b){
+        return codes[a] < codes[b] || (codes[a] == codes[b] && a < b);
+    });
+
+    // Leaves: one node per occupied cell at the finest level.
+    std::vector<Level> levels(depth + 1);
+    Level& leaves = levels[depth];
+    for(std::size_t i = 0; i < n; ++i){
+        if(i == 0 || codes[order[i]] != codes[order[i - 1]]){
+            Octree::Node node{};
+            node.code = codes[order[i]];
+            node.firstPoint = i;
+            node.level = depth;
+            leaves.nodes.push_back(node);
+        }
+        ++leaves.nodes.back().count;
+    }
+    leaves.shearSums.resize(leaves.nodes.size());
+
+    parallelFor(tbb::blocked_range<std::size_t>(0, leaves.nodes.size()), serial,
+        [&](const tbb::blocked_range<std::size_t>& r){
+            for(std::size_t l = r.begin(); l < r.end(); ++l){
+                Octree::Node& node = leaves.nodes[l];
+                double sum = 0.0;
+                double maxShear = 0.0;
+                for(std::size_t i = node.firstPoint; i < node.firstPoint + node.count; ++i){
+                    const double shear = result.shearStrains->getDouble(result.atomIndex(order[i]));
+                    sum += shear;
+                    maxShear = std::max(maxShear, shear);
+                }
+                leaves.shearSums[l] = sum;
+                node.meanShear = static_cast<float>(sum / node.count);
+                node.maxShear = static_cast<float>(maxShear);
+            }
+        });
+
+    for(unsigned level = depth; level > 0; --level){
+        levels[level - 1] = buildParentLevel(levels[level], level - 1, serial);
+    }
+
+    // Breadth-first layout: child indices become global node indices.
+    std::vector<Octree::LevelEntry> levelTable(depth + 1);
+    std::uint64_t numNodes = 0;
+    for(unsigned level = 0; level <= depth; ++level){
+        levelTable[level] = { numNodes, levels[level].nodes.size() };
+        numNodes += levels[level].nodes.size();
+    }
+    for(unsigned level = 0; level < depth; ++level){
+        for(Octree::Node& node : levels[level].nodes){
+            node.firstChild += static_cast<std::uint32_t>(levelTable[level + 1].firstNode);
+        }
+    }
+
+    Octree::Header header{};
+    std::memcpy(header.magic, Octree::Magic, sizeof(header.magic));
+    header.version = Octree::Version;
+    header.numLevels = depth + 1;
+    header.numNodes = numNodes;
+    header.numPoints = n;
+    for(std::size_t k = 0; k < 3; ++k){
+        header.boundsMin[k] = bounds.min[k];
+        header.boundsMax[k] = bounds.max[k];
+    }
+    header.levelTableOffset = sizeof(Octree::Header);
+    header.nodeOffset = header.levelTableOffset + levelTable.size() * sizeof(Octree::LevelEntry);
+    header.pointOffset = header.nodeOffset + numNodes * sizeof(Octree::Node);
+
+    BufferedFileWriter writer(BufferedFileWriter::DefaultBufferSize, mode);
+    if(!writer.open(path, header.pointOffset + n * sizeof(Octree::Point))) return false;
+    writer.write(&header, sizeof(header));
+    writer.write(levelTable.data(), levelTable.size() * sizeof(Octree::LevelEntry));
+    for(const Level& level : levels){
+        writer.write(level.nodes.data(), level.nodes.size() * sizeof(Octree::Node));
+    }
+
+    constexpr std::size_t ChunkPoints = 1u << 16;
+    std::vector<Octree::Point> chunk;
+    for(std::size_t begin = 0; begin < n; begin += ChunkPoints){
+        const std::size_t end = std::min(n, begin + ChunkPoints);
+        chunk.resize(end - begin);
+        parallelFor(tbb::blocked_range<std::size_t>(begin, end), serial,
+            [&](const tbb::blocked_range<std::size_t>& r){
+                for(std::size_t i = r.begin(); i < r.end(); ++i){
+                    const std::size_t row = order[i];
+                    const std::size_t atom = result.atomIndex(row);
+                    Octree::Point& point = chunk[i - begin];
+                    point.id = result.identifier(atom);
+                    point.position[0] = static_cast<float>(points[row].x());
+                    point.position[1] = static_cast<float>(points[row].y());
+                    point.position[2] = static_cast<float>(points[row].z());
+                    point.shearStrain = static_cast<float>(result.shearStrains->getDouble(atom));
+                }
+            });
+        writer.write(chunk.data(), chunk.size() * sizeof(Octree::Point));
+    }
+
+    if(!writer.close()){
+        spdlog::warn("Failed to write atomic strain octree: {}", path);
+        return false;
+    }
+    return true;
+}
+
+}
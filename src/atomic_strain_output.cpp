@@ -0,0 +1,104 @@
+#include <volt/atomic_strain_output.h>
+
+#include <array>
+#include <stdexcept>
+#include <utility>
+
+namespace Volt{
+
+namespace{
+
+constexpr std::array<std::pair<std::string_view, AtomicStrainField>, 15> fieldNames{{
+    { "shear", AtomicStrainField::ShearStrain },
+    { "shear_strain", AtomicStrainField::ShearStrain },
+    { "volumetric", AtomicStrainField::VolumetricStrain },
+    { "volumetric_strain", AtomicStrainField::VolumetricStrain },
+    { "strain", AtomicStrainField::StrainTensor },
+    { "strain_tensor", AtomicStrainField::StrainTensor },
+    { "F", AtomicStrainField::DeformationGradient },
+    { "defgrad", AtomicStrainField::DeformationGradient },
+    { "deformation_gradient", AtomicStrainField::DeformationGradient },
+    { "d2min", AtomicStrainField::D2min },
+    { "D2min", AtomicStrainField::D2min },
+    { "invalid", AtomicStrainField::Invalid },
+    { "all", AtomicStrainField::All },
+    { "none", AtomicStrainField::None },
+    { "summary", AtomicStrainField::None }
+}};
+
+std::string_view trim(std::string_view s){
+    while(!s.empty() && (s.front() == ' ' || s.front() == '\t')) s.remove_prefix(1);
+    while(!s.empty() && (s.back() == ' ' || s.back() == '\t')) s.remove_suffix(1);
+    return s;
+}
+
+}
+
+AtomicStrainField parseAtomicStrainFields(std::string_view list){
+    AtomicStrainField fields = AtomicStrainField::None;
+    while(!list.empty()){
+        const std::size_t comma = list.find(',');
+        std::string_view token = trim(list.substr(0, comma));
+        list = comma == std::string_view::npos ? std::string_view{} : list.substr(comma + 1);
+        if(token.empty()) continue;
+
+        bool found = false;
+        for(const auto& [name, field] : fieldNames){
+            if(name == token){
+                fields = fields | field;
+                found = true;
+                break;
+            }
+        }
+        if(!found){
+            throw std::invalid_argument("Unknown atomic strain output field: " + std::string(token));
+        }
+    }
+    return fields;
+}
+
+std::string atomicStrainFieldsToString(AtomicStrainField fields){
+    static constexpr std::array<std::pair<std::string_view, AtomicStrainField>, 6> canonical{{
+        { "shear_strain", AtomicStrainField::ShearStrain },
+        { "volumetric_strain", AtomicStrainField::VolumetricStrain },
+        { "strain_tensor", AtomicStrainField::StrainTensor },
+        { "deformation_gradient", AtomicStrainField::DeformationGradient },
+        { "D2min", AtomicStrainField::D2min },
+        { "invalid", AtomicStrainField::Invalid }
+    }};
+
+    std::string result;
+    for(const auto& [name, field] : canonical){
+        if(!hasField(fields, field)) continue;
+        if(!result.empty()) result += ',';
+        result += name;
+    }
+    return result;
+}
+
+AtomicStrainEncoding parseAtomicStrainEncoding(std::string_view name){
+    if(name == "float64" || name == "double") return AtomicStrainEncoding::Float64;
+    if(name == "float32" || name == "float") return AtomicStrainEncoding::Float32;
+    if(name == "quantized") return AtomicStrainEncoding::Quantized;
+    throw std::invalid_argument("Unknown atomic strain output encoding: " + std::string(name));
+}
+
+std::string_view atomicStrainEncodingName(AtomicStrainEncoding encoding){
+    switch(encoding){
+        case AtomicStrainEncoding::Float32: return "float32";
+        case AtomicStrainEncoding::Quantized: return "quantized";
+        case AtomicStrainEncoding::Float64: break;
+    }
+    return "float64";
+}
+
+AtomicStrainOutputFormat parseAtomicStrainOutputFormat(std::string_view name){
+    if(name == "msgpack") return AtomicStrainOutputFormat::Msgpack;
+    if(name == "columnar" || name == "vcol") return AtomicStrainOutputFormat::Columnar;
+    if(name == "dump" || name == "lammps") return AtomicStrainOutputFormat::LammpsDump;
+    if(name == "delta") return AtomicStrainOutputFormat::Delta;
+    if(name == "octree") return AtomicStrainOutputFormat::Octree;
+    throw std::invalid_argument("Unknown atomic strain output format: " + std::string(name));
+}
+
+}
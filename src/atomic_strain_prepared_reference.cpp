@@ -0,0 +1,476 @@
+#include <volt/atomic_strain_prepared_reference.h>
+#include <volt/atomic_strain_columnar_format.h>
+#include <volt/atomic_strain_dump_format.h>
+#include <volt/atomic_strain_file_writer.h>
+#include <volt/atomic_strain_mapped_file.h>
+#include <volt/analysis/cutoff_neighbor_finder.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <limits>
+#include <numeric>
+#include <stdexcept>
+#include <vector>
+#include <fcntl.h>
+#include <sys/file.h>
+#include <unistd.h>
+#include <spdlog/spdlog.h>
+#include <tbb/parallel_for.h>
+#include <tbb/parallel_sort.h>
+#include <tbb/blocked_range.h>
+
+namespace Volt{
+
+using namespace Volt::Particles;
+
+namespace{
+
+constexpr std::size_t HashBlockBytes = 4u << 20;
+
+constexpr const char* LockSuffix = ".lock";
+constexpr const char* TempSuffix = ".tmp";
+
+// Exclusive flock on "<file>.lock" while a prepared reference is built, so that
+// processes sharing a cache directory wait for one builder instead of all building.
+// The lock file is left in place; evict() removes it once the cache file is gone.
+class BuildLock{
+public:
+    explicit BuildLock(const std::string& path)
+        : _fd(::open((path + LockSuffix).c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0600)){
+        if(_fd >= 0 && ::flock(_fd, LOCK_EX) != 0){
+            ::close(_fd);
+            _fd = -1;
+        }
+    }
+
+    ~BuildLock(){
+        if(_fd >= 0) ::close(_fd);
+    }
+
+    BuildLock(const BuildLock&) = delete;
+    BuildLock& operator=(const BuildLock&) = delete;
+
+private:
+    int _fd;
+};
+
+struct BuiltArrays{
+    std::vector<std::size_t> identifierOrder;
+    std::vector<std::uint64_t> neighborOffsets;
+    std::vector<std::int32_t> neighbors;
+    std::vector<double> deltas;
+    std::vector<double> inverseV;
+    std::vector<std::uint8_t> invertible;
+    std::vector<PreparedReference::Sample> samples;
+};
+
+PreparedReference::Sample sampleOf(const ParticleProperty& positions, const ParticleProperty* identifiers, std::size_t atom){
+    PreparedReference::Sample sample{};
+    const Point3 p = positions.getPoint3(atom);
+    for(std::size_t k = 0; k < 3; ++k) sample.position[k] = p[k];
+    sample.identifier = identifiers ? identifiers->getInt(atom) : -1;
+    return sample;
+}
+
+// FNV-1a per block in parallel, then over the block digests.
+std::uint64_t hashBytes(const void* data, std::size_t size, std::uint64_t seed){
+    const char* bytes = static_cast<const char*>(data);
+    const std::size_t numBlocks = (size + HashBlockBytes - 1) / HashBlockBytes;
+    std::vector<std::uint64_t> digests(numBlocks);
+    tbb::parallel_for(std::size_t(0), numBlocks, [&](std::size_t i){
+        const std::size_t begin = i * HashBlockBytes;
+        digests[i] = Columnar::checksum(bytes + begin, std::min(HashBlockBytes, size - begin));
+    });
+    const std::uint64_t sized = Columnar::checksum(&size, sizeof(size), seed);
+    return Columnar::checksum(digests.data(), digests.size() * sizeof(std::uint64_t), sized);
+}
+
+template<typename T>
+std::span<const T> mappedArray(const MappedFile& file, std::uint64_t offset, std::uint64_t count){
+    return { reinterpret_cast<const T*>(file.data() + offset), static_cast<std::size_t>(count) };
+}
+
+bool arrayFits(const MappedFile& file, std::uint64_t offset, std::uint64_t count, std::size_t elementSize){
+    return offset % PreparedReference::Alignment == 0 &&
+        offset <= file.size() &&
+        count <= (file.size() - offset) / elementSize;
+}
+
+template<typename T>
+bool writeArray(BufferedFileWriter& writer, std::span<const T> values, std::uint64_t& offset){
+    if(!writer.writePadding(PreparedReference::Alignment)) return false;
+    offset = writer.offset();
+    return writer.write(values.data(), values.size_bytes());
+}
+
+}
+
+std::uint64_t AtomicStrainPreparedReference::contentHash(
+    const ParticleProperty& positions,
+    const ParticleProperty* identifiers,
+    const SimulationCell& cell
+){
+    std::uint64_t hash = hashBytes(positions.constDataDouble(), positions.size() * 3 * sizeof(double), Columnar::ChecksumSeed);
+    if(identifiers){
+        hash = hashBytes(identifiers->constDataInt(), identifiers->size() * sizeof(int), hash);
+    }
+    const std::array<double, 12> matrix = cellToArray(cell);
+    return Columnar::checksum(matrix.data(), sizeof(matrix), hash);
+}
+
+std::uint64_t AtomicStrainPreparedReference::key(std::uint64_t contentHash, double cutoff, const std::array<bool, 3>& pbc){
+    struct{
+        std::uint64_t contentHash;
+        double cutoff;
+        std::uint32_t version;
+        std::uint8_t pbc[4];
+    } fields{ contentHash, cutoff, PreparedReference::Version, { pbc[0], pbc[1], pbc[2], 0 } };
+    return Columnar::checksum(&fields, sizeof(fields));
+}
+
+std::shared_ptr<const AtomicStrainPreparedReference> AtomicStrainPreparedReference::build(
+    ParticleProperty* positions,
+    const ParticleProperty* identifiers,
+    const SimulationCell& cell,
+    double cutoff,
+    std::uint64_t key
+){
+    const std::size_t n = positions->size();
+    auto arrays = std::make_shared<BuiltArrays>();
+
+    if(identifiers){
+        const int* ids = identifiers->constDataInt();
+        arrays->identifierOrder.resize(n);
+        std::iota(arrays->identifierOrder.begin(), arrays->identifierOrder.end(), std::size_t{0});
+        tbb::parallel_sort(arrays->identifierOrder.begin(), arrays->identifierOrder.end(), [ids](std::size_t a, std::size_t b){
+            return ids[a] < ids[b];
+        });
+        const bool duplicates = std::adjacent_find(arrays->identifierOrder.begin(), arrays->identifierOrder.end(), [ids](std::size_t a, std::size_t b){
+            return ids[a] == ids[b];
+        }) != arrays->identifierOrder.end();
+        if(duplicates) throw std::runtime_error("Particles with duplicate identifiers detected in reference configuration.");
+    }
+
+    CutoffNeighborFinder neighborFinder;
+    if(!neighborFinder.prepare(cutoff, positions, cell)){
+        throw std::runtime_error("Cannot build neighbor lists for the reference configuration.");
+    }
+
+    // Neighbors are counted first so every atom can fill its own CSR row concurrently.
+    std::vector<std::uint64_t>& offsets = arrays->neighborOffsets;
+    offsets.assign(n + 1, 0);
+    tbb::parallel_for(tbb::blocked_range<std::size_t>(0, n), [&](const tbb::blocked_range<std::size_t>& r){
+        for(std::size_t i = r.begin(); i < r.end(); ++i){
+            std::uint64_t count = 0;
+            for(CutoffNeighborFinder::Query query(neighborFinder, i); !query.atEnd(); query.next()) ++count;
+            offsets[i + 1] = count;
+        }
+    });
+    std::partial_sum(offsets.begin(), offsets.end(), offsets.begin());
+
+    const std::size_t numNeighbors = static_cast<std::size_t>(offsets[n]);
+    arrays->neighbors.resize(numNeighbors);
+    arrays->deltas.resize(3 * numNeighbors);
+    arrays->inverseV.assign(9 * n, 0.0);
+    arrays->invertible.assign(n, 0);
+
+    tbb::parallel_for(tbb::blocked_range<std::size_t>(0, n), [&](const tbb::blocked_range<std::size_t>& r){
+        for(std::size_t i = r.begin(); i < r.end(); ++i){
+            Matrix_3<double> V = Matrix_3<double>::Zero();
+            std::size_t k = static_cast<std::size_t>(offsets[i]);
+            for(CutoffNeighborFinder::Query query(neighborFinder, i); !query.atEnd(); query.next(), ++k){
+                const Vector3& r0 = query.delta();
+                arrays->neighbors[k] = static_cast<std::int32_t>(query.current());
+                for(std::size_t c = 0; c < 3; ++c){
+                    arrays->deltas[3 * k + c] = r0[c];
+                }
+                for(std::size_t a = 0; a < 3; ++a){
+                    for(std::size_t b = 0; b < 3; ++b){
+                        V(a, b) += r0[b] * r0[a];
+                    }
+                }
+            }
+
+            Matrix_3<double> inverse;
+            if(V.inverse(inverse, 1e-4)){
+                arrays->invertible[i] = 1;
+                for(std::size_t a = 0; a < 3; ++a){
+                    for(std::size_t b = 0; b < 3; ++b){
+                        arrays->inverseV[9 * i + 3 * a + b] = inverse(a, b);
+                    }
+                }
+            }
+        }
+    });
+
+    const std::uint64_t numSamples = PreparedReference::numSamples(n);
+    for(std::uint64_t k = 0; k < numSamples; ++k){
+        const std::size_t atom = static_cast<std::size_t>(PreparedReference::sampleAtom(k, n, numSamples));
+        arrays->samples.push_back(sampleOf(*positions, identifiers, atom));
+    }
+
+    auto prepared = std::make_shared<AtomicStrainPreparedReference>();
+    prepared->_key = key;
+    prepared->_cutoff = cutoff;
+    prepared->_numAtoms = n;
+    prepared->_cell = cellToArray(cell);
+    prepared->_samples = arrays->samples;
+    prepared->_identifierOrder = arrays->identifierOrder;
+    prepared->_neighborOffsets = arrays->neighborOffsets;
+    prepared->_neighbors = arrays->neighbors;
+    prepared->_deltas = arrays->deltas;
+    prepared->_inverseV = arrays->inverseV;
+    prepared->_invertible = arrays->invertible;
+    prepared->_storage = std::move(arrays);
+    return prepared;
+}
+
+std::shared_ptr<const AtomicStrainPreparedReference> AtomicStrainPreparedReference::load(const std::string& path, std::uint64_t key){
+    auto file = std::make_shared<MappedFile>();
+    if(!file->open(path)) return nullptr;
+    if(file->size() < sizeof(PreparedReference::FileHeader)){
+        spdlog::warn("Ignoring truncated prepared reference: {}", path);
+        return nullptr;
+    }
+
+    PreparedReference::FileHeader header;
+    std::memcpy(&header, file->data(), sizeof(header));
+    if(std::memcmp(header.magic, PreparedReference::Magic, sizeof(header.magic)) != 0 ||
+       header.version != PreparedReference::Version ||
+       header.key != key){
+        spdlog::warn("Ignoring stale prepared reference: {}", path);
+        return nullptr;
+    }
+
+    const std::uint64_t n = header.numAtoms;
+    const std::uint64_t m = header.numNeighbors;
+    const bool hasOrder = header.flags & PreparedReference::HasIdentifierOrder;
+    const bool fits = n < std::numeric_limits<std::int32_t>::max() &&
+        (!hasOrder || arrayFits(*file, header.identifierOrderOffset, n, sizeof(std::size_t))) &&
+        arrayFits(*file, header.neighborOffsetsOffset, n + 1, sizeof(std::uint64_t)) &&
+        arrayFits(*file, header.neighborsOffset, m, sizeof(std::int32_t)) &&
+        arrayFits(*file, header.deltasOffset, m, 3 * sizeof(double)) &&
+        arrayFits(*file, header.inverseVOffset, n, 9 * sizeof(double)) &&
+        arrayFits(*file, header.invertibleOffset, n, 1) &&
+        header.numSamples == PreparedReference::numSamples(n) &&
+        arrayFits(*file, header.samplesOffset, header.numSamples, sizeof(PreparedReference::Sample));
+    if(!fits){
+        spdlog::warn("Ignoring malformed prepared reference: {}", path);
+        return nullptr;
+    }
+
+    auto prepared = std::make_shared<AtomicStrainPreparedReference>();
+    prepared->_key = key;
+    prepared->_cutoff = header.cutoff;
+    prepared->_numAtoms = static_cast<std::size_t>(n);
+    if(hasOrder) prepared->_identifierOrder = mappedArray<std::size_t>(*file, header.identifierOrderOffset, n);
+    prepared->_neighborOffsets = mappedArray<std::uint64_t>(*file, header.neighborOffsetsOffset, n + 1);
+    prepared->_neighbors = mappedArray<std::int32_t>(*file, header.neighborsOffset, m);
+    prepared->_deltas = mappedArray<double>(*file, header.deltasOffset, 3 * m);
+    prepared->_inverseV = mappedArray<double>(*file, header.inverseVOffset, 9 * n);
+    prepared->_invertible = mappedArray<std::uint8_t>(*file, header.invertibleOffset, n);
+    prepared->_samples = mappedArray<PreparedReference::Sample>(*file, header.samplesOffset, header.numSamples);
+    std::copy(std::begin(header.cell), std::end(header.cell), prepared->_cell.begin());
+
+    // Every index is checked once, so a damaged file cannot make the engine read out of bounds.
+    std::atomic<bool> valid{ prepared->_neighborOffsets[0] == 0 && prepared->_neighborOffsets[n] == m };
+    tbb::parallel_for(tbb::blocked_range<std::size_t>(0, static_cast<std::size_t>(n)), [&](const tbb::blocked_range<std::size_t>& r){
+        for(std::size_t i = r.begin(); i < r.end() && valid.load(std::memory_order_relaxed); ++i){
+            const std::uint64_t begin = prepared->_neighborOffsets[i];
+            const std::uint64_t end = prepared->_neighborOffsets[i + 1];
+            bool ok = begin <= end && end <= m;
+            for(std::uint64_t k = begin; ok && k < end; ++k){
+                ok = prepared->_neighbors[k] >= 0 && static_cast<std::uint64_t>(prepared->_neighbors[k]) < n;
+            }
+            if(hasOrder) ok = ok && prepared->_identifierOrder[i] < n;
+            if(!ok) valid.store(false, std::memory_order_relaxed);
+        }
+    });
+    if(!valid){
+        spdlog::warn("Ignoring malformed prepared reference: {}", path);
+        return nullptr;
+    }
+
+    prepared->_storage = std::move(file);
+    return prepared;
+}
+
+bool AtomicStrainPreparedReference::save(const std::string& path) const{
+    // Renamed into place once complete, so concurrent runs never map a partial file.
+    const std::string tempPath = path + TempSuffix;
+    BufferedFileWriter writer;
+    if(!writer.open(tempPath)) return false;
+
+    PreparedReference::FileHeader header{};
+    std::memcpy(header.magic, PreparedReference::Magic, sizeof(header.magic));
+    header.version = PreparedReference::Version;
+    header.flags = _identifierOrder.empty() ? 0u : static_cast<std::uint32_t>(PreparedReference::HasIdentifierOrder);
+    header.key = _key;
+    header.numAtoms = _numAtoms;
+    header.numNeighbors = _neighbors.size();
+    header.cutoff = _cutoff;
+    std::copy(_cell.begin(), _cell.end(), header.cell);
+    header.numSamples = _samples.size();
+
+    bool ok = writer.write(&header, sizeof(header));
+    if(ok && !_identifierOrder.empty()) ok = writeArray(writer, _identifierOrder, header.identifierOrderOffset);
+    ok = ok && writeArray(writer, _neighborOffsets, header.neighborOffsetsOffset);
+    ok = ok && writeArray(writer, _neighbors, header.neighborsOffset);
+    ok = ok && writeArray(writer, _deltas, header.deltasOffset);
+    ok = ok && writeArray(writer, _inverseV, header.inverseVOffset);
+    ok = ok && writeArray(writer, _invertible, header.invertibleOffset);
+    ok = ok && writeArray(writer, _samples, header.samplesOffset);
+    ok = ok && writer.writeAt(0, &header, sizeof(header));
+    ok = writer.close() && ok;
+
+    if(!ok || std::rename(tempPath.c_str(), path.c_str()) != 0){
+        spdlog::warn("Failed to write prepared reference: {}", path);
+        std::remove(tempPath.c_str());
+        return false;
+    }
+    return true;
+}
+
+std::shared_ptr<const AtomicStrainPreparedReference> AtomicStrainPreparedReference::loadOrBuild(
+    const std::string& directory,
+    ParticleProperty* positions,
+    const ParticleProperty* identifiers,
+    const SimulationCell& cell,
+    double cutoff,
+    std::uint64_t key,
+    std::uint64_t maxBytes
+){
+    char name[32];
+    std::snprintf(name, sizeof(name), "%016llx", static_cast<unsigned long long>(key));
+    const std::string path = (std::filesystem::path(directory) / (std::string(name) + PreparedReference::Extension)).string();
+
+    const auto loadCurrent = [&]() -> std::shared_ptr<const AtomicStrainPreparedReference>{
+        auto prepared = load(path, key);
+        if(!prepared) return nullptr;
+        if(prepared->cutoff() == cutoff && prepared->matches(*positions, identifiers, cell)){
+            // Marks the file as recently used for evict().
+            ::utimensat(AT_FDCWD, path.c_str(), nullptr, 0);
+            spdlog::info("Using prepared reference {}", path);
+            return prepared;
+        }
+        spdlog::warn("Ignoring stale prepared reference: {}", path);
+        return nullptr;
+    };
+    if(auto prepared = loadCurrent()) return prepared;
+
+    std::error_code error;
+    std::filesystem::create_directories(directory, error);
+    if(error){
+        spdlog::warn("Cannot create reference cache directory {}: {}", directory, error.message());
+        return build(positions, identifiers, cell, cutoff, key);
+    }
+
+    // Another process may have stored it while this one waited for the lock.
+    BuildLock lock(path);
+    if(auto prepared = loadCurrent()) return prepared;
+
+    auto prepared = build(positions, identifiers, cell, cutoff, key);
+    if(prepared->save(path)){
+        spdlog::info("Stored prepared reference {}", path);
+        if(maxBytes > 0) evict(directory, maxBytes, path);
+    }
+    return prepared;
+}
+
+std::uint64_t AtomicStrainPreparedReference::evict(const std::string& directory, std::uint64_t maxBytes, const std::string& keep){
+    namespace fs = std::filesystem;
+    struct CacheFile{
+        fs::path path;
+        std::uint64_t size;
+        fs::file_time_type used;
+    };
+
+    std::vector<CacheFile> files;
+    std::vector<fs::path> locks;
+    std::uint64_t total = 0;
+    std::error_code error;
+    for(fs::directory_iterator it(directory, error), end; !error && it != end; it.increment(error)){
+        std::error_code fileError;
+        const fs::path& path = it->path();
+        if(path.extension() == LockSuffix){
+            locks.push_back(path);
+        }else if(path.extension() == PreparedReference::Extension && it->is_regular_file(fileError)){
+            const std::uint64_t size = it->file_size(fileError);
+            const fs::file_time_type used = it->last_write_time(fileError);
+            if(fileError) continue;
+            files.push_back({ path, size, used });
+            total += size;
+        }
+    }
+
+    // Least recently used first. Processes still mapping a removed file keep their pages.
+    std::sort(files.begin(), files.end(), [](const CacheFile& a, const CacheFile& b){
+        return a.used < b.used;
+    });
+    std::uint64_t removed = 0;
+    for(const CacheFile& file : files){
+        if(total - removed <= maxBytes) break;
+        if(file.path == fs::path(keep)) continue;
+        std::error_code removeError;
+        if(fs::remove(file.path, removeError)){
+            spdlog::info("Evicted prepared reference {}", file.path.string());
+            removed += file.size;
+        }
+    }
+
+    // A lock nobody holds guards no build, so a leftover temporary file is from a build
+    // that died. Its lock goes too once the cache file is gone; a process that opened
+    // the removed lock just before may build the file a second time, which the atomic
+    // rename of save() tolerates.
+    for(const fs::path& lockPath : locks){
+        const int fd = ::open(lockPath.c_str(), O_RDWR | O_CLOEXEC);
+        if(fd < 0) continue;
+        if(::flock(fd, LOCK_EX | LOCK_NB) == 0){
+            fs::path cachePath = lockPath;
+            cachePath.replace_extension();
+            std::error_code removeError;
+            fs::remove(cachePath.string() + TempSuffix, removeError);
+            if(!fs::exists(cachePath, removeError)) fs::remove(lockPath, removeError);
+        }
+        ::close(fd);
+    }
+    return removed;
+}
+
+std::string AtomicStrainPreparedReference::sharedDirectory(){
+    std::error_code error;
+    const std::filesystem::path shm("/dev/shm");
+    const std::filesystem::path base = std::filesystem::is_directory(shm, error) ? shm : std::filesystem::temp_directory_path();
+    return (base / PreparedReference::SharedDirectoryName).string();
+}
+
+bool AtomicStrainPreparedReference::matches(
+    const ParticleProperty& positions,
+    const ParticleProperty* identifiers,
+    const SimulationCell& cell
+) const{
+    if(positions.size() != _numAtoms || cellToArray(cell) != _cell) return false;
+    if(_samples.size() != PreparedReference::numSamples(_numAtoms)) return false;
+    for(std::size_t k = 0; k < _samples.size(); ++k){
+        const std::size_t atom = static_cast<std::size_t>(PreparedReference::sampleAtom(k, _numAtoms, _samples.size()));
+        const PreparedReference::Sample expected = sampleOf(positions, identifiers, atom);
+        if(std::memcmp(&expected, &_samples[k], sizeof(expected)) != 0) return false;
+    }
+    return true;
+}
+
+Matrix_3<double> AtomicStrainPreparedReference::inverseV(std::size_t atom) const{
+    Matrix_3<double> inverse;
+    const double* values = _inverseV.data() + 9 * atom;
+    for(std::size_t a = 0; a < 3; ++a){
+        for(std::size_t b = 0; b < 3; ++b){
+            inverse(a, b) = values[3 * a + b];
+        }
+    }
+    return inverse;
+}
+
+}
@@ -0,0 +1,117 @@
+#include <volt/atomic_strain_selection.h>
+#include <volt/atomic_strain_parallel.h>
+
+#include <algorithm>
+#include <stdexcept>
+#include <utility>
+#include <tbb/blocked_range.h>
+#include <tbb/enumerable_thread_specific.h>
+
+namespace Volt{
+
+using namespace Particles;
+
+namespace{
+
+using Candidate = std::pair<double, std::size_t>;
+
+// Larger values first, ties broken by index so the result is deterministic.
+bool rankBefore(const Candidate& a, const Candidate& b){
+    return a.first > b.first || (a.first == b.first && a.second < b.second);
+}
+
+void keepTopK(std::vector<Candidate>& candidates, std::size_t k){
+    if(candidates.size() <= k) return;
+    std::nth_element(candidates.begin(), candidates.begin() + k, candidates.end(), rankBefore);
+    candidates.resize(k);
+}
+
+std::vector<std::size_t> filterByThreshold(
+    std::size_t n,
+    const ParticleProperty* shearStrains,
+    const ParticleProperty* d2min,
+    const AtomicStrainSelection& selection,
+    bool serial
+){
+    tbb::enumerable_thread_specific<std::vector<std::size_t>> localSelections;
+
+    parallelFor(tbb::blocked_range<std::size_t>(0, n), serial,
+        [&](const tbb::blocked_range<std::size_t>& r){
+            auto& local = localSelections.local();
+            for(std::size_t i = r.begin(); i < r.end(); ++i){
+                const bool shearActive = selection.shearThreshold &&
+                    shearStrains->getDouble(i) > *selection.shearThreshold;
+                const bool d2minActive = selection.d2minThreshold &&
+                    d2min->getDouble(i) > *selection.d2minThreshold;
+                if(shearActive || d2minActive) local.push_back(i);
+            }
+        });
+
+    std::vector<std::size_t> selected;
+    for(const auto& local : localSelections){
+        selected.insert(selected.end(), local.begin(), local.end());
+    }
+    return selected;
+}
+
+std::vector<std::size_t> topKByValue(std::size_t n, const ParticleProperty* values, std::size_t k, bool serial){
+    tbb::enumerable_thread_specific<std::vector<Candidate>> localCandidates;
+
+    parallelFor(tbb::blocked_range<std::size_t>(0, n), serial,
+        [&](const tbb::blocked_range<std::size_t>& r){
+            auto& local = localCandidates.local();
+            for(std::size_t i = r.begin(); i < r.end(); ++i){
+                local.emplace_back(values->getDouble(i), i);
+            }
+            // Bound per-thread memory to O(k) while keeping nth_element amortized linear.
+            if(local.size() / 2 > k) keepTopK(local, k);
+        });
+
+    std::vector<Candidate> merged;
+    for(auto& local : localCandidates){
+        keepTopK(local, k);
+        merged.insert(merged.end(), local.begin(), local.end());
+    }
+    keepTopK(merged, k);
+
+    std::vector<std::size_t> selected;
+    selected.reserve(merged.size());
+    for(const auto& candidate : merged) selected.push_back(candidate.second);
+    return selected;
+}
+
+}
+
+std::vector<std::size_t> selectAtoms(
+    const AtomicStrainSelection& selection,
+    const ParticleProperty* shearStrains,
+    const ParticleProperty* nonaffineSquaredDisplacements,
+    bool serial
+){
+    if(selection.needsShearStrains() && !shearStrains){
+        throw std::runtime_error("Shear strain threshold requires per-atom shear strains.");
+    }
+    if(selection.needsD2min() && !nonaffineSquaredDisplacements){
+        throw std::runtime_error("D2min selection requires per-atom D2min values.");
+    }
+
+    const std::size_t n = shearStrains ? shearStrains->size()
+        : nonaffineSquaredDisplacements ? nonaffineSquaredDisplacements->size()
+        : 0;
+
+    std::vector<std::size_t> selected;
+    if(selection.shearThreshold || selection.d2minThreshold){
+        selected = filterByThreshold(n, shearStrains, nonaffineSquaredDisplacements, selection, serial);
+    }
+
+    if(selection.topK > 0){
+        std::vector<std::size_t> top = topKByValue(n, nonaffineSquaredDisplacements, selection.topK, serial);
+        selected.insert(selected.end(), top.begin(), top.end());
+    }
+
+    parallelSort(selected.begin(), selected.end(), serial);
+    selected.erase(std::unique(selected.begin(), selected.end()), selected.end());
+    return selected;
+}
+
+}
@@ -1,14 +1,83 @@
 #include <volt/atomic_strain_service.h>
 #include <volt/atomic_strain_engine.h>
-#include <volt/core/frame_adapter.h>
+#include <volt/atomic_strain_prepared_reference.h>
+#include <volt/atomic_strain_columnar_writer.h>
+#include <volt/atomic_strain_dump_writer.h>
+#include <volt/atomic_strain_sharded_writer.h>
+#include <volt/atomic_strain_octree.h>
+#include <volt/atomic_strain_parallel.h>
 #include <volt/core/analysis_result.h>
 #include <volt/utilities/json_utils.h>
 #include <spdlog/spdlog.h>
+#include <tbb/parallel_for.h>
+#include <tbb/blocked_range.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <numbers>
+#include <stdexcept>
+#include <string_view>
 
 namespace Volt{
 
 using namespace Volt::Particles;
 
+namespace{
+
+// Memory model behind estimateMemory(), following the structures compute() allocates.
+// Positions and identifiers of one frame.
+constexpr std::size_t FrameBytesPerAtom = 3 * sizeof(double) + sizeof(int);
+// CutoffNeighborFinder keeps a wrapped position, the next particle of its bin and the
+// periodic shift per particle, and one list head per bin of about the cutoff.
+constexpr std::size_t NeighborFinderBytesPerAtom = 3 * sizeof(double) + sizeof(void*) + 3 * sizeof(int) + 4;
+constexpr std::size_t NeighborFinderBytesPerBin = sizeof(void*);
+// Prepared reference: neighbor offset, V^-1, invertible flag and identifier order per
+// atom, neighbor index and r0 per neighbor.
+constexpr std::size_t PreparedBytesPerAtom = sizeof(std::uint64_t) + 9 * sizeof(double) + 1 + sizeof(std::size_t);
+constexpr std::size_t PreparedBytesPerNeighbor = sizeof(std::int32_t) + 3 * sizeof(double);
+// Coarse figures for the json and hash containers, measured with nlohmann::json 3.11
+// on libstdc++ and rounded up: a per-atom object costs about 120 bytes per member and
+// a json array 32 bytes per element including growth; serialized msgpack takes about
+// 12 bytes per member key and 9 per value; a delta encoder slot about 40 bytes.
+constexpr std::size_t JsonBytesPerMember = 120;
+constexpr std::size_t JsonBytesPerElement = 32;
+constexpr std::size_t MsgpackBytesPerMember = 12;
+constexpr std::size_t MsgpackBytesPerValue = 9;
+constexpr std::size_t DeltaSlotBytes = 40;
+// Octree output: point, Morton code and sort order per atom, at most one leaf each.
+constexpr std::size_t OctreeBytesPerAtom = 3 * sizeof(double) + 2 * sizeof(std::uint64_t) + sizeof(Octree::Node);
+// Characters of a formatted dump value.
+constexpr std::size_t DumpBytesPerValue = 20;
+// Number density assumed for a cell without volume, slightly above close-packed metals
+// in atoms per cubic Angstrom.
+constexpr double FallbackNumberDensity = 0.1;
+constexpr std::size_t BaseMemoryBytes = 16u << 20;
+
+double cellVolume(const SimulationCell& cell){
+    const AffineTransformation& m = cell.matrix();
+    return std::abs(
+        m(0, 0) * (m(1, 1) * m(2, 2) - m(1, 2) * m(2, 1)) -
+        m(0, 1) * (m(1, 0) * m(2, 2) - m(1, 2) * m(2, 0)) +
+        m(0, 2) * (m(1, 0) * m(2, 1) - m(1, 1) * m(2, 0))
+    );
+}
+
+json encodeValue(double value, const AtomicStrainEncodingOptions& options){
+    switch(options.encoding){
+        case AtomicStrainEncoding::Float32:
+            // nlohmann's msgpack writer emits float32 for values that round-trip exactly.
+            return static_cast<double>(static_cast<float>(value));
+        case AtomicStrainEncoding::Quantized:
+            return static_cast<std::int64_t>(std::llround(value / options.quantizationStep()));
+        case AtomicStrainEncoding::Float64:
+            break;
+    }
+    return value;
+}
+
+}
+
 AtomicStrainService::AtomicStrainService()
     : _cutoff(0.10),
       _eliminateCellDeformation(false),
@@ -16,7 +85,21 @@ AtomicStrainService::AtomicStrainService()
       _calculateDeformationGradient(true),
       _calculateStrainTensors(true),
       _calculateD2min(true),
-      _hasReference(false){}
+      _outputFields(AtomicStrainField::All),
+      _summaryOnly(false),
+      _sortByIdentifier(false),
+      _spatialOrder(false),
+      _spatialBlockSize(SpatialIndex::DefaultBlockSize),
+      _outputFormat(AtomicStrainOutputFormat::Msgpack),
+      _columnChecksums(false),
+      _directIo(false),
+      _shards(1),
+      _octreeDepth(0),
+      _deltaEncoder(10, 1e-4),
+      _hasReference(false),
+      _referenceCacheLimit(0),
+      _retainPreparedReference(false),
+      _parallelAtomThreshold(AtomicStrainModifier::AtomicStrainEngine::ParallelAtomThreshold){}
 
 
 void AtomicStrainService::setCutoff(double cutoff){
@@ -24,8 +107,61 @@ void AtomicStrainService::setCutoff(double cutoff){
 }
 
 void AtomicStrainService::setReferenceFrame(const LammpsParser::Frame &ref){
-    _referenceFrame = ref;
+    setReferenceFrame(AtomicStrainFrame::fromLammpsFrame(ref));
+}
+
+void AtomicStrainService::setReferenceFrame(AtomicStrainFrame ref){
+    _referenceFrame = std::move(ref);
     _hasReference = true;
+    _referenceContentHash.reset();
+    _preparedReference.reset();
+}
+
+void AtomicStrainService::setReferenceCache(std::string directory, std::uint64_t maxBytes){
+    _referenceCacheDirectory = std::move(directory);
+    _referenceCacheLimit = maxBytes;
+    _preparedReference.reset();
+}
+
+void AtomicStrainService::setRetainPreparedReference(bool retain){
+    _retainPreparedReference = retain;
+}
+
+std::shared_ptr<const AtomicStrainPreparedReference> AtomicStrainService::preparedReference(const AtomicStrainFrame& currentFrame){
+    if(!_hasReference || (_referenceCacheDirectory.empty() && !_retainPreparedReference)) return nullptr;
+    std::lock_guard<std::mutex> lock(_preparedReferenceMutex);
+
+    // The engine takes the periodicity of the current cell for the reference too.
+    SimulationCell refCell = _referenceFrame.simulationCell;
+    refCell.setPbcFlags(currentFrame.simulationCell.pbcFlags());
+
+    if(!_referenceContentHash){
+        _referenceContentHash = AtomicStrainPreparedReference::contentHash(
+            *_referenceFrame.positions, _referenceFrame.identifiers.get(), _referenceFrame.simulationCell);
+    }
+    const std::uint64_t key = AtomicStrainPreparedReference::key(*_referenceContentHash, _cutoff, refCell.pbcFlags());
+    if(!_preparedReference || _preparedReference->key() != key){
+        // A reference that cannot be prepared (duplicate identifiers, no neighbor
+        // lists) is left to the engine, which reports or skips it as it always has.
+        try{
+            _preparedReference = _referenceCacheDirectory.empty()
+                ? AtomicStrainPreparedReference::build(
+                    _referenceFrame.positions.get(), _referenceFrame.identifiers.get(), refCell, _cutoff, key)
+                : AtomicStrainPreparedReference::loadOrBuild(
+                    _referenceCacheDirectory,
+                    _referenceFrame.positions.get(),
+                    _referenceFrame.identifiers.get(),
+                    refCell,
+                    _cutoff,
+                    key,
+                    _referenceCacheLimit
+                );
+        }catch(const std::runtime_error& e){
+            spdlog::warn("Reference not prepared: {}", e.what());
+            _preparedReference.reset();
+        }
+    }
+    return _preparedReference;
 }
 
 void AtomicStrainService::setOptions(
@@ -42,36 +178,243 @@ void AtomicStrainService::setOptions(
     _calculateD2min = calculateD2min;
 }
 
+void AtomicStrainService::setOutputFields(AtomicStrainField fields){
+    _outputFields = fields;
+}
+
+void AtomicStrainService::setSummaryOnly(bool summaryOnly){
+    _summaryOnly = summaryOnly;
+}
+
+void AtomicStrainService::setSelection(const AtomicStrainSelection& selection){
+    _selection = selection;
+}
+
+void AtomicStrainService::setSortByIdentifier(bool sortByIdentifier){
+    _sortByIdentifier = sortByIdentifier;
+}
+
+void AtomicStrainService::setSpatialOrder(bool enabled, std::size_t blockSize){
+    if(enabled && blockSize == 0){
+        throw std::invalid_argument("Spatial index block size must be positive.");
+    }
+    _spatialOrder = enabled;
+    _spatialBlockSize = blockSize;
+}
+
+void AtomicStrainService::setEncoding(const AtomicStrainEncodingOptions& encoding){
+    if(encoding.encoding == AtomicStrainEncoding::Quantized && !(encoding.errorBound > 0.0)){
+        throw std::invalid_argument("Quantized encoding requires a positive error bound.");
+    }
+    _encoding = encoding;
+}
+
+void AtomicStrainService::setOutputFormat(AtomicStrainOutputFormat format){
+    _outputFormat = format;
+}
+
+void AtomicStrainService::setColumnChecksums(bool checksums){
+    _columnChecksums = checksums;
+}
+
+void AtomicStrainService::setDirectIo(bool directIo){
+    _directIo = directIo;
+}
+
+void AtomicStrainService::setShards(std::size_t shards){
+    _shards = std::max<std::size_t>(1, shards);
+}
+
+void AtomicStrainService::setOctreeDepth(unsigned depth){
+    _octreeDepth = depth;
+}
+
+void AtomicStrainService::setDeltaOptions(std::size_t keyframeInterval, double tolerance){
+    _deltaEncoder = AtomicStrainDeltaEncoder(keyframeInterval, tolerance);
+}
+
+void AtomicStrainService::setAsyncOutput(bool enabled, std::size_t queueDepth){
+    _asyncWriter.reset();
+    if(enabled){
+        _asyncWriter = std::make_unique<AtomicStrainAsyncWriter>(queueDepth);
+    }
+}
+
+void AtomicStrainService::waitForPendingWrites(){
+    if(_asyncWriter) _asyncWriter->wait();
+}
+
+std::size_t AtomicStrainService::estimateMemory(std::size_t numAtoms, const SimulationCell& cell) const{
+    const double volume = cellVolume(cell);
+    const double density = volume > 0.0 && numAtoms > 0 ? static_cast<double>(numAtoms) / volume : FallbackNumberDensity;
+    const double cutoffCube = _cutoff * _cutoff * _cutoff;
+    const auto neighborsPerAtom = static_cast<std::size_t>(std::ceil(density * 4.0 / 3.0 * std::numbers::pi * cutoffCube));
+    const std::size_t numBins = volume > 0.0 && cutoffCube > 0.0
+        ? std::min(numAtoms, static_cast<std::size_t>(volume / cutoffCube) + 1)
+        : numAtoms;
+
+    // Both frames, the index maps and identifier orders of both, and the neighbor
+    // finder on the reference. A prepared reference is built with the finder and then
+    // kept, with every neighbor and its r0 vector.
+    std::size_t perAtom = 2 * FrameBytesPerAtom + 2 * sizeof(int) + 2 * sizeof(std::size_t) + NeighborFinderBytesPerAtom;
+    std::size_t fixed = BaseMemoryBytes + numBins * NeighborFinderBytesPerBin;
+    if(!_referenceCacheDirectory.empty() || _retainPreparedReference){
+        perAtom += PreparedBytesPerAtom + neighborsPerAtom * PreparedBytesPerNeighbor;
+    }
+
+    // Result buffers of one frame, which every queued asynchronous write keeps alive
+    // together with its current frame.
+    std::size_t resultPerAtom = 0;
+    // Output built from a result while it is written.
+    std::size_t outputPerAtom = 0;
+    if(!_summaryOnly){
+        const AtomicStrainField fields = _outputFields;
+        const bool strain = _calculateStrainTensors && hasField(fields, AtomicStrainField::StrainTensor);
+        const bool defgrad = _calculateDeformationGradient && hasField(fields, AtomicStrainField::DeformationGradient);
+        std::size_t scalars = 0;
+        if(hasField(fields, AtomicStrainField::ShearStrain) || _selection.enabled()) scalars += 1;
+        if(hasField(fields, AtomicStrainField::VolumetricStrain)) scalars += 1;
+        if(_calculateD2min && hasField(fields, AtomicStrainField::D2min)) scalars += 1;
+        const bool invalid = hasField(fields, AtomicStrainField::Invalid);
+        const std::size_t values = scalars + (strain ? 6 : 0) + (defgrad ? 9 : 0);
+        resultPerAtom += values * sizeof(double) + (invalid ? sizeof(int) : 0);
+
+        // Selected or reordered rows; sorting and Morton ordering need a second array.
+        if(_selection.enabled() || _spatialOrder || _sortByIdentifier){
+            resultPerAtom += 2 * sizeof(std::size_t);
+        }
+
+        const std::size_t members = 1 + scalars + (strain ? 1 : 0) + (defgrad ? 1 : 0) + (invalid ? 1 : 0);
+        switch(_outputFormat){
+            case AtomicStrainOutputFormat::Msgpack:
+                // One json object per atom, then its serialized bytes.
+                outputPerAtom += members * JsonBytesPerMember + (values - scalars) * JsonBytesPerElement;
+                outputPerAtom += members * MsgpackBytesPerMember + (values + 1) * MsgpackBytesPerValue;
+                break;
+            case AtomicStrainOutputFormat::Delta:
+                // Encoder state kept between frames, the values gathered per frame and
+                // the record of ids and values that travels with the result.
+                perAtom += values * sizeof(double) + DeltaSlotBytes;
+                outputPerAtom += values * sizeof(double) + sizeof(int) + 2;
+                resultPerAtom += (values + 1) * (JsonBytesPerElement + MsgpackBytesPerValue);
+                break;
+            case AtomicStrainOutputFormat::Octree:
+                outputPerAtom += OctreeBytesPerAtom;
+                break;
+            case AtomicStrainOutputFormat::Columnar:
+                // Morton codes read back for the spatial index.
+                if(_spatialOrder) outputPerAtom += sizeof(std::uint64_t);
+                break;
+            default:
+                break;
+        }
+
+        // The buffer of every file written at once, and the formatted dump chunks in flight.
+        const std::size_t files = _shards > 1 ? _shards : 1;
+        if(_outputFormat == AtomicStrainOutputFormat::LammpsDump){
+            const std::size_t chunks = dumpWriterChunksInFlight();
+            fixed += files * (DumpWriterBufferSize + chunks * DumpWriterChunkRows * (values + 5) * DumpBytesPerValue);
+        }else if(_outputFormat != AtomicStrainOutputFormat::Msgpack){
+            fixed += files * BufferedFileWriter::DefaultBufferSize;
+        }
+    }
+
+    const std::size_t pendingResults = _asyncWriter ? _asyncWriter->maxPendingJobs() + 1 : 0;
+    return fixed + numAtoms * (
+        perAtom + resultPerAtom + outputPerAtom + pendingResults * (resultPerAtom + FrameBytesPerAtom)
+    );
+}
+
 json AtomicStrainService::compute(const LammpsParser::Frame& currentFrame, const std::string &outputFilename){
-    const LammpsParser::Frame &refFrame = _hasReference ? _referenceFrame : currentFrame;
+    return compute(AtomicStrainFrame::fromLammpsFrame(currentFrame), outputFilename);
+}
+
+json AtomicStrainService::compute(const AtomicStrainFrame& currentFrame, const std::string &outputFilename){
+    const AtomicStrainFrame &refFrame = _hasReference ? _referenceFrame : currentFrame;
 
-    auto positions = FrameAdapter::createPositionPropertyShared(currentFrame);
-    if(!positions){
+    if(!currentFrame.positions || !refFrame.positions){
         return AnalysisResult::failure("Failed to create position property");
     }
 
-    json result = computeAtomicStrain(currentFrame, refFrame, positions.get(), outputFilename);
+    json result = computeAtomicStrain(currentFrame, refFrame, outputFilename);
     result["is_failed"] = false;
     return result;
 }
 
+void AtomicStrainService::setParallelAtomThreshold(std::size_t atoms){
+    _parallelAtomThreshold = atoms;
+}
+
+std::vector<json> AtomicStrainService::computeBatch(
+    std::span<const AtomicStrainFrame> frames,
+    std::span<const std::string> outputFilenames
+){
+    if(frames.size() != outputFilenames.size()){
+        throw std::invalid_argument("computeBatch needs one output filename per frame");
+    }
+
+    std::vector<json> results(frames.size());
+    // Asynchronous writes are submitted in frame order after the loop; submitting from
+    // a task would park a worker thread while the queue is full.
+    std::vector<std::function<void()>> writes(frames.size());
+    const auto computeOne = [this, &frames, &outputFilenames, &results, &writes](std::size_t i, bool serialKernel){
+        const AtomicStrainFrame& currentFrame = frames[i];
+        const AtomicStrainFrame& refFrame = _hasReference ? _referenceFrame : currentFrame;
+        if(!currentFrame.positions || !refFrame.positions){
+            results[i] = AnalysisResult::failure("Failed to create position property");
+            return;
+        }
+        try{
+            results[i] = computeAtomicStrain(currentFrame, refFrame, outputFilenames[i], serialKernel, &writes[i]);
+            results[i]["is_failed"] = false;
+        }catch(const std::exception& e){
+            results[i] = AnalysisResult::failure(e.what());
+        }
+    };
+
+    std::vector<std::size_t> small;
+    const bool ordered = !_summaryOnly && _outputFormat == AtomicStrainOutputFormat::Delta;
+    for(std::size_t i = 0; i < frames.size(); ++i){
+        if(!ordered && frames[i].natoms < _parallelAtomThreshold){
+            small.push_back(i);
+        }else{
+            computeOne(i, false);
+        }
+    }
+
+    tbb::parallel_for(tbb::blocked_range<std::size_t>(0, small.size(), 1), [&small, &computeOne](const tbb::blocked_range<std::size_t>& r){
+        for(std::size_t k = r.begin(); k < r.end(); ++k){
+            computeOne(small[k], true);
+        }
+    });
+    for(std::function<void()>& write : writes){
+        if(write) _asyncWriter->submit(std::move(write));
+    }
+    return results;
+}
+
 json AtomicStrainService::computeAtomicStrain(
-    const LammpsParser::Frame& currentFrame,
-    const LammpsParser::Frame& refFrame,
-    ParticleProperty* positions,
-    const std::string& outputFilename
+    const AtomicStrainFrame& currentFrame,
+    const AtomicStrainFrame& refFrame,
+    const std::string& outputFilename,
+    bool serialKernel,
+    std::function<void()>* deferredWrite
 ){
     if(currentFrame.natoms != refFrame.natoms){
         throw std::runtime_error("Cannot calculate atomic strain. Number of atoms in current and reference frames does not match.");
     }
 
-    auto refPositions = FrameAdapter::createPositionPropertyShared(refFrame);
+    const auto& positions = currentFrame.positions;
+    const auto& refPositions = refFrame.positions;
+    const auto& identifiers = currentFrame.identifiers;
+    const auto& refIdentifiers = refFrame.identifiers;
 
-    auto identifiers = FrameAdapter::createIdentifierProperty(currentFrame);
-    auto refIdentifiers = FrameAdapter::createIdentifierProperty(refFrame);
+    const AtomicStrainField fields = _summaryOnly ? AtomicStrainField::None : _outputFields;
+    const bool useSelection = !_summaryOnly && _selection.enabled();
+    const bool needsShear = !_summaryOnly && _outputFormat == AtomicStrainOutputFormat::Octree;
 
     AtomicStrainModifier::AtomicStrainEngine engine(
-        positions,
+        positions.get(),
         currentFrame.simulationCell,
         refPositions.get(),
         refFrame.simulationCell,
@@ -80,52 +423,166 @@ json AtomicStrainService::computeAtomicStrain(
         _cutoff,
         _eliminateCellDeformation,
         _assumeUnwrappedCoordinates,
-        _calculateDeformationGradient,
-        _calculateStrainTensors,
-        _calculateD2min
+        _calculateDeformationGradient && hasField(fields, AtomicStrainField::DeformationGradient),
+        _calculateStrainTensors && hasField(fields, AtomicStrainField::StrainTensor),
+        (_calculateD2min && hasField(fields, AtomicStrainField::D2min)) || (useSelection && _selection.needsD2min())
+    );
+    engine.setOutputProperties(
+        hasField(fields, AtomicStrainField::ShearStrain) || needsShear || (useSelection && _selection.needsShearStrains()),
+        hasField(fields, AtomicStrainField::VolumetricStrain),
+        hasField(fields, AtomicStrainField::Invalid)
     );
 
+    if(&refFrame == &_referenceFrame){
+        engine.setPreparedReference(preparedReference(currentFrame));
+    }
+    engine.setSerial(serialKernel);
     engine.perform();
 
-    auto shear = engine.shearStrains();
-    auto volumetric = engine.volumetricStrains();
-    auto strainProp = engine.strainTensors();
-    auto defgrad = engine.deformationGradients();
-    auto D2minProp = engine.nonaffineSquaredDisplacements();
-    auto invalid = engine.invalidParticles();
-
-    size_t n = currentFrame.positions.size();
+    AtomicStrainResult result;
+    result.timestep = currentFrame.timestep;
+    result.cell = currentFrame.simulationCell;
+    result.identifiers = identifiers;
+    result.positions = positions;
+    result.refCell = refFrame.simulationCell;
+    result.refPositions = refPositions;
+    result.referenceIndices = engine.currentToReferenceIndices();
+    result.shearStrains = engine.shearStrains();
+    result.volumetricStrains = engine.volumetricStrains();
+    result.strainTensors = engine.strainTensors();
+    result.deformationGradients = engine.deformationGradients();
+    result.nonaffineSquaredDisplacements = engine.nonaffineSquaredDisplacements();
+    result.invalidParticles = engine.invalidParticles();
 
-    double totalShear = 0.0;
-    double totalVolumetric = 0.0;
-    double maxShear = 0.0;
-    int count = 0;
-
-    for(size_t i = 0; i < n; i++){
-        if(shear){
-            double s = shear->getDouble(i);
-            totalShear += s;
-            if(s > maxShear) maxShear = s;
-        }
-        if(volumetric) totalVolumetric += volumetric->getDouble(i);
-        count++;
-    }
+    const std::size_t n = result.numAtoms();
 
     json root;
     root["main_listing"] = {
         { "cutoff", _cutoff },
         { "num_invalid_particles", engine.numInvalidParticles() },
-        { "average_shear_strain", count > 0 ? totalShear / count : 0.0 },
-        { "average_volumetric_strain", count > 0 ? totalVolumetric / count : 0.0 },
-        { "max_shear_strain", maxShear }
+        { "average_shear_strain", n > 0 ? engine.totalShearStrain() / n : 0.0 },
+        { "average_volumetric_strain", n > 0 ? engine.totalVolumetricStrain() / n : 0.0 },
+        { "max_shear_strain", engine.maxShearStrain() }
     };
 
+    if(!_summaryOnly){
+        root["main_listing"]["fields"] = atomicStrainFieldsToString(fields);
+        root["main_listing"]["encoding"] = {
+            { "type", atomicStrainEncodingName(_encoding.encoding) }
+        };
+        if(_encoding.encoding == AtomicStrainEncoding::Quantized){
+            root["main_listing"]["encoding"]["step"] = _encoding.quantizationStep();
+            root["main_listing"]["encoding"]["error_bound"] = _encoding.errorBound;
+        }
+
+        if(useSelection){
+            result.rows = std::make_shared<const std::vector<std::size_t>>(
+                selectAtoms(_selection, result.shearStrains.get(), result.nonaffineSquaredDisplacements.get(), serialKernel));
+            root["main_listing"]["num_selected_atoms"] = result.rows->size();
+        }
+
+        if(_spatialOrder){
+            result.rows = mortonRowOrder(result, serialKernel);
+            root["main_listing"]["spatial_order"] = "morton";
+        }else if(_sortByIdentifier){
+            if(result.rows && result.identifiers){
+                auto sorted = std::make_shared<std::vector<std::size_t>>(*result.rows);
+                const auto& ids = result.identifiers;
+                const auto byIdentifier = [&ids](std::size_t a, std::size_t b){
+                    return ids->getInt(a) < ids->getInt(b);
+                };
+                parallelSort(sorted->begin(), sorted->end(), serialKernel, byIdentifier);
+                result.rows = std::move(sorted);
+            }else if(!result.rows){
+                result.rows = engine.identifierOrder();
+            }
+            root["main_listing"]["sorted_by_identifier"] = true;
+        }
+    }
+
+    AtomicStrainOutputOptions settings;
+    settings.fields = fields;
+    settings.encoding = _encoding;
+    settings.format = _outputFormat;
+    settings.columnChecksums = _columnChecksums;
+    settings.summaryOnly = _summaryOnly;
+    settings.writeMode = _directIo ? FileWriteMode::Direct : FileWriteMode::Buffered;
+    settings.shards = _shards;
+    settings.octreeDepth = _octreeDepth;
+    settings.spatialBlockSize = _spatialOrder ? _spatialBlockSize : 0;
+    settings.serial = serialKernel;
+    const bool perAtomJson = !_summaryOnly && _outputFormat == AtomicStrainOutputFormat::Msgpack;
+
+    // Delta records depend on the previous frame, so they are encoded in call order here.
+    json deltaRecord;
+    if(!_summaryOnly && _outputFormat == AtomicStrainOutputFormat::Delta){
+        deltaRecord = _deltaEncoder.encode(result, fields, _encoding);
+        root["main_listing"]["delta_keyframe"] = deltaRecord["keyframe"];
+        root["main_listing"]["delta_num_changed"] = deltaRecord["ids"].size();
+    }
+
+    if(_asyncWriter && !outputFilename.empty()){
+        json summary = root;
+        if(!deltaRecord.is_null()) root["per-atom-delta"] = std::move(deltaRecord);
+        std::function<void()> write = [root = std::move(root), result = std::move(result), settings, perAtomJson, outputFilename]() mutable{
+            if(perAtomJson) appendPerAtomProperties(root, result, settings);
+            writeResult(root, result, settings, outputFilename);
+        };
+        if(deferredWrite){
+            *deferredWrite = std::move(write);
+        }else{
+            _asyncWriter->submit(std::move(write));
+        }
+        return summary;
+    }
+
+    if(perAtomJson){
+        appendPerAtomProperties(root, result, settings);
+    }
+    if(!deltaRecord.is_null()){
+        root["per-atom-delta"] = std::move(deltaRecord);
+    }
+
+    if(!outputFilename.empty()){
+        writeResult(root, result, settings, outputFilename);
+    }
+
+    return root;
+}
+
+void AtomicStrainService::appendPerAtomProperties(
+    json& root,
+    const AtomicStrainResult& result,
+    const AtomicStrainOutputOptions& settings
+){
+    const AtomicStrainField fields = settings.fields;
+    const auto& shear = result.shearStrains;
+    const auto& volumetric = result.volumetricStrains;
+    const auto& strainProp = result.strainTensors;
+    const auto& defgrad = result.deformationGradients;
+    const auto& D2minProp = result.nonaffineSquaredDisplacements;
+    const auto& invalid = result.invalidParticles;
+
+    const bool packInvalid = settings.encoding.invalidBitmask && hasField(fields, AtomicStrainField::Invalid);
+    const auto enc = [&settings](double value){ return encodeValue(value, settings.encoding); };
+    const std::size_t numRows = result.numRows();
+
+    json::binary_t invalidBitmask;
+    if(packInvalid){
+        invalidBitmask.resize((numRows + 7) / 8, 0);
+    }
+
     json perAtom = json::array();
-    for(std::size_t i = 0; i < n; i++){
+    for(std::size_t row = 0; row < numRows; row++){
+        const std::size_t i = result.atomIndex(row);
         json a;
-        a["id"] = currentFrame.ids[i];
-        a["shear_strain"] = shear ? shear->getDouble(i) : 0.0;
-        a["volumetric_strain"] = volumetric ? volumetric->getDouble(i) : 0.0;
+        a["id"] = result.identifier(i);
+        if(hasField(fields, AtomicStrainField::ShearStrain)){
+            a["shear_strain"] = enc(shear ? shear->getDouble(i) : 0.0);
+        }
+        if(hasField(fields, AtomicStrainField::VolumetricStrain)){
+            a["volumetric_strain"] = enc(volumetric ? volumetric->getDouble(i) : 0.0);
+        }
 
         if(strainProp){
             double xx = strainProp->getDoubleComponent(i, 0);
@@ -134,7 +591,7 @@ json AtomicStrainService::computeAtomicStrain(
             double yz = strainProp->getDoubleComponent(i, 3);
             double xz = strainProp->getDoubleComponent(i, 4);
             double xy = strainProp->getDoubleComponent(i, 5);
-            a["strain_tensor"] = { xx, yy, zz, xy, xz, yz };
+            a["strain_tensor"] = { enc(xx), enc(yy), enc(zz), enc(xy), enc(xz), enc(yz) };
         }
 
         if(defgrad){
@@ -147,32 +604,82 @@ json AtomicStrainService::computeAtomicStrain(
             double xz = defgrad->getDoubleComponent(i, 6);
             double yz = defgrad->getDoubleComponent(i, 7);
             double zz = defgrad->getDoubleComponent(i, 8);
-            a["deformation_gradient"] = { xx, yx, zx, xy, yy, zy, xz, yz, zz };
+            a["deformation_gradient"] = {
+                enc(xx), enc(yx), enc(zx), enc(xy), enc(yy), enc(zy), enc(xz), enc(yz), enc(zz)
+            };
         }
 
-        if(D2minProp){
-            a["D2min"] = D2minProp->getDouble(i);
-        } else {
-            a["D2min"] = nullptr;
+        if(hasField(fields, AtomicStrainField::D2min)){
+            if(D2minProp){
+                a["D2min"] = enc(D2minProp->getDouble(i));
+            } else {
+                a["D2min"] = nullptr;
+            }
+        }
+        if(packInvalid){
+            if(invalid && invalid->getInt(i) != 0){
+                invalidBitmask[row / 8] |= static_cast<std::uint8_t>(1u << (row % 8));
+            }
+        }else if(hasField(fields, AtomicStrainField::Invalid)){
+            a["invalid"] = invalid ? (invalid->getInt(i) != 0) : false;
         }
-        a["invalid"] = invalid ? (invalid->getInt(i) != 0) : false;
 
         perAtom.push_back(a);
     }
 
     root["per-atom-properties"] = perAtom;
+    if(packInvalid){
+        // Bit k (LSB first) corresponds to the k-th entry of "per-atom-properties".
+        root["invalid_bitmask"] = json::binary(std::move(invalidBitmask));
+    }
+}
 
-    if(!outputFilename.empty()){
-        const std::string outputPath = outputFilename + "_atomic_strain.msgpack";
-        if(JsonUtils::writeJsonMsgpackToFile(root, outputPath, false)){
-            spdlog::info("Atomic strain msgpack written to {}", outputPath);
+void AtomicStrainService::writeResult(
+    const json& root,
+    const AtomicStrainResult& result,
+    const AtomicStrainOutputOptions& settings,
+    const std::string& outputFilename
+){
+    bool ok = true;
+    const auto report = [&ok](bool written, std::string_view what, const std::string& path){
+        if(written){
+            spdlog::info("Atomic strain {} written to {}", what, path);
         }else{
-            spdlog::warn("Could not write atomic strain msgpack: {}", outputPath);
+            spdlog::warn("Could not write atomic strain {}: {}", what, path);
+            ok = false;
+        }
+    };
+
+    const std::string outputPath = outputFilename + "_atomic_strain.msgpack";
+    report(JsonUtils::writeJsonMsgpackToFile(root, outputPath, false), "msgpack", outputPath);
+
+    if(!settings.summaryOnly){
+        const bool shardable = settings.format == AtomicStrainOutputFormat::Columnar ||
+            settings.format == AtomicStrainOutputFormat::LammpsDump;
+        if(settings.shards > 1 && shardable){
+            const std::string manifestPath = outputFilename + "_atomic_strain.manifest.json";
+            report(writeShardedResult(result, settings, outputFilename + "_atomic_strain"), "shard manifest", manifestPath);
+        }else if(settings.format == AtomicStrainOutputFormat::Columnar){
+            const std::string columnarPath = outputFilename + "_atomic_strain.vcol";
+            const bool written = writeColumnarResult(result, settings.fields, settings.encoding, settings.columnChecksums, columnarPath, settings.writeMode);
+            report(written, "columns", columnarPath);
+            // The index addresses byte ranges of the columnar file, so it is written after it.
+            if(written && settings.spatialBlockSize > 0){
+                const std::string indexPath = outputFilename + "_atomic_strain.vmix";
+                report(writeSpatialIndex(result, mortonGrid(result, settings.serial), settings.spatialBlockSize, columnarPath, indexPath, settings.serial), "spatial index", indexPath);
+            }
+        }else if(settings.format == AtomicStrainOutputFormat::LammpsDump){
+            const std::string dumpPath = outputFilename + "_atomic_strain.dump";
+            report(writeLammpsDumpResult(result, settings.fields, settings.encoding, dumpPath, settings.writeMode, settings.serial), "dump", dumpPath);
+        }else if(settings.format == AtomicStrainOutputFormat::Octree){
+            const std::string octreePath = outputFilename + "_atomic_strain.voct";
+            report(writeOctreeResult(result, settings.octreeDepth, octreePath, settings.writeMode, settings.serial), "octree", octreePath);
         }
     }
 
-    return root;
+    if(!ok){
+        throw std::runtime_error("Could not write atomic strain output: " + outputFilename);
+    }
 }
 
-
 }
@@ -0,0 +1,127 @@
+#include <volt/atomic_strain_sharded_writer.h>
+#include <volt/atomic_strain_columnar_writer.h>
+#include <volt/atomic_strain_dump_writer.h>
+#include <volt/atomic_strain_spatial_index.h>
+#include <volt/atomic_strain_parallel.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <vector>
+#include <nlohmann/json.hpp>
+#include <spdlog/spdlog.h>
+#include <tbb/blocked_range.h>
+
+namespace Volt{
+
+namespace{
+
+struct Shard{
+    std::string path;
+    std::string indexPath;
+    std::size_t rowBegin;
+    std::size_t rowEnd;
+    bool ok = false;
+};
+
+}
+
+bool writeShardedResult(
+    const AtomicStrainResult& result,
+    const AtomicStrainOutputOptions& options,
+    const std::string& prefix
+){
+    const bool columnar = options.format == AtomicStrainOutputFormat::Columnar;
+    if(!columnar && options.format != AtomicStrainOutputFormat::LammpsDump) return false;
+
+    const std::size_t numRows = result.numRows();
+    const std::size_t numShards = std::max<std::size_t>(1, std::min(options.shards, std::max<std::size_t>(numRows, 1)));
+    const std::string extension = columnar ? ".vcol" : ".dump";
+
+    std::vector<Shard> shards(numShards);
+    for(std::size_t k = 0; k < numShards; ++k){
+        shards[k].path = prefix + ".shard" + std::to_string(k) + extension;
+        shards[k].rowBegin = numRows * k / numShards;
+        shards[k].rowEnd = numRows * (k + 1) / numShards;
+    }
+
+    // Columnar shards get their own spatial index over shard-local rows, all on the
+    // grid the rows were sorted with.
+    const bool indexed = columnar && options.spatialBlockSize > 0;
+    Morton::Grid grid{};
+    if(indexed){
+        grid = mortonGrid(result, options.serial);
+        for(std::size_t k = 0; k < numShards; ++k){
+            shards[k].indexPath = prefix + ".shard" + std::to_string(k) + ".vmix";
+        }
+    }
+
+    // Shards run as tasks of the calling arena, so at most one shard per worker thread
+    // (and its write buffer, sized to the shard) is in flight.
+    parallelFor(tbb::blocked_range<std::size_t>(0, numShards, 1), options.serial, [&](const tbb::blocked_range<std::size_t>& range){
+        for(std::size_t k = range.begin(); k < range.end(); ++k){
+            Shard& shard = shards[k];
+            const AtomicStrainResult view = result.slice(shard.rowBegin, shard.rowEnd - shard.rowBegin);
+            shard.ok = columnar
+                ? writeColumnarResult(view, options.fields, options.encoding, options.columnChecksums, shard.path, options.writeMode)
+                : writeLammpsDumpResult(view, options.fields, options.encoding, shard.path, options.writeMode, options.serial);
+            if(shard.ok && indexed){
+                shard.ok = writeSpatialIndex(view, grid, options.spatialBlockSize, shard.path, shard.indexPath, options.serial);
+            }
+        }
+    });
+
+    // The manifest is only published over a complete set of shards. Without it the
+    // written shards are unreachable, and a manifest of an earlier run would list
+    // the shards just removed.
+    const std::string manifestPath = prefix + ".manifest.json";
+    const bool ok = std::all_of(shards.begin(), shards.end(), [](const Shard& shard){ return shard.ok; });
+    if(!ok){
+        for(const Shard& shard : shards){
+            std::remove(shard.path.c_str());
+            if(indexed) std::remove(shard.indexPath.c_str());
+        }
+        std::remove(manifestPath.c_str());
+        spdlog::warn("Removed the shards of {} after a shard failed", manifestPath);
+        return false;
+    }
+
+    nlohmann::json manifest;
+    manifest["format"] = columnar ? "columnar" : "dump";
+    manifest["num_rows"] = numRows;
+    manifest["shards"] = nlohmann::json::array();
+    for(const Shard& shard : shards){
+        nlohmann::json entry = {
+            { "path", std::filesystem::path(shard.path).filename().string() },
+            { "row_begin", shard.rowBegin },
+            { "row_end", shard.rowEnd }
+        };
+        if(indexed){
+            entry["index"] = std::filesystem::path(shard.indexPath).filename().string();
+        }
+        manifest["shards"].push_back(std::move(entry));
+    }
+
+    // Written under a temporary name and renamed, so readers never see a partial manifest.
+    const std::string tempPath = manifestPath + ".tmp";
+    {
+        std::ofstream out(tempPath, std::ios::trunc);
+        out << manifest.dump(2) << '\n';
+        out.flush();
+        out.close();
+        if(!out){
+            spdlog::warn("Failed to write shard manifest: {}", manifestPath);
+            std::remove(tempPath.c_str());
+            return false;
+        }
+    }
+    if(std::rename(tempPath.c_str(), manifestPath.c_str()) != 0){
+        spdlog::warn("Failed to write shard manifest: {}", manifestPath);
+        std::remove(tempPath.c_str());
+        return false;
+    }
+    return true;
+}
+
+}
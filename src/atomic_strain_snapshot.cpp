@@ -0,0 +1,202 @@
+#include <volt/atomic_strain_snapshot.h>
+#include <volt/atomic_strain_file_writer.h>
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <vector>
+#include <spdlog/spdlog.h>
+#include <tbb/parallel_for.h>
+#include <tbb/blocked_range.h>
+
+namespace Volt{
+
+using namespace Volt::Particles;
+
+namespace{
+
+constexpr std::size_t CopyGrainBytes = 1u << 20;
+
+void parallelCopy(void* destination, const char* source, std::size_t size){
+    char* out = static_cast<char*>(destination);
+    tbb::parallel_for(tbb::blocked_range<std::size_t>(0, size, CopyGrainBytes),
+        [&](const tbb::blocked_range<std::size_t>& r){
+            std::memcpy(out + r.begin(), source + r.begin(), r.size());
+        });
+}
+
+bool readSnapshotHeader(const std::string& path, Snapshot::FileHeader& header){
+    std::ifstream in(path, std::ios::binary);
+    if(!in) return false;
+    in.read(reinterpret_cast<char*>(&header), sizeof(header));
+    return in && std::memcmp(header.magic, Snapshot::Magic, sizeof(header.magic)) == 0 && header.version == Snapshot::Version;
+}
+
+}
+
+bool writeSnapshot(const std::string& dumpPath, const std::string& snapshotPath, bool preferUnwrapped){
+    const DumpStamp stamp = stampDump(dumpPath);
+    auto reader = openDumpReader(dumpPath, preferUnwrapped);
+
+    // Renamed into place once complete, so a crashed conversion never leaves a
+    // snapshot that looks current.
+    const std::string tempPath = snapshotPath + ".tmp";
+    BufferedFileWriter writer;
+    if(!writer.open(tempPath)) return false;
+
+    Snapshot::FileHeader header{};
+    std::memcpy(header.magic, Snapshot::Magic, sizeof(header.magic));
+    header.version = Snapshot::Version;
+    header.dumpSize = stamp.size;
+    header.dumpModified = stamp.modified;
+    header.flags = preferUnwrapped ? Snapshot::PreferUnwrapped : 0u;
+    writer.write(&header, sizeof(header));
+
+    std::vector<Snapshot::FrameEntry> entries;
+    AtomicStrainFrame frame;
+    const auto readFrame = [&]{
+        try{
+            return reader->readFrame(frame);
+        }catch(...){
+            // A malformed dump must not leave the partial snapshot behind.
+            writer.close();
+            std::remove(tempPath.c_str());
+            throw;
+        }
+    };
+    while(readFrame()){
+        Snapshot::FrameEntry entry{};
+        entry.frame = makeFrameRecord(frame.timestep, frame.natoms, frame.simulationCell);
+
+        writer.writePadding(Snapshot::Alignment);
+        entry.positionsOffset = writer.offset();
+        writer.write(frame.positions->dataDouble(), frame.natoms * 3 * sizeof(double));
+        if(frame.identifiers){
+            writer.writePadding(Snapshot::Alignment);
+            entry.frame.flags |= Snapshot::HasIdentifiers;
+            entry.identifiersOffset = writer.offset();
+            writer.write(frame.identifiers->dataInt(), frame.natoms * sizeof(std::int32_t));
+        }
+        entries.push_back(entry);
+    }
+
+    writer.writePadding(alignof(Snapshot::FrameEntry));
+    header.numFrames = entries.size();
+    header.frameTableOffset = writer.offset();
+    writer.write(entries.data(), entries.size() * sizeof(Snapshot::FrameEntry));
+    writer.writeAt(0, &header, sizeof(header));
+
+    if(!writer.close() || std::rename(tempPath.c_str(), snapshotPath.c_str()) != 0){
+        spdlog::warn("Failed to write snapshot: {}", snapshotPath);
+        std::remove(tempPath.c_str());
+        return false;
+    }
+    return true;
+}
+
+std::string snapshotPathFor(const std::string& dumpPath){
+    return dumpPath + Snapshot::Extension;
+}
+
+std::optional<std::string> findSnapshot(const std::string& dumpPath, bool preferUnwrapped){
+    const std::string path = snapshotPathFor(dumpPath);
+    Snapshot::FileHeader header{};
+    if(!readSnapshotHeader(path, header)) return std::nullopt;
+    if(DumpStamp{ header.dumpSize, header.dumpModified } != stampDump(dumpPath)){
+        spdlog::info("Snapshot {} is out of date, reading {}", path, dumpPath);
+        return std::nullopt;
+    }
+    if(((header.flags & Snapshot::PreferUnwrapped) != 0) != preferUnwrapped){
+        spdlog::info("Snapshot {} was converted with other position columns, reading {}", path, dumpPath);
+        return std::nullopt;
+    }
+    return path;
+}
+
+bool isSnapshot(const std::string& path){
+    Snapshot::FileHeader header{};
+    return readSnapshotHeader(path, header);
+}
+
+AtomicStrainSnapshotReader::AtomicStrainSnapshotReader(const std::string& path)
+    : _path(path), _file(path, "snapshot"){
+    if(_file.size() < sizeof(Snapshot::FileHeader)) throw std::runtime_error("Snapshot is truncated: " + path);
+    validate();
+}
+
+void AtomicStrainSnapshotReader::validate() const{
+    const Snapshot::FileHeader& h = header();
+    if(std::memcmp(h.magic, Snapshot::Magic, sizeof(h.magic)) != 0 || h.version != Snapshot::Version){
+        throw std::runtime_error("Not an atomic strain snapshot: " + _path);
+    }
+    if(h.frameTableOffset % alignof(Snapshot::FrameEntry) != 0 ||
+       h.frameTableOffset > _file.size() ||
+       h.numFrames > (_file.size() - h.frameTableOffset) / sizeof(Snapshot::FrameEntry)){
+        throw std::runtime_error("Snapshot frame table is truncated: " + _path);
+    }
+    for(std::size_t i = 0; i < h.numFrames; ++i){
+        const Snapshot::FrameEntry& e = entry(i);
+        const std::uint64_t natoms = e.frame.natoms;
+        const bool identifiers = e.frame.flags & Snapshot::HasIdentifiers;
+        const bool fits = natoms <= _file.size() / (3 * sizeof(double)) &&
+            e.positionsOffset <= _file.size() && natoms * 3 * sizeof(double) <= _file.size() - e.positionsOffset &&
+            (!identifiers || (e.identifiersOffset <= _file.size() && natoms * sizeof(std::int32_t) <= _file.size() - e.identifiersOffset));
+        if(!fits || e.positionsOffset % Snapshot::Alignment != 0 || (identifiers && e.identifiersOffset % Snapshot::Alignment != 0)){
+            throw std::runtime_error("Snapshot frame is out of bounds: " + _path);
+        }
+    }
+}
+
+const Snapshot::FrameEntry& AtomicStrainSnapshotReader::entry(std::size_t frame) const{
+    return reinterpret_cast<const Snapshot::FrameEntry*>(_file.data() + header().frameTableOffset)[frame];
+}
+
+bool AtomicStrainSnapshotReader::readFrame(AtomicStrainFrame& frame){
+    if(_nextFrame >= header().numFrames) return false;
+    const Snapshot::FrameEntry& e = entry(_nextFrame);
+    const std::size_t natoms = static_cast<std::size_t>(e.frame.natoms);
+
+    AtomicStrainFrameInfo info;
+    skipFrame(info);
+
+    AtomicStrainFrame result;
+    result.timestep = info.timestep;
+    result.natoms = natoms;
+    result.simulationCell = info.simulationCell;
+
+    const std::size_t positionBytes = natoms * 3 * sizeof(double);
+    _file.willNeed(e.positionsOffset, positionBytes);
+    result.positions = std::make_shared<ParticleProperty>(natoms, DataType::Double, 3, 0, false);
+    parallelCopy(result.positions->dataDouble(), _file.data() + e.positionsOffset, positionBytes);
+
+    if(e.frame.flags & Snapshot::HasIdentifiers){
+        result.identifiers = std::make_shared<ParticleProperty>(natoms, DataType::Int, 1, 0, false);
+        parallelCopy(result.identifiers->dataInt(), _file.data() + e.identifiersOffset, natoms * sizeof(std::int32_t));
+    }
+
+    frame = std::move(result);
+    return true;
+}
+
+bool AtomicStrainSnapshotReader::skipFrame(AtomicStrainFrameInfo& info){
+    if(_nextFrame >= header().numFrames) return false;
+    const Snapshot::FrameEntry& e = entry(_nextFrame);
+    info.timestep = e.frame.timestep;
+    info.offset = header().frameTableOffset + _nextFrame * sizeof(Snapshot::FrameEntry);
+    info.natoms = static_cast<std::size_t>(e.frame.natoms);
+    info.simulationCell = cellFromArray(e.frame.cell, e.frame.pbc);
+    ++_nextFrame;
+    return true;
+}
+
+void AtomicStrainSnapshotReader::seek(std::uint64_t offset){
+    const Snapshot::FileHeader& h = header();
+    const std::uint64_t tableEnd = h.frameTableOffset + h.numFrames * sizeof(Snapshot::FrameEntry);
+    if(offset < h.frameTableOffset || offset > tableEnd || (offset - h.frameTableOffset) % sizeof(Snapshot::FrameEntry) != 0){
+        throw std::out_of_range("Offset is not a frame of snapshot: " + _path);
+    }
+    _nextFrame = static_cast<std::size_t>((offset - h.frameTableOffset) / sizeof(Snapshot::FrameEntry));
+}
+
+}
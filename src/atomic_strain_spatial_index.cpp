@@ -0,0 +1,192 @@
+#include <volt/atomic_strain_spatial_index.h>
+#include <volt/atomic_strain_morton.h>
+#include <volt/atomic_strain_file_writer.h>
+#include <volt/atomic_strain_columnar_reader.h>
+#include <volt/atomic_strain_parallel.h>
+
+#include <limits>
+#include <tbb/blocked_range.h>
+#include <tbb/combinable.h>
+#include <spdlog/spdlog.h>
+
+namespace Volt{
+
+namespace{
+
+struct Box{
+    double min[3] = {
+        std::numeric_limits<double>::max(),
+        std::numeric_limits<double>::max(),
+        std::numeric_limits<double>::max()
+    };
+    double max[3] = {
+        std::numeric_limits<double>::lowest(),
+        std::numeric_limits<double>::lowest(),
+        std::numeric_limits<double>::lowest()
+    };
+
+    void add(const Point3& p){
+        for(std::size_t k = 0; k < 3; ++k){
+            min[k] = std::min(min[k], p[k]);
+            max[k] = std::max(max[k], p[k]);
+        }
+    }
+
+    void merge(const Box& other){
+        for(std::size_t k = 0; k < 3; ++k){
+            min[k] = std::min(min[k], other.min[k]);
+            max[k] = std::max(max[k], other.max[k]);
+        }
+    }
+};
+
+// Reference positions of all output rows together with the grid spanning them.
+Morton::Grid referenceGrid(const AtomicStrainResult& result, std::vector<Point3>& points, bool serial){
+    const std::size_t n = result.numRows();
+    points.resize(n);
+    tbb::combinable<Box> localBoxes;
+    parallelFor(tbb::blocked_range<std::size_t>(0, n), serial,
+        [&](const tbb::blocked_range<std::size_t>& r){
+            Box& box = localBoxes.local();
+            for(std::size_t row = r.begin(); row < r.end(); ++row){
+                points[row] = result.referencePosition(result.atomIndex(row));
+                box.add(points[row]);
+            }
+        });
+    Box box;
+    localBoxes.combine_each([&box](const Box& b){ box.merge(b); });
+    if(n == 0){
+        for(std::size_t k = 0; k < 3; ++k) box.min[k] = box.max[k] = 0.0;
+    }
+    return Morton::makeGrid(box.min, box.max, Morton::MaxBitsPerAxis);
+}
+
+}
+
+std::shared_ptr<const std::vector<std::size_t>> mortonRowOrder(const AtomicStrainResult& result, bool serial){
+    std::vector<Point3> points;
+    const Morton::Grid grid = referenceGrid(result, points, serial);
+
+    const std::size_t n = points.size();
+    std::vector<std::pair<std::uint64_t, std::size_t>> keyed(n);
+    parallelFor(tbb::blocked_range<std::size_t>(0, n), serial,
+        [&](const tbb::blocked_range<std::size_t>& r){
+            for(std::size_t row = r.begin(); row < r.end(); ++row){
+                keyed[row] = { grid.code(points[row]), result.atomIndex(row) };
+            }
+        });
+    parallelSort(keyed.begin(), keyed.end(), serial);
+
+    auto rows = std::make_shared<std::vector<std::size_t>>(n);
+    parallelFor(tbb::blocked_range<std::size_t>(0, n), serial,
+        [&](const tbb::blocked_range<std::size_t>& r){
+            for(std::size_t i = r.begin(); i < r.end(); ++i){
+                (*rows)[i] = keyed[i].second;
+            }
+        });
+    return rows;
+}
+
+Morton::Grid mortonGrid(const AtomicStrainResult& result, bool serial){
+    AtomicStrainResult whole = result;
+    whole.rowBegin = 0;
+    whole.rowCount.reset();
+    std::vector<Point3> points;
+    return referenceGrid(whole, points, serial);
+}
+
+bool writeSpatialIndex(
+    const AtomicStrainResult& result,
+    const Morton::Grid& grid,
+    std::size_t blockSize,
+    const std::string& columnarPath,
+    const std::string& path,
+    bool serial
+){
+    blockSize = std::clamp<std::size_t>(blockSize, 1, std::numeric_limits<std::uint32_t>::max());
+
+    std::vector<SpatialIndex::ColumnRef> columns;
+    try{
+        const AtomicStrainColumnarReader reader(columnarPath);
+        if(reader.numRows() != result.numRows()){
+            spdlog::warn("Spatial index rows do not match {}", columnarPath);
+            return false;
+        }
+        for(const auto& entry : reader.columns()){
+            SpatialIndex::ColumnRef column{};
+            std::memcpy(column.name, entry.name, sizeof(column.name));
+            column.offset = entry.offset;
+            column.rowBits = entry.type == Columnar::ColumnType::Bitmask
+                ? entry.components
+                : std::uint64_t(entry.components) * Columnar::elementSize(entry.type) * 8;
+            columns.push_back(column);
+        }
+    }catch(const std::runtime_error& e){
+        spdlog::warn("Cannot index {}: {}", columnarPath, e.what());
+        return false;
+    }
+
+    const std::size_t n = result.numRows();
+    std::vector<Point3> points(n);
+    std::vector<std::uint64_t> codes(n);
+    parallelFor(tbb::blocked_range<std::size_t>(0, n), serial,
+        [&](const tbb::blocked_range<std::size_t>& r){
+            for(std::size_t row = r.begin(); row < r.end(); ++row){
+                points[row] = result.referencePosition(result.atomIndex(row));
+                codes[row] = grid.code(points[row]);
+            }
+        });
+    if(!std::is_sorted(codes.begin(), codes.end())){
+        spdlog::warn("Rows of {} are not in Morton order, spatial index not written", columnarPath);
+        return false;
+    }
+
+    const std::size_t numBlocks = (n + blockSize - 1) / blockSize;
+    std::vector<SpatialIndex::BlockEntry> blocks(numBlocks);
+    parallelFor(tbb::blocked_range<std::size_t>(0, numBlocks), serial,
+        [&](const tbb::blocked_range<std::size_t>& r){
+            for(std::size_t b = r.begin(); b < r.end(); ++b){
+                const std::size_t begin = b * blockSize;
+                const std::size_t end = std::min(n, begin + blockSize);
+
+                SpatialIndex::BlockEntry& block = blocks[b];
+                block.firstRow = begin;
+                block.numRows = static_cast<std::uint32_t>(end - begin);
+                block.reserved = 0;
+                block.firstCode = codes[begin];
+                block.lastCode = codes[end - 1];
+
+                Box box;
+                for(std::size_t row = begin; row < end; ++row){
+                    box.add(points[row]);
+                }
+                std::copy(std::begin(box.min), std::end(box.min), block.boundsMin);
+                std::copy(std::begin(box.max), std::end(box.max), block.boundsMax);
+            }
+        });
+
+    SpatialIndex::Header header{};
+    std::memcpy(header.magic, SpatialIndex::Magic, sizeof(header.magic));
+    header.version = SpatialIndex::Version;
+    header.bits = grid.bits;
+    header.numRows = n;
+    header.numBlocks = numBlocks;
+    header.blockSize = static_cast<std::uint32_t>(blockSize);
+    header.numColumns = static_cast<std::uint32_t>(columns.size());
+    std::copy(std::begin(grid.origin), std::end(grid.origin), header.origin);
+    std::copy(std::begin(grid.cellSize), std::end(grid.cellSize), header.cellSize);
+
+    BufferedFileWriter writer(1u << 20);
+    if(!writer.open(path)) return false;
+    writer.write(&header, sizeof(header));
+    writer.write(blocks.data(), blocks.size() * sizeof(SpatialIndex::BlockEntry));
+    writer.write(columns.data(), columns.size() * sizeof(SpatialIndex::ColumnRef));
+    writer.write(codes.data(), codes.size() * sizeof(std::uint64_t));
+    if(!writer.close()){
+        spdlog::warn("Failed to write atomic strain spatial index: {}", path);
+        return false;
+    }
+    return true;
+}
+
+}
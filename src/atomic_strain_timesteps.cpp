@@ -0,0 +1,190 @@
+#include <volt/atomic_strain_timesteps.h>
+#include <volt/atomic_strain_service.h>
+#include <volt/atomic_strain_byte_source.h>
+#include <volt/atomic_strain_frame_index.h>
+#include <volt/atomic_strain_frame_reader.h>
+
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <memory>
+#include <vector>
+#include <spdlog/spdlog.h>
+#include <tbb/parallel_pipeline.h>
+#include <tbb/task_arena.h>
+
+namespace Volt{
+
+namespace{
+
+std::string frameOutputBase(const std::string& outputBase, const AtomicStrainFrame& frame){
+    return outputBase + "_" + std::to_string(frame.timestep);
+}
+
+bool reportFrame(const json& result, const AtomicStrainFrame& frame, const std::string& frameOutput){
+    if(result.value("is_failed", false)){
+        spdlog::error("Analysis of timestep {} failed: {}", frame.timestep, result.value("error", "Unknown error"));
+        return false;
+    }
+    spdlog::info("Timestep {} written to {}", frame.timestep, frameOutput);
+    return true;
+}
+
+// Frames below the analyzer's parallel atom threshold are collected and analyzed
+// side by side through computeBatch(), at most maxFrames at a time; larger frames are
+// analyzed on arrival with atom-level parallelism. Call flush() after the last frame.
+class SmallFrameBatch{
+public:
+    SmallFrameBatch(AtomicStrainService& analyzer, const std::string& outputBase, std::size_t maxFrames)
+        : _analyzer(analyzer), _outputBase(outputBase), _maxFrames(std::max<std::size_t>(1, maxFrames)){}
+
+    bool add(AtomicStrainFrame& frame){
+        if(frame.natoms >= _analyzer.parallelAtomThreshold()){
+            return flush() && analyzeFrame(_analyzer, frame, _outputBase);
+        }
+        _outputs.push_back(frameOutputBase(_outputBase, frame));
+        _frames.push_back(std::move(frame));
+        return _frames.size() < _maxFrames || flush();
+    }
+
+    bool flush(){
+        const std::vector<json> results = _analyzer.computeBatch(_frames, _outputs);
+        bool ok = true;
+        for(std::size_t i = 0; i < results.size(); ++i){
+            ok = reportFrame(results[i], _frames[i], _outputs[i]) && ok;
+        }
+        _frames.clear();
+        _outputs.clear();
+        return ok;
+    }
+
+private:
+    AtomicStrainService& _analyzer;
+    std::string _outputBase;
+    std::size_t _maxFrames;
+    std::vector<AtomicStrainFrame> _frames;
+    std::vector<std::string> _outputs;
+};
+
+}
+
+bool finishWrites(AtomicStrainService& analyzer){
+    try{
+        analyzer.waitForPendingWrites();
+        return true;
+    }catch(const std::exception& e){
+        spdlog::error("Writing atomic strain output failed: {}", e.what());
+        return false;
+    }
+}
+
+bool analyzeFrame(AtomicStrainService& analyzer, const AtomicStrainFrame& frame, const std::string& outputBase){
+    const std::string frameOutput = frameOutputBase(outputBase, frame);
+    try{
+        return reportFrame(analyzer.compute(frame, frameOutput), frame, frameOutput);
+    }catch(const std::exception& e){
+        spdlog::error("Analysis of timestep {} failed: {}", frame.timestep, e.what());
+        return false;
+    }
+}
+
+bool analyzeTimesteps(
+    AtomicStrainService& analyzer,
+    const std::string& filename,
+    const std::string& outputBase,
+    long long first,
+    long long last,
+    bool persistIndex,
+    bool preferUnwrapped,
+    std::size_t readAhead
+){
+    bool ok = true;
+    std::size_t analyzed = 0;
+    const std::size_t batchFrames = 4 * static_cast<std::size_t>(tbb::this_task_arena::max_concurrency());
+    SmallFrameBatch batch(analyzer, outputBase, batchFrames);
+    auto analyze = [&](AtomicStrainFrame& frame){
+        if(!ok) return;
+        ok = batch.add(frame);
+        if(ok) ++analyzed;
+    };
+
+    try{
+        if(detectCompression(filename) != Compression::None){
+            auto reader = openDumpReader(filename, preferUnwrapped);
+            AtomicStrainFrame frame;
+            while(ok && reader->readFrame(frame)){
+                if(frame.timestep >= first && frame.timestep <= last) analyze(frame);
+            }
+        }else{
+            const auto index = AtomicStrainFrameIndex::open(filename, persistIndex, preferUnwrapped);
+            const auto frames = index.range(first, last);
+            // Small frames are read as many at a time as a batch holds.
+            const bool allSmall = std::all_of(frames.begin(), frames.end(), [&analyzer](const AtomicStrainFrameInfo& info){
+                return info.natoms < analyzer.parallelAtomThreshold();
+            });
+            index.forEachFrame(frames, allSmall ? std::max(readAhead, batchFrames) : readAhead, analyze);
+        }
+        if(ok) ok = batch.flush();
+    }catch(const std::exception& e){
+        spdlog::error("{}", e.what());
+        return false;
+    }
+
+    if(ok && analyzed == 0){
+        spdlog::error("No frames within the requested timesteps in {}", filename);
+        return false;
+    }
+    return ok;
+}
+
+bool analyzeStream(
+    AtomicStrainService& analyzer,
+    bool hasReference,
+    const std::string& source,
+    const std::string& outputBase,
+    long long first,
+    long long last,
+    bool preferUnwrapped,
+    std::size_t readAhead
+){
+    // Read by the input filter while the output filter sets it, on different tokens.
+    std::atomic<bool> ok{ true };
+    std::size_t analyzed = 0;
+    try{
+        auto reader = openStreamReader(source, preferUnwrapped);
+        spdlog::info("Waiting for frames on {}", source == "-" ? "standard input" : source);
+        tbb::parallel_pipeline(std::max<std::size_t>(1, readAhead),
+            tbb::make_filter<void, std::shared_ptr<AtomicStrainFrame>>(tbb::filter_mode::serial_in_order,
+                [&](tbb::flow_control& fc) -> std::shared_ptr<AtomicStrainFrame>{
+                    auto frame = std::make_shared<AtomicStrainFrame>();
+                    if(!ok || !reader->readFrame(*frame)){
+                        fc.stop();
+                        return nullptr;
+                    }
+                    return frame;
+                }) &
+            tbb::make_filter<std::shared_ptr<AtomicStrainFrame>, void>(tbb::filter_mode::serial_in_order,
+                [&](const std::shared_ptr<AtomicStrainFrame>& frame){
+                    if(!ok || frame->timestep < first || frame->timestep > last) return;
+                    if(!hasReference){
+                        spdlog::info("Using timestep {} as reference", frame->timestep);
+                        analyzer.setReferenceFrame(*frame);
+                        hasReference = true;
+                    }
+                    ok = analyzeFrame(analyzer, *frame, outputBase);
+                    if(ok) ++analyzed;
+                })
+        );
+    }catch(const std::exception& e){
+        spdlog::error("{}", e.what());
+        return false;
+    }
+
+    if(ok && analyzed == 0){
+        spdlog::error("No frames received on {}", source);
+        return false;
+    }
+    return ok;
+}
+
+}
@@ -1,5 +1,14 @@
 #include <volt/cli/common.h>
 #include <volt/atomic_strain_service.h>
+#include <volt/atomic_strain_input.h>
+#include <volt/atomic_strain_timesteps.h>
+#include <volt/atomic_strain_snapshot.h>
+#include <volt/atomic_strain_prepared_reference.h>
+#include <volt/atomic_strain_directory_watch.h>
+#include <volt/atomic_strain_batch.h>
+#include <algorithm>
+#include <csignal>
+#include <limits>
 #include <oneapi/tbb/global_control.h>
 
 using namespace Volt;
@@ -12,14 +21,87 @@ void showUsage(const std::string& name) {
         << "  --reference <file>            Reference LAMMPS dump file.\n"
         << "                                If omitted, current frame is used (≈ zero strain).\n"
         << "  --eliminateCellDeformation    Eliminate cell deformation. [default: false]\n"
-        << "  --assumeUnwrapped             Assume unwrapped coordinates. [default: false]\n"
+        << "  --assumeUnwrapped             Assume unwrapped coordinates; read xu/yu/zu over x/y/z. [default: false]\n"
         << "  --calcDeformationGradient     Compute deformation gradient F. [default: true]\n"
         << "  --calcStrainTensors           Compute strain tensors. [default: true]\n"
         << "  --calcD2min                   Compute D²min (nonaffine displacement). [default: true]\n"
+        << "  --fields <list>               Comma separated per-atom output fields:\n"
+        << "                                shear,volumetric,strain,defgrad,d2min,invalid. [default: all]\n"
+        << "  --summary-only                Only write main_listing, skip per-atom output. [default: false]\n"
+        << "  --shear-threshold <float>     Only write atoms with shear strain above this value.\n"
+        << "  --d2min-threshold <float>     Only write atoms with D²min above this value.\n"
+        << "  --top-k <int>                 Only write the K atoms with the largest D²min.\n"
+        << "  --sort-by-id                  Write per-atom rows in ascending identifier order. [default: false]\n"
+        << "  --spatial-index               Columnar format: write rows in Morton order of reference positions\n"
+        << "                                plus a block index with row codes and column offsets. [default: false]\n"
+        << "  --spatial-block-size <int>    Rows per spatial index block. [default: 4096]\n"
+        << "  --encoding <name>             Per-atom value encoding: float64, float32, quantized. [default: float64]\n"
+        << "  --error-bound <float>         Absolute error bound for quantized encoding.\n"
+        << "  --invalid-bitmask             Pack invalid flags into a single bitmask. [default: false]\n"
+        << "  --format <name>               Per-atom output format: msgpack, columnar, dump, delta, octree. [default: msgpack]\n"
+        << "  --checksums                   Store per-column checksums in columnar output. [default: false]\n"
+        << "  --direct-io                   Write columnar/dump/octree output with O_DIRECT (no page cache). [default: false]\n"
+        << "  --keyframe-interval <int>     Delta format: full keyframe every N frames. [default: 10]\n"
+        << "  --delta-tolerance <float>     Delta format: minimum change written. [default: 1e-4]\n"
+        << "  --octree-depth <int>          Octree format: maximum depth, 0 = automatic. [default: 0]\n"
+        << "  --shards <int>                Split columnar/dump output into N files plus a manifest. [default: 1]\n"
+        << "  --async-write                 Write results on a dedicated I/O thread. [default: false]\n"
+        << "  --write-queue <int>           Max results waiting for the I/O thread. [default: 2]\n"
+        << "  --no-mmap                     Read dumps with LammpsParser instead of the memory-mapped reader.\n"
+        << "  --timestep <int>              Analyze the frame with this timestep instead of the first one.\n"
+        << "  --timesteps <first>:<last>    Analyze every frame in this timestep range (bounds optional),\n"
+        << "                                writing <output_base>_<timestep>_atomic_strain.*.\n"
+        << "  --reference-timestep <int>    Use this timestep of the reference file (or the input) as reference.\n"
+        << "  --frame-index                 Keep the frame index as <file>.vfix sidecar for later runs. [default: false]\n"
+        << "  --read-ahead <int>            Frames read concurrently ahead of the analysis. [default: 2]\n"
+        << "  --parallel-threshold <int>    --timesteps: smaller frames are analyzed side by side. [default: 20000]\n"
+        << "  --stream <file|->             Analyze frames from stdin or a named pipe as they arrive,\n"
+        << "                                writing <output_base>_<timestep>_atomic_strain.* per frame.\n"
+        << "  --watch <dir>                 Analyze every dump written into <dir> until interrupted, writing\n"
+        << "                                <dump_base>_<timestep>_atomic_strain.* next to it. Needs --reference.\n"
+        << "  --batch <manifest.json>       Analyze the (input, reference) pairs of the manifest concurrently.\n"
+        << "  --memory-budget <MiB>         Batch: estimated memory of all running jobs. [default: 80% of RAM]\n"
+        << "  --convert                     Write all frames to the snapshot <file>.vsnap and exit.\n"
+        << "  --no-snapshot                 Parse the dump even if an up-to-date snapshot exists.\n"
+        << "  --reference-cache <dir>       Keep prepared reference neighbor lists in <dir> for later runs.\n"
+        << "  --shared-reference            Share prepared reference data with other processes through /dev/shm.\n"
+        << "  --reference-cache-limit <MiB> Evict the least recently used prepared references beyond this size.\n"
+        << "                                [default: 4096 with --shared-reference, unlimited otherwise]\n"
+        << "  --clear-reference-cache       Remove the prepared references of the cache directory and exit.\n"
         << "  --threads <int>               Max worker threads (TBB/OMP). [default: auto]\n";
     printHelpOption();
 }
 
+bool parseTimestep(const std::string& text, long long& timestep) {
+    try {
+        std::size_t end = 0;
+        timestep = std::stoll(text, &end);
+        return end == text.size();
+    } catch (const std::exception&) {
+        return false;
+    }
+}
+
+// "<first>:<last>", either bound may be omitted.
+bool parseTimestepRange(const std::string& text, long long& first, long long& last) {
+    const std::size_t colon = text.find(':');
+    if (colon == std::string::npos) return false;
+    const std::string lower = text.substr(0, colon);
+    const std::string upper = text.substr(colon + 1);
+    first = std::numeric_limits<long long>::min();
+    last = std::numeric_limits<long long>::max();
+    return (lower.empty() || parseTimestep(lower, first)) && (upper.empty() || parseTimestep(upper, last));
+}
+
+// Size limit of the --shared-reference cache, which lives in memory.
+constexpr int DefaultSharedReferenceCacheMiB = 4096;
+
+volatile std::sig_atomic_t stopRequested = 0;
+
+void requestStop(int) {
+    stopRequested = 1;
+}
+
 int main(int argc, char* argv[]) {
     if (argc < 2) {
         showUsage(argv[0]);
@@ -29,9 +111,19 @@ int main(int argc, char* argv[]) {
     std::string filename, outputBase;
     auto opts = parseArgs(argc, argv, filename, outputBase);
     
-    if (hasOption(opts, "--help") || filename.empty()) {
+    // A stream, a watched directory or a batch manifest replaces the input file; a
+    // positional argument then only names the output of a stream.
+    const std::string streamSource = getString(opts, "--stream");
+    const std::string watchedDirectory = getString(opts, "--watch");
+    const std::string batchManifest = getString(opts, "--batch");
+    const bool streaming = !streamSource.empty();
+    const bool watching = !watchedDirectory.empty();
+    const bool batching = !batchManifest.empty();
+    const bool clearingReferenceCache = getBool(opts, "--clear-reference-cache", false);
+    const bool hasInputFile = !streaming && !watching && !batching && !clearingReferenceCache;
+    if (hasOption(opts, "--help") || (filename.empty() && hasInputFile)) {
         showUsage(argv[0]);
-        return filename.empty() ? 1 : 0;
+        return filename.empty() && hasInputFile ? 1 : 0;
     }
     
     const int requestedThreads = std::max(1, getInt(opts, "--threads", std::thread::hardware_concurrency() > 0
@@ -43,23 +135,204 @@ int main(int argc, char* argv[]) {
     );
     initLogging("volt-atomic-strain");
     spdlog::info("Using {} threads (OneTBB)", requestedThreads);
+
+    std::string referenceCache = getString(opts, "--reference-cache");
+    const bool sharedReferenceCache = referenceCache.empty() && getBool(opts, "--shared-reference", false);
+    if (sharedReferenceCache) {
+        referenceCache = AtomicStrainPreparedReference::sharedDirectory();
+    }
+    const std::uint64_t referenceCacheLimit = static_cast<std::uint64_t>(std::max(0, getInt(opts, "--reference-cache-limit",
+        sharedReferenceCache ? DefaultSharedReferenceCacheMiB : 0))) << 20;
+
+    if (clearingReferenceCache) {
+        if (referenceCache.empty()) {
+            spdlog::error("--clear-reference-cache requires --reference-cache or --shared-reference");
+            return 1;
+        }
+        const std::uint64_t removed = AtomicStrainPreparedReference::evict(referenceCache, 0);
+        spdlog::info("Removed {} MiB of prepared references from {}", removed >> 20, referenceCache);
+        return 0;
+    }
     
-    LammpsParser::Frame frame;
-    if (!parseFrame(filename, frame)) return 1;
+    // Options shared by the main analyzer and every batch job.
+    const auto configureAnalyzer = [&opts, &referenceCache, referenceCacheLimit](AtomicStrainService& analyzer) -> bool {
+        analyzer.setCutoff(getDouble(opts, "--cutoff", 3.0));
+        analyzer.setReferenceCache(referenceCache, referenceCacheLimit);
+
+        analyzer.setOptions(
+            getBool(opts, "--eliminateCellDeformation", false),
+            getBool(opts, "--assumeUnwrapped", false),
+            getBool(opts, "--calcDeformationGradient", true),
+            getBool(opts, "--calcStrainTensors", true),
+            getBool(opts, "--calcD2min", true)
+        );
+
+        const std::string fieldList = getString(opts, "--fields");
+        if (!fieldList.empty()) {
+            try {
+                analyzer.setOutputFields(parseAtomicStrainFields(fieldList));
+            } catch (const std::invalid_argument& e) {
+                spdlog::error("{}", e.what());
+                return false;
+            }
+        }
+        analyzer.setSummaryOnly(getBool(opts, "--summary-only", false));
+
+        AtomicStrainSelection selection;
+        if (hasOption(opts, "--shear-threshold")) {
+            selection.shearThreshold = getDouble(opts, "--shear-threshold", 0.0);
+        }
+        if (hasOption(opts, "--d2min-threshold")) {
+            selection.d2minThreshold = getDouble(opts, "--d2min-threshold", 0.0);
+        }
+        selection.topK = static_cast<std::size_t>(std::max(0, getInt(opts, "--top-k", 0)));
+        analyzer.setSelection(selection);
+        analyzer.setSortByIdentifier(getBool(opts, "--sort-by-id", false));
+        analyzer.setSpatialOrder(
+            getBool(opts, "--spatial-index", false),
+            static_cast<std::size_t>(std::max(1, getInt(opts, "--spatial-block-size", 4096)))
+        );
+
+        AtomicStrainEncodingOptions encoding;
+        encoding.errorBound = getDouble(opts, "--error-bound", 0.0);
+        encoding.invalidBitmask = getBool(opts, "--invalid-bitmask", false);
+        analyzer.setColumnChecksums(getBool(opts, "--checksums", false));
+        analyzer.setDirectIo(getBool(opts, "--direct-io", false));
+        analyzer.setDeltaOptions(
+            static_cast<std::size_t>(std::max(1, getInt(opts, "--keyframe-interval", 10))),
+            getDouble(opts, "--delta-tolerance", 1e-4)
+        );
+        analyzer.setOctreeDepth(static_cast<unsigned>(std::max(0, getInt(opts, "--octree-depth", 0))));
+        analyzer.setShards(static_cast<std::size_t>(std::max(1, getInt(opts, "--shards", 1))));
+        analyzer.setAsyncOutput(
+            getBool(opts, "--async-write", false),
+            static_cast<std::size_t>(std::max(1, getInt(opts, "--write-queue", 2)))
+        );
+        if (hasOption(opts, "--parallel-threshold")) {
+            analyzer.setParallelAtomThreshold(static_cast<std::size_t>(std::max(0, getInt(opts, "--parallel-threshold", 0))));
+        }
+
+        const std::string encodingName = getString(opts, "--encoding");
+        try {
+            if (!encodingName.empty()) {
+                encoding.encoding = parseAtomicStrainEncoding(encodingName);
+            }
+            analyzer.setEncoding(encoding);
+            const std::string formatName = getString(opts, "--format");
+            const AtomicStrainOutputFormat format = formatName.empty()
+                ? AtomicStrainOutputFormat::Msgpack
+                : parseAtomicStrainOutputFormat(formatName);
+            analyzer.setOutputFormat(format);
+            // The msgpack file (which also carries delta records) is written by JsonUtils.
+            if (getBool(opts, "--direct-io", false) &&
+                (format == AtomicStrainOutputFormat::Msgpack || format == AtomicStrainOutputFormat::Delta)) {
+                spdlog::error("--direct-io applies to columnar, dump and octree output only");
+                return false;
+            }
+            // The index addresses byte ranges of columnar files.
+            if (getBool(opts, "--spatial-index", false) && format != AtomicStrainOutputFormat::Columnar) {
+                spdlog::error("--spatial-index requires --format columnar");
+                return false;
+            }
+        } catch (const std::invalid_argument& e) {
+            spdlog::error("{}", e.what());
+            return false;
+        }
+        return true;
+    };
+
+    if (!hasInputFile && (getBool(opts, "--convert", false) || (hasOption(opts, "--reference-timestep") && !hasOption(opts, "--reference")))) {
+        spdlog::error("--stream, --watch and --batch cannot be combined with --convert or with --reference-timestep without --reference");
+        return 1;
+    }
+    if (streaming + watching + batching > 1) {
+        spdlog::error("--stream, --watch and --batch are mutually exclusive");
+        return 1;
+    }
+    if (watching && !hasOption(opts, "--reference")) {
+        spdlog::error("--watch requires --reference");
+        return 1;
+    }
+
+    // Unwrapped coordinates are taken from xu/yu/zu columns when a dump has both kinds.
+    const bool preferUnwrapped = getBool(opts, "--assumeUnwrapped", false);
+
+    if (getBool(opts, "--convert", false)) {
+        const std::string snapshotPath = snapshotPathFor(filename);
+        spdlog::info("Converting {} to {}", filename, snapshotPath);
+        try {
+            if (!writeSnapshot(filename, snapshotPath, preferUnwrapped)) return 1;
+        } catch (const std::runtime_error& e) {
+            spdlog::error("{}", e.what());
+            return 1;
+        }
+        spdlog::info("Snapshot written: {}", snapshotPath);
+        return 0;
+    }
+
+    const bool useMmap = !getBool(opts, "--no-mmap", false);
+    const bool persistIndex = getBool(opts, "--frame-index", false);
+    const bool useSnapshot = !getBool(opts, "--no-snapshot", false);
+    const std::string inputPath = hasInputFile ? resolveInput(filename, useSnapshot, preferUnwrapped) : filename;
+
+    if (batching) {
+        if (hasOption(opts, "--timestep") || hasOption(opts, "--timesteps") || hasOption(opts, "--reference")) {
+            spdlog::error("--batch takes inputs and references from the manifest");
+            return 1;
+        }
+        const std::size_t memoryBudget = hasOption(opts, "--memory-budget")
+            ? static_cast<std::size_t>(std::max(1, getInt(opts, "--memory-budget", 0))) << 20
+            : defaultMemoryBudget();
+        return runBatch(batchManifest, memoryBudget, static_cast<std::size_t>(requestedThreads), useMmap, useSnapshot, preferUnwrapped, configureAnalyzer) ? 0 : 1;
+    }
+
+    long long timestep = 0;
+    long long referenceTimestep = 0;
+    long long firstTimestep = 0;
+    long long lastTimestep = 0;
+    const bool hasTimestep = hasOption(opts, "--timestep");
+    const bool hasReferenceTimestep = hasOption(opts, "--reference-timestep");
+    const bool hasTimestepRange = hasOption(opts, "--timesteps");
+    if ((hasTimestep && !parseTimestep(getString(opts, "--timestep"), timestep)) ||
+        (hasReferenceTimestep && !parseTimestep(getString(opts, "--reference-timestep"), referenceTimestep)) ||
+        (hasTimestepRange && !parseTimestepRange(getString(opts, "--timesteps"), firstTimestep, lastTimestep))) {
+        spdlog::error("Invalid timestep selection");
+        return 1;
+    }
+    if (hasTimestep && hasTimestepRange) {
+        spdlog::error("--timestep and --timesteps are mutually exclusive");
+        return 1;
+    }
+    if (!hasInputFile && hasTimestep) {
+        spdlog::error("--stream and --watch read frames in order and cannot select a single --timestep");
+        return 1;
+    }
+
+    // In range mode the frames are read while the analysis runs.
+    AtomicStrainFrame frame;
+    if (hasTimestep) {
+        if (!loadTimestep(inputPath, timestep, persistIndex, preferUnwrapped, frame)) return 1;
+    } else if (!hasTimestepRange && hasInputFile) {
+        if (!loadFrame(inputPath, useMmap, preferUnwrapped, frame)) return 1;
+    }
     
-    // Parse reference frame if provided
+    // Parse reference frame if provided; a reference timestep alone selects it from the input.
     std::string refFile = getString(opts, "--reference");
-    LammpsParser::Frame refFrame;
+    if (refFile.empty() && hasReferenceTimestep) refFile = filename;
+    AtomicStrainFrame refFrame;
     bool hasReference = false;
     
     if (!refFile.empty()) {
         spdlog::info("Parsing reference file: {}", refFile);
-        LammpsParser refParser;
-        if (!refParser.parseFile(refFile, refFrame)) {
+        const std::string refInputPath = resolveInput(refFile, useSnapshot, preferUnwrapped);
+        const bool loaded = hasReferenceTimestep
+            ? loadTimestep(refInputPath, referenceTimestep, persistIndex, preferUnwrapped, refFrame)
+            : loadFrame(refInputPath, useMmap, preferUnwrapped, refFrame);
+        if (!loaded) {
             spdlog::error("Failed to parse reference file: {}", refFile);
             return 1;
         }
-        if (refFrame.natoms != frame.natoms) {
+        if (!hasTimestepRange && hasInputFile && refFrame.natoms != frame.natoms) {
             spdlog::error("Atom count mismatch: current={} reference={}", frame.natoms, refFrame.natoms);
             return 1;
         }
@@ -67,26 +340,74 @@ int main(int argc, char* argv[]) {
         spdlog::info("Reference loaded: {} atoms", refFrame.natoms);
     }
     
-    outputBase = deriveOutputBase(filename, outputBase);
+    outputBase = deriveOutputBase(filename.empty() ? std::string("stream") : filename, outputBase);
     spdlog::info("Output base: {}", outputBase);
     
     AtomicStrainService analyzer;
-    analyzer.setCutoff(getDouble(opts, "--cutoff", 3.0));
-    
+    if (!configureAnalyzer(analyzer)) return 1;
     if (hasReference) {
-        analyzer.setReferenceFrame(refFrame);
+        analyzer.setReferenceFrame(std::move(refFrame));
     }
-    
-    analyzer.setOptions(
-        getBool(opts, "--eliminateCellDeformation", false),
-        getBool(opts, "--assumeUnwrapped", false),
-        getBool(opts, "--calcDeformationGradient", true),
-        getBool(opts, "--calcStrainTensors", true),
-        getBool(opts, "--calcD2min", true)
-    );
+    // Every frame of a multi-frame run is analyzed against the same reference.
+    analyzer.setRetainPreparedReference(!hasInputFile || hasTimestepRange);
     
     spdlog::info("Starting atomic strain analysis...");
-    json result = analyzer.compute(frame, outputBase);
+    if (watching) {
+        // Runs until SIGINT or SIGTERM.
+        std::signal(SIGINT, requestStop);
+        std::signal(SIGTERM, requestStop);
+        const bool ok = watchDirectory(
+            analyzer,
+            watchedDirectory,
+            hasTimestepRange ? firstTimestep : std::numeric_limits<long long>::min(),
+            hasTimestepRange ? lastTimestep : std::numeric_limits<long long>::max(),
+            preferUnwrapped,
+            [] { return stopRequested != 0; }
+        );
+        const bool written = finishWrites(analyzer);
+        return ok && written ? 0 : 1;
+    }
+    if (streaming) {
+        const bool ok = analyzeStream(
+            analyzer,
+            hasReference,
+            streamSource,
+            outputBase,
+            hasTimestepRange ? firstTimestep : std::numeric_limits<long long>::min(),
+            hasTimestepRange ? lastTimestep : std::numeric_limits<long long>::max(),
+            preferUnwrapped,
+            static_cast<std::size_t>(std::max(1, getInt(opts, "--read-ahead", 2)))
+        );
+        const bool written = finishWrites(analyzer);
+        if (!ok || !written) return 1;
+        spdlog::info("Atomic strain analysis completed.");
+        return 0;
+    }
+    if (hasTimestepRange) {
+        const bool ok = analyzeTimesteps(
+            analyzer,
+            inputPath,
+            outputBase,
+            firstTimestep,
+            lastTimestep,
+            persistIndex,
+            preferUnwrapped,
+            static_cast<std::size_t>(std::max(1, getInt(opts, "--read-ahead", 2)))
+        );
+        const bool written = finishWrites(analyzer);
+        if (!ok || !written) return 1;
+        spdlog::info("Atomic strain analysis completed.");
+        return 0;
+    }
+
+    json result;
+    try {
+        result = analyzer.compute(frame, outputBase);
+    } catch (const std::runtime_error& e) {
+        spdlog::error("Analysis failed: {}", e.what());
+        return 1;
+    }
+    if (!finishWrites(analyzer)) return 1;
     
     if (result.value("is_failed", false)) {
         spdlog::error("Analysis failed: {}", result.value("error", "Unknown error"));
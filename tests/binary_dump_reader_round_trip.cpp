@@ -0,0 +1,218 @@
+#include <volt/atomic_strain_binary_dump_reader.h>
+#include <volt/atomic_strain_frame_reader.h>
+
+#include "test_support.h"
+
+#include <cmath>
+#include <cstdint>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+using namespace Volt;
+
+namespace{
+
+constexpr std::size_t NumAtoms = 10;
+
+// Writes frames in the layout of LAMMPS "dump ... binary".
+class BinaryDumpWriter{
+public:
+    explicit BinaryDumpWriter(const std::string& path)
+        : _out(path, std::ios::binary | std::ios::trunc){}
+
+    template<typename T>
+    void put(T value){
+        _out.write(reinterpret_cast<const char*>(&value), sizeof(T));
+    }
+
+    // Revised header up to and including the atom count.
+    void beginRevised(std::int64_t timestep, std::int64_t natoms){
+        const std::string_view magic = "DUMPCUSTOM";
+        put<std::int64_t>(-static_cast<std::int64_t>(magic.size()));
+        _out.write(magic.data(), static_cast<std::streamsize>(magic.size()));
+        put<std::int32_t>(1);
+        put<std::int32_t>(2);
+        put<std::int64_t>(timestep);
+        put<std::int64_t>(natoms);
+    }
+
+    // Column header of revision 2: no units, no time, then the column names.
+    void columns(std::string_view names){
+        put<std::int32_t>(0);
+        put<char>(0);
+        put<std::int32_t>(static_cast<std::int32_t>(names.size()));
+        _out.write(names.data(), static_cast<std::streamsize>(names.size()));
+    }
+
+    // Rows in two per-processor chunks.
+    void rows(const std::vector<double>& values, std::size_t sizeOne){
+        const std::size_t rows = values.size() / sizeOne;
+        const std::size_t split = rows / 2;
+        put<std::int32_t>(2);
+        for(const auto& [begin, end] : { std::pair{ std::size_t(0), split }, std::pair{ split, rows } }){
+            put<std::int32_t>(static_cast<std::int32_t>((end - begin) * sizeOne));
+            _out.write(reinterpret_cast<const char*>(values.data() + begin * sizeOne), static_cast<std::streamsize>((end - begin) * sizeOne * sizeof(double)));
+        }
+    }
+
+private:
+    std::ofstream _out;
+};
+
+void boundary(BinaryDumpWriter& out){
+    for(int i = 0; i < 6; ++i) out.put<std::int32_t>(0);
+}
+
+double position(std::size_t atom, std::size_t k){
+    return 0.5 + static_cast<double>(atom) + 0.25 * static_cast<double>(k);
+}
+
+// Revised layout with column names, restricted triclinic box and unwrapped columns
+// next to wrapped ones, two frames.
+void checkRevised(const std::string& path){
+    {
+        BinaryDumpWriter out(path);
+        for(std::int64_t timestep : { 100, 200 }){
+            out.beginRevised(timestep, NumAtoms);
+            out.put<std::int32_t>(1);
+            boundary(out);
+            for(double v : { 0.0, 20.0, 0.0, 20.0, 0.0, 20.0 }) out.put(v);
+            for(double v : { 1.0, 0.0, 0.0 }) out.put(v);
+            out.put<std::int32_t>(8);
+            out.columns("id type x y z xu yu zu");
+            std::vector<double> values;
+            for(std::size_t i = 0; i < NumAtoms; ++i){
+                values.push_back(static_cast<double>(NumAtoms - i));
+                values.push_back(1.0);
+                for(std::size_t k = 0; k < 3; ++k) values.push_back(position(i, k));
+                for(std::size_t k = 0; k < 3; ++k) values.push_back(position(i, k) + 100.0 + static_cast<double>(timestep));
+            }
+            out.rows(values, 8);
+        }
+    }
+
+    for(bool preferUnwrapped : { false, true }){
+        auto reader = openDumpReader(path, preferUnwrapped);
+        for(std::int64_t timestep : { 100, 200 }){
+            AtomicStrainFrame frame;
+            VOLT_REQUIRE(reader->readFrame(frame));
+            VOLT_CHECK(frame.timestep == timestep);
+            VOLT_REQUIRE(frame.natoms == NumAtoms);
+            VOLT_REQUIRE(frame.identifiers != nullptr);
+            const double shift = preferUnwrapped ? 100.0 + static_cast<double>(timestep) : 0.0;
+            for(std::size_t i = 0; i < NumAtoms; ++i){
+                VOLT_CHECK(frame.identifiers->getInt(i) == static_cast<int>(NumAtoms - i));
+                const Point3 p = frame.positions->getPoint3(i);
+                for(std::size_t k = 0; k < 3; ++k){
+                    VOLT_CHECK(p[k] == position(i, k) + shift);
+                }
+            }
+            // The tilt factor xy shrinks the bounding box back to the cell.
+            const auto& m = frame.simulationCell.matrix();
+            VOLT_CHECK(m(0, 0) == 19.0);
+            VOLT_CHECK(m(0, 1) == 1.0);
+            VOLT_CHECK(m(1, 1) == 20.0);
+        }
+        AtomicStrainFrame end;
+        VOLT_CHECK(!reader->readFrame(end));
+    }
+}
+
+// Original layout without magic or column names: "dump atom" rows with reduced coordinates.
+void writeOriginal(const std::string& path, std::int32_t sizeOne){
+    BinaryDumpWriter out(path);
+    out.put<std::int64_t>(7);
+    out.put<std::int64_t>(NumAtoms);
+    out.put<std::int32_t>(0);
+    boundary(out);
+    for(double v : { -5.0, 5.0, 0.0, 10.0, 0.0, 20.0 }) out.put(v);
+    out.put<std::int32_t>(sizeOne);
+    std::vector<double> values;
+    for(std::size_t i = 0; i < NumAtoms; ++i){
+        values.push_back(static_cast<double>(i + 1));
+        values.push_back(1.0);
+        for(std::size_t k = 0; k < 3; ++k) values.push_back(0.1 * static_cast<double>(i));
+        for(std::int32_t extra = 5; extra < sizeOne; ++extra) values.push_back(0.0);
+    }
+    out.rows(values, static_cast<std::size_t>(sizeOne));
+}
+
+void checkOriginal(const std::string& path){
+    for(std::int32_t sizeOne : { 5, 8 }){
+        writeOriginal(path, sizeOne);
+        AtomicStrainBinaryDumpReader reader(path);
+        AtomicStrainFrame frame;
+        VOLT_REQUIRE(reader.readFrame(frame));
+        VOLT_CHECK(frame.timestep == 7);
+        VOLT_REQUIRE(frame.natoms == NumAtoms);
+        for(std::size_t i = 0; i < NumAtoms; ++i){
+            const double s = 0.1 * static_cast<double>(i);
+            const Point3 p = frame.positions->getPoint3(i);
+            VOLT_CHECK(std::abs(p[0] - (-5.0 + 10.0 * s)) < 1e-12);
+            VOLT_CHECK(std::abs(p[1] - 10.0 * s) < 1e-12);
+            VOLT_CHECK(std::abs(p[2] - 20.0 * s) < 1e-12);
+        }
+    }
+
+    // Without column names only the dump atom row sizes can be interpreted.
+    writeOriginal(path, 6);
+    bool rejected = false;
+    try{
+        AtomicStrainBinaryDumpReader reader(path);
+        AtomicStrainFrame frame;
+        reader.readFrame(frame);
+    }catch(const std::runtime_error&){
+        rejected = true;
+    }
+    VOLT_CHECK(rejected);
+}
+
+// General triclinic box given by its edge vectors and origin.
+void checkGeneralTriclinic(const std::string& path){
+    const double edges[3][3] = { { 10.0, 1.0, 0.0 }, { -1.0, 10.0, 0.5 }, { 0.0, 2.0, 12.0 } };
+    const double origin[3] = { 1.0, 2.0, 3.0 };
+    {
+        BinaryDumpWriter out(path);
+        out.beginRevised(5, NumAtoms);
+        out.put<std::int32_t>(2);
+        boundary(out);
+        for(const auto& edge : edges){
+            for(double v : edge) out.put(v);
+        }
+        for(double v : origin) out.put(v);
+        out.put<std::int32_t>(4);
+        out.columns("id x y z");
+        std::vector<double> values;
+        for(std::size_t i = 0; i < NumAtoms; ++i){
+            values.push_back(static_cast<double>(i + 1));
+            for(std::size_t k = 0; k < 3; ++k) values.push_back(position(i, k));
+        }
+        out.rows(values, 4);
+    }
+
+    AtomicStrainBinaryDumpReader reader(path);
+    AtomicStrainFrame frame;
+    VOLT_REQUIRE(reader.readFrame(frame));
+    VOLT_REQUIRE(frame.natoms == NumAtoms);
+    const auto& m = frame.simulationCell.matrix();
+    for(std::size_t r = 0; r < 3; ++r){
+        for(std::size_t c = 0; c < 3; ++c){
+            VOLT_CHECK(m(r, c) == edges[c][r]);
+        }
+        VOLT_CHECK(m(r, 3) == origin[r]);
+    }
+    VOLT_CHECK(frame.positions->getPoint3(3)[1] == position(3, 1));
+}
+
+}
+
+int main(){
+    const Testing::ScratchDirectory scratch("atomic-strain-binary-dump");
+    checkRevised(scratch.file("revised.bin"));
+    checkOriginal(scratch.file("original.bin"));
+    checkGeneralTriclinic(scratch.file("general.bin"));
+    return Testing::finish();
+}
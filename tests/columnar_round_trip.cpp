@@ -0,0 +1,146 @@
+#include <volt/atomic_strain_columnar_reader.h>
+#include <volt/atomic_strain_columnar_writer.h>
+
+#include "test_support.h"
+
+#include <cmath>
+#include <cstdint>
+#include <fstream>
+#include <limits>
+#include <memory>
+#include <stdexcept>
+#include <vector>
+
+using namespace Volt;
+using namespace Volt::Particles;
+
+namespace{
+
+constexpr std::size_t NumAtoms = 1000;
+
+AtomicStrainResult makeResult(){
+    return Testing::makeResult(NumAtoms, {
+        .identifier = [](std::size_t i){ return static_cast<int>(i) + 7; },
+        .shearStrain = [](std::size_t i){ return 0.001 * static_cast<double>(i) - 0.3; },
+        .strainTensor = [](std::size_t i, std::size_t c){ return static_cast<double>(c) + 0.01 * static_cast<double>(i); },
+        .d2min = [](std::size_t i){ return std::sqrt(static_cast<double>(i)); },
+        .invalid = [](std::size_t i){ return i % 3 == 0 ? 1 : 0; }
+    });
+}
+
+void checkFloat64(const AtomicStrainResult& result, const std::string& path){
+    AtomicStrainEncodingOptions encoding;
+    encoding.invalidBitmask = true;
+    VOLT_CHECK(writeColumnarResult(result, AtomicStrainField::All, encoding, true, path));
+
+    const AtomicStrainColumnarReader reader(path);
+    VOLT_CHECK(reader.numRows() == NumAtoms);
+    const auto ids = reader.column<std::int32_t>("id");
+    const auto shear = reader.column<double>("shear_strain");
+    const auto tensor = reader.column<double>("strain_tensor");
+    const auto invalid = reader.column<std::uint8_t>("invalid");
+    VOLT_CHECK(tensor.size() == NumAtoms * 6);
+    for(std::size_t i = 0; i < NumAtoms; ++i){
+        VOLT_CHECK(ids[i] == result.identifier(i));
+        VOLT_CHECK(shear[i] == result.shearStrains->getDouble(i));
+        // Stored as xx, yy, zz, xy, xz, yz like the msgpack output.
+        for(std::size_t c = 0; c < 6; ++c){
+            VOLT_CHECK(tensor[i * 6 + c] == result.strainTensors->getDoubleComponent(i, StrainTensorOutputOrder[c]));
+        }
+        VOLT_CHECK(((invalid[i / 8] >> (i % 8)) & 1) == (i % 3 == 0 ? 1 : 0));
+    }
+    for(const char* name : { "id", "shear_strain", "strain_tensor", "D2min", "invalid" }){
+        VOLT_CHECK(reader.verifyChecksum(name));
+    }
+}
+
+void checkQuantized(AtomicStrainResult result, const std::string& path){
+    AtomicStrainEncodingOptions encoding;
+    encoding.encoding = AtomicStrainEncoding::Quantized;
+    encoding.errorBound = 1e-4;
+
+    // Rows in reverse order exercise the row indirection.
+    auto rows = std::make_shared<std::vector<std::size_t>>(NumAtoms);
+    for(std::size_t i = 0; i < NumAtoms; ++i) (*rows)[i] = NumAtoms - 1 - i;
+    result.rows = rows;
+    // Beyond 2^31 quantization steps, so the column cannot stay quantized.
+    result.nonaffineSquaredDisplacements->setDouble(5, 1e9);
+
+    VOLT_CHECK(writeColumnarResult(result, AtomicStrainField::All, encoding, false, path));
+    const AtomicStrainColumnarReader reader(path);
+
+    const Columnar::ColumnEntry* shearEntry = reader.findColumn("shear_strain");
+    VOLT_CHECK(shearEntry && shearEntry->type == Columnar::ColumnType::QuantizedInt32);
+    VOLT_CHECK(shearEntry && shearEntry->scale == encoding.quantizationStep());
+    const auto ids = reader.column<std::int32_t>("id");
+    const auto shear = reader.column<std::int32_t>("shear_strain");
+    const auto tensor = reader.column<std::int32_t>("strain_tensor");
+    for(std::size_t row = 0; row < NumAtoms; ++row){
+        const std::size_t atom = (*rows)[row];
+        VOLT_CHECK(ids[row] == result.identifier(atom));
+        VOLT_CHECK(std::abs(shear[row] * shearEntry->scale - result.shearStrains->getDouble(atom)) <= encoding.errorBound);
+        for(std::size_t c = 0; c < 6; ++c){
+            const double expected = result.strainTensors->getDoubleComponent(atom, StrainTensorOutputOrder[c]);
+            VOLT_CHECK(std::abs(tensor[row * 6 + c] * shearEntry->scale - expected) <= encoding.errorBound);
+        }
+    }
+
+    const Columnar::ColumnEntry* d2minEntry = reader.findColumn("D2min");
+    VOLT_REQUIRE(d2minEntry && d2minEntry->type == Columnar::ColumnType::Float64);
+    const auto d2min = reader.column<double>("D2min");
+    for(std::size_t row = 0; row < NumAtoms; ++row){
+        VOLT_CHECK(d2min[row] == result.nonaffineSquaredDisplacements->getDouble((*rows)[row]));
+    }
+}
+
+// A column whose offset plus size wraps around 2^64 must not pass validation, and a
+// column is only handed out as its stored type.
+void checkRejectsCorrupt(const AtomicStrainResult& result, const std::string& path){
+    VOLT_REQUIRE(writeColumnarResult(result, AtomicStrainField::ShearStrain, {}, false, path));
+    {
+        const AtomicStrainColumnarReader reader(path);
+        bool mismatch = false;
+        try{
+            reader.column<float>("shear_strain");
+        }catch(const std::invalid_argument&){
+            mismatch = true;
+        }
+        VOLT_CHECK(mismatch);
+    }
+
+    Columnar::FileHeader header;
+    Columnar::ColumnEntry entry;
+    {
+        std::ifstream in(path, std::ios::binary);
+        in.read(reinterpret_cast<char*>(&header), sizeof(header));
+        in.seekg(static_cast<std::streamoff>(header.columnTableOffset));
+        in.read(reinterpret_cast<char*>(&entry), sizeof(entry));
+        VOLT_REQUIRE(in.good());
+    }
+    entry.offset = std::uint64_t(Columnar::Alignment) << 56;
+    entry.size = std::numeric_limits<std::uint64_t>::max() - entry.offset + Columnar::Alignment;
+    {
+        std::fstream out(path, std::ios::binary | std::ios::in | std::ios::out);
+        out.seekp(static_cast<std::streamoff>(header.columnTableOffset));
+        out.write(reinterpret_cast<const char*>(&entry), sizeof(entry));
+        VOLT_REQUIRE(out.good());
+    }
+    bool rejected = false;
+    try{
+        const AtomicStrainColumnarReader reader(path);
+    }catch(const std::runtime_error&){
+        rejected = true;
+    }
+    VOLT_CHECK(rejected);
+}
+
+}
+
+int main(){
+    const Testing::ScratchDirectory scratch("atomic-strain-columnar");
+    const AtomicStrainResult result = makeResult();
+    checkFloat64(result, scratch.file("float64.vcol"));
+    checkQuantized(result, scratch.file("quantized.vcol"));
+    checkRejectsCorrupt(result, scratch.file("corrupt.vcol"));
+    return Testing::finish();
+}
@@ -0,0 +1,130 @@
+#include <volt/atomic_strain_delta.h>
+
+#include "test_support.h"
+
+#include <cmath>
+#include <cstddef>
+#include <stdexcept>
+#include <vector>
+
+using namespace Volt;
+using namespace Volt::Particles;
+
+namespace{
+
+constexpr std::size_t AtomsPerFrame = 1000;
+constexpr std::size_t NumFrames = 24;
+constexpr std::size_t KeyframeInterval = 8;
+constexpr double Tolerance = 1e-3;
+
+// Frame f holds identifiers [30 f + 1, 30 f + AtomsPerFrame], so atoms leave and
+// join between frames, and values drift by less or more than the tolerance.
+AtomicStrainResult makeFrame(std::size_t frame){
+    const auto id = [frame](std::size_t i){ return static_cast<int>(30 * frame + i + 1); };
+    const auto drift = [frame, id](std::size_t i){ return (id(i) % 4 == 0 ? 4e-3 : 2e-4) * static_cast<double>(frame); };
+    return Testing::makeResult(AtomsPerFrame, {
+        .identifier = id,
+        .shearStrain = [id, drift](std::size_t i){ return 0.01 * id(i) + drift(i); },
+        .strainTensor = [id, drift](std::size_t i, std::size_t c){ return static_cast<double>(c) + 1e-3 * id(i) - drift(i); },
+        .invalid = [frame, id](std::size_t i){ return (id(i) + static_cast<int>(frame)) % 5 == 0 ? 1 : 0; }
+    });
+}
+
+void checkSequence(const AtomicStrainEncodingOptions& encoding, double maxError){
+    AtomicStrainDeltaEncoder encoder(KeyframeInterval, Tolerance);
+    AtomicStrainDeltaDecoder decoder;
+    const AtomicStrainField fields = AtomicStrainField::ShearStrain | AtomicStrainField::StrainTensor | AtomicStrainField::Invalid;
+
+    for(std::size_t frame = 0; frame < NumFrames; ++frame){
+        const AtomicStrainResult result = makeFrame(frame);
+        const nlohmann::json record = encoder.encode(result, fields, encoding);
+        VOLT_CHECK(record.at("keyframe").get<bool>() == (frame % KeyframeInterval == 0));
+        decoder.apply(record);
+
+        // Freed slots are reused, so the state does not grow with the atoms that left.
+        VOLT_CHECK(encoder.numSlots() <= AtomsPerFrame);
+        VOLT_REQUIRE(decoder.fields() == (std::vector<std::string>{ "shear_strain", "strain_tensor", "invalid" }));
+        VOLT_REQUIRE(decoder.atoms().size() == AtomsPerFrame);
+
+        for(std::size_t i = 0; i < AtomsPerFrame; ++i){
+            const auto it = decoder.atoms().find(result.identifiers->getInt(i));
+            VOLT_REQUIRE(it != decoder.atoms().end());
+            const std::vector<double>& values = it->second;
+            VOLT_REQUIRE(values.size() == 8);
+            VOLT_CHECK(std::abs(values[0] - result.shearStrains->getDouble(i)) <= maxError);
+            for(std::size_t c = 0; c < 6; ++c){
+                const double expected = result.strainTensors->getDoubleComponent(i, StrainTensorOutputOrder[c]);
+                VOLT_CHECK(std::abs(values[1 + c] - expected) <= maxError);
+            }
+            VOLT_CHECK(values[7] == result.invalidParticles->getInt(i));
+        }
+    }
+}
+
+void checkQuantizedRecord(){
+    AtomicStrainEncodingOptions encoding;
+    encoding.encoding = AtomicStrainEncoding::Quantized;
+    encoding.errorBound = 1e-5;
+    AtomicStrainDeltaEncoder encoder(KeyframeInterval, Tolerance);
+    const nlohmann::json record = encoder.encode(makeFrame(0), AtomicStrainField::ShearStrain, encoding);
+    VOLT_CHECK(record.at("encoding") == "quantized");
+    VOLT_CHECK(record.at("scale").get<double>() == encoding.quantizationStep());
+    VOLT_CHECK(record.at("values").at(0).is_number_integer());
+}
+
+void checkDeltaWithoutKeyframe(){
+    AtomicStrainDeltaEncoder encoder(KeyframeInterval, Tolerance);
+    encoder.encode(makeFrame(0), AtomicStrainField::ShearStrain);
+    const nlohmann::json delta = encoder.encode(makeFrame(1), AtomicStrainField::ShearStrain);
+
+    AtomicStrainDeltaDecoder decoder;
+    bool threw = false;
+    try{
+        decoder.apply(delta);
+    }catch(const std::runtime_error&){
+        threw = true;
+    }
+    VOLT_CHECK(threw);
+}
+
+// Records whose counts disagree are rejected instead of read past their arrays.
+void checkMalformedRecords(){
+    AtomicStrainDeltaEncoder encoder(KeyframeInterval, Tolerance);
+    const nlohmann::json keyframe = encoder.encode(makeFrame(0), AtomicStrainField::ShearStrain);
+
+    nlohmann::json missingComponent = keyframe;
+    missingComponent["components"].erase(missingComponent["components"].size() - 1);
+    nlohmann::json shortValues = keyframe;
+    shortValues["values"].erase(shortValues["values"].size() - 1);
+
+    for(const nlohmann::json& record : { missingComponent, shortValues }){
+        AtomicStrainDeltaDecoder decoder;
+        bool threw = false;
+        try{
+            decoder.apply(record);
+        }catch(const std::runtime_error&){
+            threw = true;
+        }
+        VOLT_CHECK(threw);
+    }
+}
+
+}
+
+int main(){
+    checkSequence(AtomicStrainEncodingOptions{}, Tolerance);
+
+    AtomicStrainEncodingOptions float32;
+    float32.encoding = AtomicStrainEncoding::Float32;
+    checkSequence(float32, Tolerance + 1e-6);
+
+    AtomicStrainEncodingOptions quantized;
+    quantized.encoding = AtomicStrainEncoding::Quantized;
+    quantized.errorBound = 1e-4;
+    checkSequence(quantized, Tolerance + quantized.errorBound + 1e-12);
+
+    checkQuantizedRecord();
+    checkDeltaWithoutKeyframe();
+    checkMalformedRecords();
+    return Testing::finish();
+}
@@ -0,0 +1,125 @@
+#include <volt/atomic_strain_dump_format.h>
+#include <volt/atomic_strain_dump_reader.h>
+#include <volt/atomic_strain_dump_writer.h>
+
+#include "test_support.h"
+
+#include <charconv>
+#include <cmath>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using namespace Volt;
+using namespace Volt::Particles;
+
+namespace{
+
+constexpr std::size_t NumAtoms = 50000;
+
+AtomicStrainResult makeResult(){
+    AtomicStrainResult result = Testing::makeResult(NumAtoms, {
+        .position = [](std::size_t i){
+            const double t = static_cast<double>(i);
+            return Point3(std::fmod(t * 0.37, 40.0) - 1.0, std::fmod(t * 0.11, 41.5) + 0.5, std::fmod(t * 0.013, 39.25) + 2.0);
+        },
+        .identifier = [](std::size_t i){ return static_cast<int>(NumAtoms - i); },
+        .shearStrain = [](std::size_t i){ return std::sin(static_cast<double>(i)) / 3.0; },
+        .strainTensor = [](std::size_t i, std::size_t c){ return std::cos(static_cast<double>(i + c)) * 1e-3; },
+        .invalid = [](std::size_t i){ return i % 7 == 0 ? 1 : 0; }
+    });
+    result.timestep = 4200;
+    const double lo[3] = { -1.0, 0.5, 2.0 };
+    const double hi[3] = { 39.0, 42.0, 41.25 };
+    const double tilt[3] = { 0.0, 0.0, 0.0 };
+    result.cell = makeDumpCell(lo, hi, tilt, { true, true, false });
+    return result;
+}
+
+// Per-atom rows of the ATOMS section as numbers, one vector per line.
+std::vector<std::vector<double>> readAtomRows(const std::string& path){
+    std::ifstream in(path);
+    std::string line;
+    while(std::getline(in, line) && line.rfind("ITEM: ATOMS", 0) != 0){}
+
+    std::vector<std::vector<double>> rows;
+    while(std::getline(in, line)){
+        std::vector<double> row;
+        const char* p = line.data();
+        const char* end = p + line.size();
+        while(p < end){
+            while(p < end && *p == ' ') ++p;
+            if(p == end) break;
+            double value = 0.0;
+            const auto parsed = std::from_chars(p, end, value);
+            if(parsed.ec != std::errc{}) return {};
+            row.push_back(value);
+            p = parsed.ptr;
+        }
+        rows.push_back(std::move(row));
+    }
+    return rows;
+}
+
+void checkFloat64(const AtomicStrainResult& result, const std::string& path){
+    VOLT_CHECK(writeLammpsDumpResult(result, AtomicStrainField::All, AtomicStrainEncodingOptions{}, path));
+
+    // Positions and identifiers come back exactly through the text reader.
+    AtomicStrainDumpReader reader(path);
+    AtomicStrainFrame frame;
+    VOLT_REQUIRE(reader.readFrame(frame));
+    VOLT_CHECK(frame.timestep == result.timestep);
+    VOLT_REQUIRE(frame.natoms == NumAtoms && frame.identifiers);
+    for(std::size_t i = 0; i < NumAtoms; ++i){
+        VOLT_CHECK(frame.identifiers->getInt(i) == result.identifiers->getInt(i));
+        const Point3 p = frame.positions->getPoint3(i);
+        const Point3 q = result.positions->getPoint3(i);
+        VOLT_CHECK(p.x() == q.x() && p.y() == q.y() && p.z() == q.z());
+    }
+    const AffineTransformation& cell = frame.simulationCell.matrix();
+    for(std::size_t k = 0; k < 3; ++k){
+        VOLT_CHECK(std::abs(cell(k, k) - result.cell.matrix()(k, k)) < 1e-12);
+        VOLT_CHECK(std::abs(cell(k, 3) - result.cell.matrix()(k, 3)) < 1e-12);
+    }
+    VOLT_CHECK(!reader.readFrame(frame));
+
+    // id x y z shear_strain strain_xx..strain_yz invalid
+    const auto rows = readAtomRows(path);
+    VOLT_REQUIRE(rows.size() == NumAtoms);
+    for(std::size_t i = 0; i < NumAtoms; ++i){
+        VOLT_REQUIRE(rows[i].size() == 12);
+        VOLT_CHECK(rows[i][4] == result.shearStrains->getDouble(i));
+        for(std::size_t c = 0; c < 6; ++c){
+            VOLT_CHECK(rows[i][5 + c] == result.strainTensors->getDoubleComponent(i, StrainTensorOutputOrder[c]));
+        }
+        VOLT_CHECK(rows[i][11] == result.invalidParticles->getInt(i));
+    }
+}
+
+void checkQuantized(AtomicStrainResult result, const std::string& path){
+    AtomicStrainEncodingOptions encoding;
+    encoding.encoding = AtomicStrainEncoding::Quantized;
+    encoding.errorBound = 5e-5;
+    // Needs far more room in fixed notation than a regular value.
+    result.shearStrains->setDouble(3, 1e300);
+
+    VOLT_CHECK(writeLammpsDumpResult(result, AtomicStrainField::ShearStrain, encoding, path));
+    const auto rows = readAtomRows(path);
+    VOLT_REQUIRE(rows.size() == NumAtoms);
+    for(std::size_t i = 0; i < NumAtoms; ++i){
+        VOLT_REQUIRE(rows[i].size() == 5);
+        const double expected = result.shearStrains->getDouble(i);
+        VOLT_CHECK(std::abs(rows[i][4] - expected) <= std::max(encoding.errorBound, std::abs(expected) * 1e-15));
+    }
+}
+
+}
+
+int main(){
+    const Testing::ScratchDirectory scratch("atomic-strain-dump-writer");
+    const AtomicStrainResult result = makeResult();
+    checkFloat64(result, scratch.file("float64.dump"));
+    checkQuantized(result, scratch.file("quantized.dump"));
+    return Testing::finish();
+}
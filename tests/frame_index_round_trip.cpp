@@ -0,0 +1,113 @@
+#include <volt/atomic_strain_frame_index.h>
+
+#include "test_support.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <string>
+
+using namespace Volt;
+
+namespace{
+
+constexpr std::size_t NumFrames = 5;
+
+std::size_t atomsInFrame(std::size_t frame){
+    return 10 + 3 * frame;
+}
+
+void writeDump(const std::string& path){
+    std::ofstream out(path, std::ios::trunc);
+    for(std::size_t f = 0; f < NumFrames; ++f){
+        out << "ITEM: TIMESTEP\n" << 1000 * f << "\n";
+        out << "ITEM: NUMBER OF ATOMS\n" << atomsInFrame(f) << "\n";
+        out << "ITEM: BOX BOUNDS pp pp ff\n0 " << 10 + f << "\n0 20\n0 30\n";
+        out << "ITEM: ATOMS id type x y z\n";
+        for(std::size_t i = 0; i < atomsInFrame(f); ++i){
+            out << i + 1 << " 1 " << 0.5 * static_cast<double>(i) << " " << f << " 1.5\n";
+        }
+    }
+}
+
+// Overwrites the frame count in the header of the sidecar.
+void patchFrameCount(const std::string& sidecarPath, std::uint64_t numFrames){
+    std::fstream file(sidecarPath, std::ios::binary | std::ios::in | std::ios::out);
+    file.seekp(offsetof(FrameIndex::FileHeader, numFrames));
+    file.write(reinterpret_cast<const char*>(&numFrames), sizeof(numFrames));
+}
+
+void checkRoundTrip(const std::string& dumpPath){
+    writeDump(dumpPath);
+    const std::string sidecarPath = dumpPath + FrameIndex::Extension;
+
+    const AtomicStrainFrameIndex built = AtomicStrainFrameIndex::open(dumpPath, true);
+    VOLT_REQUIRE(built.frames().size() == NumFrames);
+    VOLT_REQUIRE(std::filesystem::exists(sidecarPath));
+
+    const auto loaded = AtomicStrainFrameIndex::load(dumpPath);
+    VOLT_REQUIRE(loaded.has_value());
+    VOLT_REQUIRE(loaded->frames().size() == NumFrames);
+    for(std::size_t f = 0; f < NumFrames; ++f){
+        const AtomicStrainFrameInfo& a = built.frames()[f];
+        const AtomicStrainFrameInfo& b = loaded->frames()[f];
+        VOLT_CHECK(a.timestep == b.timestep);
+        VOLT_CHECK(a.offset == b.offset);
+        VOLT_CHECK(a.natoms == b.natoms);
+        VOLT_CHECK(b.simulationCell.matrix()(0, 0) == static_cast<double>(10 + f));
+        VOLT_CHECK(b.simulationCell.pbcFlags()[1] && !b.simulationCell.pbcFlags()[2]);
+    }
+
+    // Frames are read by offset, concurrently and in order.
+    const AtomicStrainFrameInfo* third = loaded->find(2000);
+    VOLT_REQUIRE(third != nullptr);
+    const AtomicStrainFrame frame = loaded->readFrame(*third);
+    VOLT_CHECK(frame.natoms == atomsInFrame(2));
+    VOLT_CHECK(frame.positions->getPoint3(4)[0] == 2.0);
+
+    std::size_t next = 1;
+    loaded->forEachFrame(loaded->range(1000, 3000), 2, [&next](AtomicStrainFrame& f){
+        VOLT_CHECK(f.timestep == static_cast<long long>(1000 * next));
+        VOLT_CHECK(f.natoms == atomsInFrame(next));
+        ++next;
+    });
+    VOLT_CHECK(next == 4);
+}
+
+void checkRejected(const std::string& dumpPath){
+    writeDump(dumpPath);
+    const std::string sidecarPath = dumpPath + FrameIndex::Extension;
+    VOLT_REQUIRE(AtomicStrainFrameIndex::build(dumpPath).save());
+    const auto size = std::filesystem::file_size(sidecarPath);
+
+    // A corrupt frame count must not size an allocation.
+    patchFrameCount(sidecarPath, std::uint64_t(1) << 60);
+    VOLT_CHECK(!AtomicStrainFrameIndex::load(dumpPath).has_value());
+    patchFrameCount(sidecarPath, NumFrames + 1);
+    VOLT_CHECK(!AtomicStrainFrameIndex::load(dumpPath).has_value());
+    patchFrameCount(sidecarPath, NumFrames);
+    VOLT_CHECK(AtomicStrainFrameIndex::load(dumpPath).has_value());
+
+    std::filesystem::resize_file(sidecarPath, size - 8);
+    VOLT_CHECK(!AtomicStrainFrameIndex::load(dumpPath).has_value());
+
+    // A changed dump makes the sidecar stale; open() rebuilds it.
+    VOLT_REQUIRE(AtomicStrainFrameIndex::build(dumpPath).save());
+    {
+        std::ofstream out(dumpPath, std::ios::app);
+        out << "\n";
+    }
+    VOLT_CHECK(!AtomicStrainFrameIndex::load(dumpPath).has_value());
+    VOLT_CHECK(AtomicStrainFrameIndex::open(dumpPath, true).frames().size() == NumFrames);
+    VOLT_CHECK(AtomicStrainFrameIndex::load(dumpPath).has_value());
+}
+
+}
+
+int main(){
+    const Testing::ScratchDirectory scratch("atomic-strain-frame-index");
+    checkRoundTrip(scratch.file("frames.dump"));
+    checkRejected(scratch.file("rejected.dump"));
+    return Testing::finish();
+}
@@ -0,0 +1,122 @@
+#include <volt/atomic_strain_snapshot.h>
+
+#include "test_support.h"
+
+#include <filesystem>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using namespace Volt;
+
+namespace{
+
+constexpr std::size_t NumFrames = 3;
+
+std::size_t atomsInFrame(std::size_t frame){
+    return 20 + 7 * frame;
+}
+
+// Frame 1 has no identifier column; every frame has wrapped and unwrapped positions.
+void writeDump(const std::string& path){
+    std::ofstream out(path, std::ios::trunc);
+    for(std::size_t f = 0; f < NumFrames; ++f){
+        out << "ITEM: TIMESTEP\n" << 10 * f << "\n";
+        out << "ITEM: NUMBER OF ATOMS\n" << atomsInFrame(f) << "\n";
+        out << "ITEM: BOX BOUNDS xy xz yz pp pp pp\n-1 11 1\n0 12 0\n0 13 0\n";
+        out << (f == 1 ? "ITEM: ATOMS x y z xu yu zu\n" : "ITEM: ATOMS id x y z xu yu zu\n");
+        for(std::size_t i = 0; i < atomsInFrame(f); ++i){
+            if(f != 1) out << 100 + i << " ";
+            out << 0.25 * static_cast<double>(i) << " " << f << " 3 ";
+            out << 0.25 * static_cast<double>(i) + 12 << " " << f << " 3\n";
+        }
+    }
+}
+
+void checkSameFrames(const std::string& dumpPath, const std::string& snapshotPath, bool preferUnwrapped){
+    auto dump = openDumpReader(dumpPath, preferUnwrapped);
+    auto snapshot = openDumpReader(snapshotPath);
+    for(std::size_t f = 0; f < NumFrames; ++f){
+        AtomicStrainFrame expected, actual;
+        VOLT_REQUIRE(dump->readFrame(expected));
+        VOLT_REQUIRE(snapshot->readFrame(actual));
+        VOLT_CHECK(actual.timestep == expected.timestep);
+        VOLT_REQUIRE(actual.natoms == expected.natoms);
+        VOLT_CHECK((actual.identifiers != nullptr) == (expected.identifiers != nullptr));
+        for(std::size_t i = 0; i < actual.natoms; ++i){
+            for(std::size_t k = 0; k < 3; ++k){
+                VOLT_CHECK(actual.positions->getPoint3(i)[k] == expected.positions->getPoint3(i)[k]);
+            }
+            if(actual.identifiers && expected.identifiers){
+                VOLT_CHECK(actual.identifiers->getInt(i) == expected.identifiers->getInt(i));
+            }
+        }
+        for(std::size_t r = 0; r < 3; ++r){
+            for(std::size_t c = 0; c < 4; ++c){
+                VOLT_CHECK(actual.simulationCell.matrix()(r, c) == expected.simulationCell.matrix()(r, c));
+            }
+        }
+    }
+    AtomicStrainFrame end;
+    VOLT_CHECK(!snapshot->readFrame(end));
+}
+
+void checkConvert(const std::string& dumpPath){
+    writeDump(dumpPath);
+    const std::string snapshotPath = snapshotPathFor(dumpPath);
+
+    for(bool preferUnwrapped : { false, true }){
+        VOLT_REQUIRE(writeSnapshot(dumpPath, snapshotPath, preferUnwrapped));
+        VOLT_CHECK(isSnapshot(snapshotPath));
+        VOLT_CHECK(findSnapshot(dumpPath, preferUnwrapped).has_value());
+        // Converted from other position columns than the run would read.
+        VOLT_CHECK(!findSnapshot(dumpPath, !preferUnwrapped).has_value());
+        checkSameFrames(dumpPath, snapshotPath, preferUnwrapped);
+    }
+
+    // Frames are seekable through the offsets skipFrame() reports.
+    AtomicStrainSnapshotReader reader(snapshotPath);
+    std::vector<AtomicStrainFrameInfo> infos(NumFrames);
+    for(auto& info : infos) VOLT_REQUIRE(reader.skipFrame(info));
+    reader.seek(infos[2].offset);
+    AtomicStrainFrame frame;
+    VOLT_REQUIRE(reader.readFrame(frame));
+    VOLT_CHECK(frame.timestep == 20);
+    VOLT_CHECK(frame.natoms == atomsInFrame(2));
+
+    // A changed dump makes the snapshot stale.
+    {
+        std::ofstream out(dumpPath, std::ios::app);
+        out << "\n";
+    }
+    VOLT_CHECK(!findSnapshot(dumpPath, true).has_value());
+}
+
+void checkMalformed(const std::string& dumpPath){
+    writeDump(dumpPath);
+    {
+        std::ofstream out(dumpPath, std::ios::app);
+        out << "ITEM: TIMESTEP\n40\nITEM: NUMBER OF ATOMS\n2\nITEM: BOX BOUNDS pp pp pp\n0 1\n0 1\n0 1\n";
+        out << "ITEM: ATOMS id x y z\n1 0.5 0.5 0.5\n2 0.5 oops 0.5\n";
+    }
+    const std::string snapshotPath = snapshotPathFor(dumpPath);
+    bool thrown = false;
+    try{
+        writeSnapshot(dumpPath, snapshotPath);
+    }catch(const std::runtime_error&){
+        thrown = true;
+    }
+    VOLT_CHECK(thrown);
+    VOLT_CHECK(!std::filesystem::exists(snapshotPath));
+    VOLT_CHECK(!std::filesystem::exists(snapshotPath + ".tmp"));
+}
+
+}
+
+int main(){
+    const Testing::ScratchDirectory scratch("atomic-strain-snapshot");
+    checkConvert(scratch.file("frames.dump"));
+    checkMalformed(scratch.file("malformed.dump"));
+    return Testing::finish();
+}
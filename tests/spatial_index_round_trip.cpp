@@ -0,0 +1,111 @@
+#include <volt/atomic_strain_columnar_writer.h>
+#include <volt/atomic_strain_spatial_index.h>
+
+#include "test_support.h"
+
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <vector>
+
+using namespace Volt;
+using namespace Volt::Particles;
+
+namespace{
+
+constexpr std::size_t NumAtoms = 5000;
+constexpr std::size_t BlockSize = 100;
+
+AtomicStrainResult makeResult(){
+    std::uint64_t state = 12345;
+    const auto next = [&state]{
+        state = state * 6364136223846793005ull + 1442695040888963407ull;
+        return static_cast<double>(state >> 11) / static_cast<double>(1ull << 53);
+    };
+    // Atoms are filled in index order, so the positions follow the generator sequence.
+    AtomicStrainResult result = Testing::makeResult(NumAtoms, {
+        .position = [&next](std::size_t){ return Point3(10.0 * next(), 10.0 * next(), 10.0 * next()); },
+        .shearStrain = [](std::size_t i){ return 0.5 * static_cast<double>(i); }
+    });
+    result.rows = mortonRowOrder(result);
+    return result;
+}
+
+bool inside(const Point3& p, const double boxMin[3], const double boxMax[3]){
+    for(std::size_t k = 0; k < 3; ++k){
+        if(p[k] < boxMin[k] || p[k] > boxMax[k]) return false;
+    }
+    return true;
+}
+
+// Every atom inside the box lies in a returned row range, and the byte ranges of the
+// shear column read back the values of those rows.
+void checkQuery(
+    const AtomicStrainResult& result,
+    const AtomicStrainSpatialIndexReader& index,
+    const std::string& columnarPath,
+    const double boxMin[3],
+    const double boxMax[3]
+){
+    const auto ranges = index.query(boxMin, boxMax);
+    std::vector<bool> covered(result.numRows(), false);
+    std::uint64_t coveredRows = 0;
+    for(const auto& range : ranges){
+        VOLT_REQUIRE(range.begin + range.count <= result.numRows());
+        for(std::uint64_t row = range.begin; row < range.begin + range.count; ++row){
+            covered[row] = true;
+        }
+        coveredRows += range.count;
+    }
+    std::size_t hits = 0;
+    for(std::size_t row = 0; row < result.numRows(); ++row){
+        if(inside(result.referencePosition(result.atomIndex(row)), boxMin, boxMax)){
+            ++hits;
+            VOLT_CHECK(covered[row]);
+        }
+    }
+    VOLT_CHECK(hits > 0);
+    // Code ranges narrow the search below whole blocks.
+    VOLT_CHECK(coveredRows < result.numRows() / 2);
+
+    const SpatialIndex::ColumnRef* shear = index.findColumn("shear_strain");
+    VOLT_REQUIRE(shear != nullptr);
+    std::ifstream in(columnarPath, std::ios::binary);
+    for(const auto& range : ranges){
+        const SpatialIndex::ByteRange bytes = AtomicStrainSpatialIndexReader::byteRange(*shear, range);
+        VOLT_REQUIRE(bytes.size == range.count * sizeof(double));
+        std::vector<double> values(range.count);
+        in.seekg(static_cast<std::streamoff>(bytes.offset));
+        in.read(reinterpret_cast<char*>(values.data()), static_cast<std::streamsize>(bytes.size));
+        VOLT_REQUIRE(in.good());
+        for(std::uint64_t i = 0; i < range.count; ++i){
+            const std::size_t atom = result.atomIndex(range.begin + i);
+            VOLT_CHECK(values[i] == result.shearStrains->getDouble(atom));
+        }
+    }
+}
+
+void checkIndex(const AtomicStrainResult& result, const std::string& columnarPath, const std::string& indexPath){
+    VOLT_REQUIRE(writeColumnarResult(result, AtomicStrainField::ShearStrain, {}, false, columnarPath));
+    VOLT_REQUIRE(writeSpatialIndex(result, mortonGrid(result), BlockSize, columnarPath, indexPath));
+
+    const AtomicStrainSpatialIndexReader index(indexPath);
+    VOLT_CHECK(index.header().numRows == result.numRows());
+    VOLT_CHECK(index.blocks().size() == (result.numRows() + BlockSize - 1) / BlockSize);
+    VOLT_CHECK(index.codes().size() == result.numRows());
+
+    const double boxMin[3] = { 2.0, 3.0, 4.0 };
+    const double boxMax[3] = { 4.0, 5.0, 6.0 };
+    checkQuery(result, index, columnarPath, boxMin, boxMax);
+}
+
+}
+
+int main(){
+    const Testing::ScratchDirectory scratch("atomic-strain-spatial-index");
+    const AtomicStrainResult result = makeResult();
+    checkIndex(result, scratch.file("whole.vcol"), scratch.file("whole.vmix"));
+    // A shard view has its own rows but shares the grid of the whole result.
+    checkIndex(result.slice(1000, 2500), scratch.file("shard.vcol"), scratch.file("shard.vmix"));
+    return Testing::finish();
+}
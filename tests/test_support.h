@@ -0,0 +1,115 @@
+#pragma once
+
+#include <volt/core/volt.h>
+#include <volt/core/particle_property.h>
+#include <volt/atomic_strain_result.h>
+
+#include <cstddef>
+#include <filesystem>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <system_error>
+#include <unistd.h>
+
+// Minimal check macros for the round-trip tests. Every test is its own executable
+// registered with CTest; a failed check is reported and the test exits nonzero.
+namespace Volt::Testing{
+
+inline int& failureCount(){
+	static int count = 0;
+	return count;
+}
+
+inline void reportFailure(const char* expression, const char* file, int line){
+	std::cerr << file << ":" << line << ": check failed: " << expression << "\n";
+	++failureCount();
+}
+
+inline int finish(){
+	if(failureCount() != 0){
+		std::cerr << failureCount() << " check(s) failed\n";
+		return 1;
+	}
+	return 0;
+}
+
+// Unique directory below the system temp directory, removed with its contents.
+class ScratchDirectory{
+public:
+	explicit ScratchDirectory(const std::string& name){
+		_path = std::filesystem::temp_directory_path() / (name + "-" + std::to_string(::getpid()));
+		std::filesystem::remove_all(_path);
+		std::filesystem::create_directories(_path);
+	}
+
+	~ScratchDirectory(){
+		std::error_code ec;
+		std::filesystem::remove_all(_path, ec);
+	}
+
+	ScratchDirectory(const ScratchDirectory&) = delete;
+	ScratchDirectory& operator=(const ScratchDirectory&) = delete;
+
+	std::string file(const std::string& name) const{
+		return (_path / name).string();
+	}
+
+private:
+	std::filesystem::path _path;
+};
+
+inline std::shared_ptr<Particles::ParticleProperty> makeProperty(std::size_t count, DataType type, std::size_t components){
+	return std::make_shared<Particles::ParticleProperty>(count, type, components, 0, true);
+}
+
+// Per-atom values of a synthetic result, by atom index. Positions and identifiers are
+// always allocated, zero and index + 1 by default; other properties only when given.
+struct ResultValues{
+	std::function<Point3(std::size_t)> position{};
+	std::function<int(std::size_t)> identifier{};
+	std::function<double(std::size_t)> shearStrain{};
+	// Components in storage order, xx, yy, zz, yz, xz, xy.
+	std::function<double(std::size_t, std::size_t)> strainTensor{};
+	std::function<double(std::size_t)> d2min{};
+	std::function<int(std::size_t)> invalid{};
+};
+
+inline AtomicStrainResult makeResult(std::size_t numAtoms, const ResultValues& values){
+	AtomicStrainResult result;
+	result.positions = makeProperty(numAtoms, DataType::Double, 3);
+	result.identifiers = makeProperty(numAtoms, DataType::Int, 1);
+	if(values.shearStrain) result.shearStrains = makeProperty(numAtoms, DataType::Double, 1);
+	if(values.strainTensor) result.strainTensors = makeProperty(numAtoms, DataType::Double, 6);
+	if(values.d2min) result.nonaffineSquaredDisplacements = makeProperty(numAtoms, DataType::Double, 1);
+	if(values.invalid) result.invalidParticles = makeProperty(numAtoms, DataType::Int, 1);
+	for(std::size_t i = 0; i < numAtoms; ++i){
+		if(values.position) result.positions->setPoint3(i, values.position(i));
+		result.identifiers->setInt(i, values.identifier ? values.identifier(i) : static_cast<int>(i) + 1);
+		if(values.shearStrain) result.shearStrains->setDouble(i, values.shearStrain(i));
+		if(values.strainTensor){
+			for(std::size_t c = 0; c < 6; ++c) result.strainTensors->setDoubleComponent(i, c, values.strainTensor(i, c));
+		}
+		if(values.d2min) result.nonaffineSquaredDisplacements->setDouble(i, values.d2min(i));
+		if(values.invalid) result.invalidParticles->setInt(i, values.invalid(i));
+	}
+	return result;
+}
+
+}
+
+#define VOLT_CHECK(condition) \
+	do{ \
+		if(!(condition)) ::Volt::Testing::reportFailure(#condition, __FILE__, __LINE__); \
+	}while(false)
+
+// Leaves the calling (void) test function when a precondition for the remaining
+// checks does not hold.
+#define VOLT_REQUIRE(condition) \
+	do{ \
+		if(!(condition)){ \
+			::Volt::Testing::reportFailure(#condition, __FILE__, __LINE__); \
+			return; \
+		} \
+	}while(false)